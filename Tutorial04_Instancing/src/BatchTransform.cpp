@@ -0,0 +1,341 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "BatchTransform.hpp"
+#include "DebugUtilities.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    define BATCH_TRANSFORM_X86 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#        define BATCH_TRANSFORM_TARGET_AVX2
+#    else
+#        define BATCH_TRANSFORM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#    endif
+#else
+#    define BATCH_TRANSFORM_X86 0
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Las matrices de BasicMath son row-major y se usan con vectores fila: (A * B).row(i) es la
+// combinación lineal de las filas de B con los coeficientes de la fila i de A.
+
+struct BatchTransformKernels
+{
+    void (*MultiplyByParent)(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count);
+    void (*Multiply)(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count);
+    void (*ComposeInstances)(const float4x4* pLocal, const float* pTexSelectors, const float4x4& Parent, InstanceDataType* pDst, size_t Count);
+};
+
+// ======= Escalar =======
+
+void MultiplyByParentScalar(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count)
+{
+    for (size_t i = 0; i < Count; ++i)
+        pOut[i] = pLocal[i] * Parent;
+}
+
+void MultiplyScalar(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count)
+{
+    for (size_t i = 0; i < Count; ++i)
+        pOut[i] = pLocal[i] * pParent[i];
+}
+
+void ComposeInstancesScalar(const float4x4* pLocal, const float* pTexSelectors, const float4x4& Parent, InstanceDataType* pDst, size_t Count)
+{
+    for (size_t i = 0; i < Count; ++i)
+    {
+        pDst[i].Transform   = pLocal[i] * Parent;
+        pDst[i].TexSelector = pTexSelectors[i];
+    }
+}
+
+#if BATCH_TRANSFORM_X86
+
+// ======= SSE2 =======
+
+inline void MultiplySSE(const float* pA, const __m128 B[4], float* pOut)
+{
+    for (int r = 0; r < 4; ++r)
+    {
+        __m128 Row = _mm_mul_ps(_mm_set1_ps(pA[r * 4 + 0]), B[0]);
+        Row        = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(pA[r * 4 + 1]), B[1]));
+        Row        = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(pA[r * 4 + 2]), B[2]));
+        Row        = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(pA[r * 4 + 3]), B[3]));
+        // El destino puede no estar alineado (p. ej. el stride de 68 bytes del buffer de instancias)
+        _mm_storeu_ps(pOut + r * 4, Row);
+    }
+}
+
+inline void LoadRowsSSE(const float4x4& M, __m128 Rows[4])
+{
+    for (int r = 0; r < 4; ++r)
+        Rows[r] = _mm_loadu_ps(M.m[r]);
+}
+
+void MultiplyByParentSSE(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count)
+{
+    __m128 B[4];
+    LoadRowsSSE(Parent, B);
+    for (size_t i = 0; i < Count; ++i)
+        MultiplySSE(&pLocal[i].m[0][0], B, &pOut[i].m[0][0]);
+}
+
+void MultiplyPairsSSE(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count)
+{
+    for (size_t i = 0; i < Count; ++i)
+    {
+        __m128 B[4];
+        LoadRowsSSE(pParent[i], B);
+        MultiplySSE(&pLocal[i].m[0][0], B, &pOut[i].m[0][0]);
+    }
+}
+
+void ComposeInstancesSSE(const float4x4* pLocal, const float* pTexSelectors, const float4x4& Parent, InstanceDataType* pDst, size_t Count)
+{
+    __m128 B[4];
+    LoadRowsSSE(Parent, B);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        MultiplySSE(&pLocal[i].m[0][0], B, &pDst[i].Transform.m[0][0]);
+        pDst[i].TexSelector = pTexSelectors[i];
+    }
+}
+
+// ======= AVX2 + FMA =======
+
+// Calcula dos filas del resultado a la vez: cada mitad de 128 bits del registro contiene una
+// fila de A, y B[k] contiene la fila k de B duplicada en ambas mitades
+BATCH_TRANSFORM_TARGET_AVX2 inline void MultiplyAVX2(const float* pA, const __m256 B[4], float* pOut)
+{
+    for (int r = 0; r < 4; r += 2)
+    {
+        const __m256 A = _mm256_loadu_ps(pA + r * 4);
+
+        __m256 Rows = _mm256_mul_ps(_mm256_permute_ps(A, _MM_SHUFFLE(0, 0, 0, 0)), B[0]);
+        Rows        = _mm256_fmadd_ps(_mm256_permute_ps(A, _MM_SHUFFLE(1, 1, 1, 1)), B[1], Rows);
+        Rows        = _mm256_fmadd_ps(_mm256_permute_ps(A, _MM_SHUFFLE(2, 2, 2, 2)), B[2], Rows);
+        Rows        = _mm256_fmadd_ps(_mm256_permute_ps(A, _MM_SHUFFLE(3, 3, 3, 3)), B[3], Rows);
+        _mm256_storeu_ps(pOut + r * 4, Rows);
+    }
+}
+
+BATCH_TRANSFORM_TARGET_AVX2 inline void LoadRowsAVX2(const float4x4& M, __m256 Rows[4])
+{
+    for (int r = 0; r < 4; ++r)
+        Rows[r] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(M.m[r]));
+}
+
+BATCH_TRANSFORM_TARGET_AVX2 void MultiplyByParentAVX2(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count)
+{
+    __m256 B[4];
+    LoadRowsAVX2(Parent, B);
+    for (size_t i = 0; i < Count; ++i)
+        MultiplyAVX2(&pLocal[i].m[0][0], B, &pOut[i].m[0][0]);
+}
+
+BATCH_TRANSFORM_TARGET_AVX2 void MultiplyPairsAVX2(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count)
+{
+    for (size_t i = 0; i < Count; ++i)
+    {
+        __m256 B[4];
+        LoadRowsAVX2(pParent[i], B);
+        MultiplyAVX2(&pLocal[i].m[0][0], B, &pOut[i].m[0][0]);
+    }
+}
+
+BATCH_TRANSFORM_TARGET_AVX2 void ComposeInstancesAVX2(const float4x4* pLocal, const float* pTexSelectors, const float4x4& Parent, InstanceDataType* pDst, size_t Count)
+{
+    __m256 B[4];
+    LoadRowsAVX2(Parent, B);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        MultiplyAVX2(&pLocal[i].m[0][0], B, &pDst[i].Transform.m[0][0]);
+        pDst[i].TexSelector = pTexSelectors[i];
+    }
+}
+
+bool IsAVX2Supported()
+{
+#    if defined(_MSC_VER) && !defined(__clang__)
+    int CPUInfo[4] = {};
+    __cpuid(CPUInfo, 1);
+    const bool OSXSave = (CPUInfo[2] & (1 << 27)) != 0;
+    const bool FMA     = (CPUInfo[2] & (1 << 12)) != 0;
+    if (!OSXSave || !FMA)
+        return false;
+    // El sistema operativo debe guardar los registros YMM en los cambios de contexto
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(CPUInfo, 7, 0);
+    return (CPUInfo[1] & (1 << 5)) != 0;
+#    else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#    endif
+}
+
+#endif // BATCH_TRANSFORM_X86
+
+const BatchTransformKernels Kernels[BATCH_TRANSFORM_ISA_COUNT] =
+{
+    {MultiplyByParentScalar, MultiplyScalar, ComposeInstancesScalar},
+#if BATCH_TRANSFORM_X86
+    {MultiplyByParentSSE, MultiplyPairsSSE, ComposeInstancesSSE},
+    {MultiplyByParentAVX2, MultiplyPairsAVX2, ComposeInstancesAVX2},
+#else
+    {MultiplyByParentScalar, MultiplyScalar, ComposeInstancesScalar},
+    {MultiplyByParentScalar, MultiplyScalar, ComposeInstancesScalar},
+#endif
+};
+
+BATCH_TRANSFORM_ISA SelectBestISA()
+{
+    BATCH_TRANSFORM_ISA BestISA = BATCH_TRANSFORM_ISA_SCALAR;
+    for (Uint8 ISA = BATCH_TRANSFORM_ISA_SCALAR; ISA < BATCH_TRANSFORM_ISA_COUNT; ++ISA)
+    {
+        if (IsBatchTransformISASupported(static_cast<BATCH_TRANSFORM_ISA>(ISA)))
+            BestISA = static_cast<BATCH_TRANSFORM_ISA>(ISA);
+    }
+    return BestISA;
+}
+
+BATCH_TRANSFORM_ISA& ActiveISA()
+{
+    static BATCH_TRANSFORM_ISA ISA = SelectBestISA();
+    return ISA;
+}
+
+#ifdef DILIGENT_DEBUG
+// Comprueba que el kernel vectorizado coincide con float4x4::operator*
+void VerifyKernel(BATCH_TRANSFORM_ISA ISA)
+{
+    float4x4 Local[3] = {
+        float4x4::Scale(0.6f, 0.6f, 0.6f) * float4x4::Translation(3.0f, 2.0f, 0.0f),
+        float4x4::Scale(3.6f, 0.1f, 0.1f) * float4x4::RotationX(0.3f) * float4x4::Translation(0.0f, 2.6f, -1.0f),
+        float4x4::RotationZ(-1.1f) * float4x4::Scale(0.1f, 0.85f, 2.0f),
+    };
+    const float4x4 Parent = float4x4::RotationY(0.7f) * float4x4::Translation(8.0f, 0.0f, -16.0f);
+    const float    TexSelectors[3] = {0.0f, 1.0f, 2.0f};
+
+    InstanceDataType Instances[3];
+    Kernels[ISA].ComposeInstances(Local, TexSelectors, Parent, Instances, 3);
+    for (int i = 0; i < 3; ++i)
+    {
+        const float4x4 Ref = Local[i] * Parent;
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+                VERIFY(std::abs(Ref.m[r][c] - Instances[i].Transform.m[r][c]) <= 1e-5f * std::max(1.f, std::abs(Ref.m[r][c])),
+                       "El kernel ", GetBatchTransformISAName(ISA), " no coincide con float4x4::operator*");
+        }
+        VERIFY_EXPR(Instances[i].TexSelector == TexSelectors[i]);
+    }
+}
+#endif
+
+} // namespace
+
+const char* GetBatchTransformISAName(BATCH_TRANSFORM_ISA ISA)
+{
+    switch (ISA)
+    {
+        case BATCH_TRANSFORM_ISA_SCALAR: return "Escalar";
+        case BATCH_TRANSFORM_ISA_SSE: return "SSE2";
+        case BATCH_TRANSFORM_ISA_AVX2: return "AVX2";
+        default: return "<desconocido>";
+    }
+}
+
+bool IsBatchTransformISASupported(BATCH_TRANSFORM_ISA ISA)
+{
+    switch (ISA)
+    {
+        case BATCH_TRANSFORM_ISA_SCALAR:
+            return true;
+
+#if BATCH_TRANSFORM_X86
+        case BATCH_TRANSFORM_ISA_SSE:
+            // SSE2 forma parte de la base de x86-64
+            return true;
+
+        case BATCH_TRANSFORM_ISA_AVX2:
+        {
+            static const bool AVX2Supported = IsAVX2Supported();
+            return AVX2Supported;
+        }
+#endif
+
+        default:
+            return false;
+    }
+}
+
+BATCH_TRANSFORM_ISA GetBatchTransformISA()
+{
+    return ActiveISA();
+}
+
+bool SetBatchTransformISA(BATCH_TRANSFORM_ISA ISA)
+{
+    if (ISA >= BATCH_TRANSFORM_ISA_COUNT || !IsBatchTransformISASupported(ISA))
+        return false;
+
+#ifdef DILIGENT_DEBUG
+    VerifyKernel(ISA);
+#endif
+    ActiveISA() = ISA;
+    return true;
+}
+
+void BatchMultiply(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count)
+{
+    Kernels[ActiveISA()].MultiplyByParent(pLocal, Parent, pOut, Count);
+}
+
+void BatchMultiply(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count)
+{
+    Kernels[ActiveISA()].Multiply(pLocal, pParent, pOut, Count);
+}
+
+void BatchComposeInstances(const float4x4*   pLocal,
+                           const float*      pTexSelectors,
+                           const float4x4&   Parent,
+                           InstanceDataType* pDst,
+                           size_t            Count)
+{
+    Kernels[ActiveISA()].ComposeInstances(pLocal, pTexSelectors, Parent, pDst, Count);
+}
+
+} // namespace Diligent
@@ -0,0 +1,73 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include "BasicMath.hpp"
+#include "InstanceData.hpp"
+
+namespace Diligent
+{
+
+// Conjunto de instrucciones usado por los kernels de composición de matrices
+enum BATCH_TRANSFORM_ISA : Uint8
+{
+    BATCH_TRANSFORM_ISA_SCALAR = 0, // float4x4::operator* de BasicMath
+    BATCH_TRANSFORM_ISA_SSE,        // SSE2, una fila por registro
+    BATCH_TRANSFORM_ISA_AVX2,       // AVX2 + FMA, dos filas por registro
+    BATCH_TRANSFORM_ISA_COUNT
+};
+
+const char* GetBatchTransformISAName(BATCH_TRANSFORM_ISA ISA);
+
+// Indica si la CPU (y el sistema operativo) soportan el conjunto de instrucciones
+bool IsBatchTransformISASupported(BATCH_TRANSFORM_ISA ISA);
+
+// Conjunto activo. Por defecto se selecciona en tiempo de ejecución el mejor soportado.
+BATCH_TRANSFORM_ISA GetBatchTransformISA();
+
+// Fuerza un conjunto de instrucciones (p. ej. para comparar rendimiento).
+// Si no está soportado se mantiene el actual y se devuelve false.
+bool SetBatchTransformISA(BATCH_TRANSFORM_ISA ISA);
+
+// pOut[i] = pLocal[i] * Parent
+void BatchMultiply(const float4x4* pLocal, const float4x4& Parent, float4x4* pOut, size_t Count);
+
+// pOut[i] = pLocal[i] * pParent[i]
+void BatchMultiply(const float4x4* pLocal, const float4x4* pParent, float4x4* pOut, size_t Count);
+
+// Compone pLocal[i] * Parent y escribe el resultado directamente en el layout del buffer de
+// instancias (que puede ser memoria mapeada), junto con el selector de textura
+void BatchComposeInstances(const float4x4*   pLocal,
+                           const float*      pTexSelectors,
+                           const float4x4&   Parent,
+                           InstanceDataType* pDst,
+                           size_t            Count);
+
+} // namespace Diligent
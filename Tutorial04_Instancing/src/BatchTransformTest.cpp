@@ -0,0 +1,195 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+
+// Pruebas de los kernels de BatchTransform: cada conjunto de instrucciones soportado debe dar
+// el mismo resultado que float4x4::operator* de BasicMath, también con el stride de 68 bytes
+// del buffer de instancias y con números de matrices que no son múltiplo del ancho SIMD.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BatchTransform.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Números de matrices que cubren el caso vacío, uno suelto y restos de 1 a 3 respecto a 2 y 4
+const size_t TestCounts[] = {0, 1, 2, 3, 5, 7, 17, 24, 33};
+
+float4x4 MakeLocalMatrix(size_t i)
+{
+    const float f = static_cast<float>(i);
+    return float4x4::Scale(0.1f + 0.3f * f, 0.85f, 2.0f - 0.05f * f) *
+        float4x4::RotationX(0.3f * f) *
+        float4x4::RotationZ(-1.1f + 0.2f * f) *
+        float4x4::Translation(3.0f - f, 2.6f, -1.0f + 0.5f * f);
+}
+
+float4x4 MakeParentMatrix(size_t i)
+{
+    const float f = static_cast<float>(i);
+    return float4x4::RotationY(0.7f + 0.1f * f) * float4x4::Translation(8.0f, -0.4f * f, -16.0f);
+}
+
+void ExpectMatrixNear(const float4x4& Ref, const float4x4& Val, size_t Idx)
+{
+    for (int r = 0; r < 4; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            // FMA redondea una vez menos que el producto escalar
+            const float Tolerance = 1e-5f * std::max(1.f, std::abs(Ref.m[r][c]));
+            EXPECT_NEAR(Ref.m[r][c], Val.m[r][c], Tolerance) << "matriz " << Idx << ", fila " << r << ", columna " << c;
+        }
+    }
+}
+
+// Fija el kernel de matrices durante una prueba y restaura el anterior al terminar
+class ScopedBatchTransformISA
+{
+public:
+    explicit ScopedBatchTransformISA(BATCH_TRANSFORM_ISA ISA) :
+        m_PrevISA{GetBatchTransformISA()},
+        m_Applied{SetBatchTransformISA(ISA)}
+    {}
+    ~ScopedBatchTransformISA() { SetBatchTransformISA(m_PrevISA); }
+
+    bool IsApplied() const { return m_Applied; }
+
+private:
+    const BATCH_TRANSFORM_ISA m_PrevISA;
+    const bool                m_Applied;
+};
+
+class BatchTransformTest : public ::testing::TestWithParam<BATCH_TRANSFORM_ISA>
+{
+protected:
+    void SetUp() override
+    {
+        if (!IsBatchTransformISASupported(GetParam()))
+            GTEST_SKIP() << GetBatchTransformISAName(GetParam()) << " no está soportado en esta CPU";
+    }
+};
+
+TEST_P(BatchTransformTest, MultiplyByParent)
+{
+    ScopedBatchTransformISA ScopedISA{GetParam()};
+    ASSERT_TRUE(ScopedISA.IsApplied());
+
+    const float4x4 Parent = MakeParentMatrix(0);
+    for (size_t Count : TestCounts)
+    {
+        std::vector<float4x4> Local(Count);
+        for (size_t i = 0; i < Count; ++i)
+            Local[i] = MakeLocalMatrix(i);
+
+        // Una matriz más para detectar escrituras fuera de rango
+        std::vector<float4x4> Out(Count + 1, float4x4::Identity());
+        BatchMultiply(Local.data(), Parent, Out.data(), Count);
+        for (size_t i = 0; i < Count; ++i)
+            ExpectMatrixNear(Local[i] * Parent, Out[i], i);
+        ExpectMatrixNear(float4x4::Identity(), Out[Count], Count);
+    }
+}
+
+TEST_P(BatchTransformTest, MultiplyPairs)
+{
+    ScopedBatchTransformISA ScopedISA{GetParam()};
+    ASSERT_TRUE(ScopedISA.IsApplied());
+
+    for (size_t Count : TestCounts)
+    {
+        std::vector<float4x4> Local(Count), Parents(Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            Local[i]   = MakeLocalMatrix(i);
+            Parents[i] = MakeParentMatrix(i);
+        }
+
+        std::vector<float4x4> Out(Count + 1, float4x4::Identity());
+        BatchMultiply(Local.data(), Parents.data(), Out.data(), Count);
+        for (size_t i = 0; i < Count; ++i)
+            ExpectMatrixNear(Local[i] * Parents[i], Out[i], i);
+        ExpectMatrixNear(float4x4::Identity(), Out[Count], Count);
+    }
+}
+
+TEST_P(BatchTransformTest, ComposeInstances)
+{
+    static_assert(sizeof(InstanceDataType) == 68, "La prueba cubre el stride de 68 bytes del buffer de instancias");
+
+    ScopedBatchTransformISA ScopedISA{GetParam()};
+    ASSERT_TRUE(ScopedISA.IsApplied());
+
+    const float4x4 Parent = MakeParentMatrix(3);
+    for (size_t Count : TestCounts)
+    {
+        std::vector<float4x4> Local(Count);
+        std::vector<float>    TexSelectors(Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            Local[i]        = MakeLocalMatrix(i);
+            TexSelectors[i] = static_cast<float>(i % 3);
+        }
+
+        // Los elementos de 68 bytes dejan las matrices sin alinear a 16 bytes a partir del segundo
+        std::vector<InstanceDataType> Instances(Count + 1);
+        Instances[Count].Transform   = float4x4::Identity();
+        Instances[Count].TexSelector = -1.0f;
+        BatchComposeInstances(Local.data(), TexSelectors.data(), Parent, Instances.data(), Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            ExpectMatrixNear(Local[i] * Parent, Instances[i].Transform, i);
+            EXPECT_EQ(TexSelectors[i], Instances[i].TexSelector) << "instancia " << i;
+        }
+        ExpectMatrixNear(float4x4::Identity(), Instances[Count].Transform, Count);
+        EXPECT_EQ(-1.0f, Instances[Count].TexSelector);
+    }
+}
+
+// El conjunto que se elige por defecto debe estar soportado y también se comprueba arriba
+TEST(BatchTransformDefaultISA, IsSupported)
+{
+    EXPECT_TRUE(IsBatchTransformISASupported(GetBatchTransformISA()));
+}
+
+INSTANTIATE_TEST_SUITE_P(AllISAs,
+                         BatchTransformTest,
+                         ::testing::Values(BATCH_TRANSFORM_ISA_SCALAR, BATCH_TRANSFORM_ISA_SSE, BATCH_TRANSFORM_ISA_AVX2),
+                         [](const ::testing::TestParamInfo<BATCH_TRANSFORM_ISA>& Info) {
+                             return std::string{GetBatchTransformISAName(Info.param)};
+                         });
+
+} // namespace
@@ -0,0 +1,291 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint16 PackRGB565(const float (&Color)[3])
+{
+    const Uint32 R = static_cast<Uint32>(std::min(std::max(Color[0], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+    const Uint32 G = static_cast<Uint32>(std::min(std::max(Color[1], 0.f), 255.f) * 63.f / 255.f + 0.5f);
+    const Uint32 B = static_cast<Uint32>(std::min(std::max(Color[2], 0.f), 255.f) * 31.f / 255.f + 0.5f);
+    return static_cast<Uint16>((R << 11) | (G << 5) | B);
+}
+
+// Color que reconstruye el GPU a partir de un extremo 565 (replicando los bits altos)
+void UnpackRGB565(Uint16 Packed, int (&Color)[3])
+{
+    const int R = (Packed >> 11) & 31;
+    const int G = (Packed >> 5) & 63;
+    const int B = Packed & 31;
+    Color[0]    = (R << 3) | (R >> 2);
+    Color[1]    = (G << 2) | (G >> 4);
+    Color[2]    = (B << 3) | (B >> 2);
+}
+
+// Extremos de los colores del bloque a lo largo de su eje principal
+void FindColorEndpoints(const Uint8 (&Pixels)[16][4], float (&Max)[3], float (&Min)[3])
+{
+    float Mean[3] = {};
+    for (const auto& Pixel : Pixels)
+    {
+        for (int c = 0; c < 3; ++c)
+            Mean[c] += Pixel[c];
+    }
+    for (float& m : Mean)
+        m /= 16.f;
+
+    // Matriz de covarianza (simétrica: xx, xy, xz, yy, yz, zz)
+    float Cov[6] = {};
+    for (const auto& Pixel : Pixels)
+    {
+        const float d[3] = {Pixel[0] - Mean[0], Pixel[1] - Mean[1], Pixel[2] - Mean[2]};
+        Cov[0] += d[0] * d[0];
+        Cov[1] += d[0] * d[1];
+        Cov[2] += d[0] * d[2];
+        Cov[3] += d[1] * d[1];
+        Cov[4] += d[1] * d[2];
+        Cov[5] += d[2] * d[2];
+    }
+
+    // Iteración de potencias: unas pocas pasadas bastan para un bloque de 16 colores. Se empieza
+    // por la fila más larga de la covarianza, que no puede ser ortogonal a toda la variación del
+    // bloque: con (1, 1, 1) un bloque que solo cambia de tono sin cambiar de brillo (por ejemplo,
+    // de rojo a verde) da un producto nulo y se quedaba con el eje de la luminancia.
+    const float Rows[3][3] =
+    {
+        {Cov[0], Cov[1], Cov[2]},
+        {Cov[1], Cov[3], Cov[4]},
+        {Cov[2], Cov[4], Cov[5]}
+    };
+    int   SeedRow      = 0;
+    float SeedRowLenSq = 0;
+    for (int r = 0; r < 3; ++r)
+    {
+        const float LenSq = Rows[r][0] * Rows[r][0] + Rows[r][1] * Rows[r][1] + Rows[r][2] * Rows[r][2];
+        if (LenSq > SeedRowLenSq)
+        {
+            SeedRow      = r;
+            SeedRowLenSq = LenSq;
+        }
+    }
+    if (SeedRowLenSq < 1e-6f)
+    {
+        // Bloque de un solo color: cualquier eje sirve
+        for (int c = 0; c < 3; ++c)
+            Max[c] = Min[c] = Mean[c];
+        return;
+    }
+
+    float Axis[3] = {Rows[SeedRow][0], Rows[SeedRow][1], Rows[SeedRow][2]};
+    for (int i = 0; i < 8; ++i)
+    {
+        const float x = Axis[0] * Cov[0] + Axis[1] * Cov[1] + Axis[2] * Cov[2];
+        const float y = Axis[0] * Cov[1] + Axis[1] * Cov[3] + Axis[2] * Cov[4];
+        const float z = Axis[0] * Cov[2] + Axis[1] * Cov[4] + Axis[2] * Cov[5];
+        const float Len = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+        if (Len < 1e-6f)
+            break;
+        Axis[0] = x / Len;
+        Axis[1] = y / Len;
+        Axis[2] = z / Len;
+    }
+    const float AxisLenSq = Axis[0] * Axis[0] + Axis[1] * Axis[1] + Axis[2] * Axis[2];
+
+    float MinT = 0, MaxT = 0;
+    for (const auto& Pixel : Pixels)
+    {
+        const float t = ((Pixel[0] - Mean[0]) * Axis[0] + (Pixel[1] - Mean[1]) * Axis[1] + (Pixel[2] - Mean[2]) * Axis[2]) / AxisLenSq;
+        MinT          = std::min(MinT, t);
+        MaxT          = std::max(MaxT, t);
+    }
+
+    // Acercar los extremos 1/16 del rango, como hacen los compresores rápidos: los colores
+    // interpolados caen más cerca de los píxeles y se reduce el error medio
+    const float Inset = (MaxT - MinT) / 16.f;
+    MinT += Inset;
+    MaxT -= Inset;
+    for (int c = 0; c < 3; ++c)
+    {
+        Max[c] = Mean[c] + Axis[c] * MaxT;
+        Min[c] = Mean[c] + Axis[c] * MinT;
+    }
+}
+
+void WriteColorBlock(const Uint8 (&Pixels)[16][4], Uint8* pBlock)
+{
+    float Max[3], Min[3];
+    FindColorEndpoints(Pixels, Max, Min);
+
+    Uint16 Color0 = PackRGB565(Max);
+    Uint16 Color1 = PackRGB565(Min);
+    // Color0 > Color1 selecciona el modo de cuatro colores, sin transparencia
+    if (Color0 < Color1)
+        std::swap(Color0, Color1);
+
+    Uint32 Indices = 0;
+    if (Color0 != Color1)
+    {
+        int Palette[4][3];
+        UnpackRGB565(Color0, Palette[0]);
+        UnpackRGB565(Color1, Palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            Palette[2][c] = (2 * Palette[0][c] + Palette[1][c]) / 3;
+            Palette[3][c] = (Palette[0][c] + 2 * Palette[1][c]) / 3;
+        }
+
+        for (Uint32 i = 0; i < 16; ++i)
+        {
+            Uint32 BestIdx  = 0;
+            int    BestDist = INT32_MAX;
+            for (Uint32 p = 0; p < 4; ++p)
+            {
+                const int dr   = Pixels[i][0] - Palette[p][0];
+                const int dg   = Pixels[i][1] - Palette[p][1];
+                const int db   = Pixels[i][2] - Palette[p][2];
+                const int Dist = dr * dr + dg * dg + db * db;
+                if (Dist < BestDist)
+                {
+                    BestDist = Dist;
+                    BestIdx  = p;
+                }
+            }
+            Indices |= BestIdx << (i * 2);
+        }
+    }
+
+    pBlock[0] = static_cast<Uint8>(Color0 & 0xFF);
+    pBlock[1] = static_cast<Uint8>(Color0 >> 8);
+    pBlock[2] = static_cast<Uint8>(Color1 & 0xFF);
+    pBlock[3] = static_cast<Uint8>(Color1 >> 8);
+    for (Uint32 b = 0; b < 4; ++b)
+        pBlock[4 + b] = static_cast<Uint8>(Indices >> (b * 8));
+}
+
+// Bloque de alfa de BC3 en el modo de ocho valores interpolados
+void WriteAlphaBlock(const Uint8 (&Pixels)[16][4], Uint8* pBlock)
+{
+    int Alpha0 = 0, Alpha1 = 255;
+    for (const auto& Pixel : Pixels)
+    {
+        Alpha0 = std::max(Alpha0, static_cast<int>(Pixel[3]));
+        Alpha1 = std::min(Alpha1, static_cast<int>(Pixel[3]));
+    }
+
+    Uint64 Indices = 0;
+    if (Alpha0 != Alpha1)
+    {
+        int Palette[8] = {Alpha0, Alpha1};
+        for (int p = 1; p < 7; ++p)
+            Palette[p + 1] = ((7 - p) * Alpha0 + p * Alpha1) / 7;
+
+        for (Uint32 i = 0; i < 16; ++i)
+        {
+            Uint64 BestIdx  = 0;
+            int    BestDist = INT32_MAX;
+            for (Uint32 p = 0; p < 8; ++p)
+            {
+                const int Dist = std::abs(Pixels[i][3] - Palette[p]);
+                if (Dist < BestDist)
+                {
+                    BestDist = Dist;
+                    BestIdx  = p;
+                }
+            }
+            Indices |= BestIdx << (i * 3);
+        }
+    }
+
+    pBlock[0] = static_cast<Uint8>(Alpha0);
+    pBlock[1] = static_cast<Uint8>(Alpha1);
+    for (Uint32 b = 0; b < 6; ++b)
+        pBlock[2 + b] = static_cast<Uint8>(Indices >> (b * 8));
+}
+
+} // namespace
+
+void CompressBC1Block(const Uint8 (&Pixels)[16][4], Uint8* pBlock)
+{
+    WriteColorBlock(Pixels, pBlock);
+}
+
+void CompressBC3Block(const Uint8 (&Pixels)[16][4], Uint8* pBlock)
+{
+    WriteAlphaBlock(Pixels, pBlock);
+    WriteColorBlock(Pixels, pBlock + 8);
+}
+
+Uint32 GetCompressedImageSize(Uint32 Width, Uint32 Height, bool BC3)
+{
+    const Uint32 BlocksX = (Width + 3) / 4;
+    const Uint32 BlocksY = (Height + 3) / 4;
+    return BlocksX * BlocksY * (BC3 ? BC3BlockSize : BC1BlockSize);
+}
+
+std::vector<Uint8> CompressImageBC(const Uint8* pRGBA, Uint32 Width, Uint32 Height, bool BC3)
+{
+    std::vector<Uint8> Data(GetCompressedImageSize(Width, Height, BC3));
+
+    const Uint32 BlockSize = BC3 ? BC3BlockSize : BC1BlockSize;
+    Uint8*       pBlock    = Data.data();
+    for (Uint32 by = 0; by < Height; by += 4)
+    {
+        for (Uint32 bx = 0; bx < Width; bx += 4)
+        {
+            Uint8 Pixels[16][4];
+            for (Uint32 y = 0; y < 4; ++y)
+            {
+                for (Uint32 x = 0; x < 4; ++x)
+                {
+                    const Uint32 SrcX = std::min(bx + x, Width - 1);
+                    const Uint32 SrcY = std::min(by + y, Height - 1);
+                    std::memcpy(Pixels[y * 4 + x], pRGBA + (SrcY * Width + SrcX) * 4, 4);
+                }
+            }
+            if (BC3)
+                CompressBC3Block(Pixels, pBlock);
+            else
+                CompressBC1Block(Pixels, pBlock);
+            pBlock += BlockSize;
+        }
+    }
+    return Data;
+}
+
+} // namespace Diligent
@@ -0,0 +1,57 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Compresión BC1/BC3 (DXT1/DXT5) de imágenes RGBA8 para el conversor de texturas. Los extremos
+// de cada bloque se eligen sobre el eje principal de sus colores, que da una calidad razonable
+// sin la búsqueda iterativa de los compresores de producción.
+
+// Bytes por bloque de 4x4 píxeles
+static constexpr Uint32 BC1BlockSize = 8;
+static constexpr Uint32 BC3BlockSize = 16;
+
+// Comprime un bloque de 16 píxeles RGBA8 en orden de filas. BC1 ignora el alfa.
+void CompressBC1Block(const Uint8 (&Pixels)[16][4], Uint8* pBlock);
+void CompressBC3Block(const Uint8 (&Pixels)[16][4], Uint8* pBlock);
+
+// Comprime una imagen RGBA8 con filas de Width * 4 bytes. Los bloques que salen de la imagen
+// (mips de menos de 4 píxeles) repiten los píxeles del borde.
+std::vector<Uint8> CompressImageBC(const Uint8* pRGBA, Uint32 Width, Uint32 Height, bool BC3);
+
+// Tamaño en bytes de una imagen comprimida
+Uint32 GetCompressedImageSize(Uint32 Width, Uint32 Height, bool BC3);
+
+} // namespace Diligent
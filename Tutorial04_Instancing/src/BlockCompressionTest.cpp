@@ -0,0 +1,241 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+
+// Pruebas del compresor BC1/BC3 del conversor de texturas: extremos e índices de bloques con
+// resultado conocido y el error de los bloques decodificados como lo hace el GPU.
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BlockCompression.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+using BlockPixels = Uint8[16][4];
+
+struct RGB565
+{
+    Uint32 R = 0;
+    Uint32 G = 0;
+    Uint32 B = 0;
+};
+
+Uint16 ReadEndpoint(const Uint8* pBlock, Uint32 Idx)
+{
+    return static_cast<Uint16>(pBlock[Idx * 2] | (pBlock[Idx * 2 + 1] << 8));
+}
+
+RGB565 SplitRGB565(Uint16 Packed)
+{
+    const Uint32 Bits = Packed;
+    return RGB565{Bits >> 11u, (Bits >> 5u) & 63u, Bits & 31u};
+}
+
+Uint32 GetColorIndex(const Uint8* pBlock, Uint32 Pixel)
+{
+    return (pBlock[4 + Pixel / 4] >> ((Pixel % 4) * 2)) & 3u;
+}
+
+// Decodificación de un bloque de color BC1 en el modo de cuatro colores
+void DecodeColorBlock(const Uint8* pBlock, int (&Colors)[16][3])
+{
+    int Palette[4][3];
+    for (Uint32 e = 0; e < 2; ++e)
+    {
+        const RGB565 Endpoint = SplitRGB565(ReadEndpoint(pBlock, e));
+        Palette[e][0]         = static_cast<int>((Endpoint.R << 3) | (Endpoint.R >> 2));
+        Palette[e][1]         = static_cast<int>((Endpoint.G << 2) | (Endpoint.G >> 4));
+        Palette[e][2]         = static_cast<int>((Endpoint.B << 3) | (Endpoint.B >> 2));
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        Palette[2][c] = (2 * Palette[0][c] + Palette[1][c]) / 3;
+        Palette[3][c] = (Palette[0][c] + 2 * Palette[1][c]) / 3;
+    }
+
+    for (Uint32 i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+            Colors[i][c] = Palette[GetColorIndex(pBlock, i)][c];
+    }
+}
+
+int GetMaxColorError(const BlockPixels& Pixels, const Uint8* pBlock)
+{
+    int Colors[16][3];
+    DecodeColorBlock(pBlock, Colors);
+
+    int MaxError = 0;
+    for (Uint32 i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+            MaxError = std::max(MaxError, std::abs(Colors[i][c] - Pixels[i][c]));
+    }
+    return MaxError;
+}
+
+void FillBlock(BlockPixels& Pixels, Uint8 R, Uint8 G, Uint8 B, Uint8 A)
+{
+    for (auto& Pixel : Pixels)
+    {
+        Pixel[0] = R;
+        Pixel[1] = G;
+        Pixel[2] = B;
+        Pixel[3] = A;
+    }
+}
+
+// Rampa que cambia de tono sin cambiar de brillo: R + G es constante. Con el eje inicial
+// (1, 1, 1) la iteración de potencias se quedaba con un eje nulo y los dos extremos eran el
+// gris medio.
+TEST(BlockCompressionTest, RedToGreenRamp)
+{
+    BlockPixels Pixels;
+    for (Uint32 i = 0; i < 16; ++i)
+    {
+        Pixels[i][0] = static_cast<Uint8>(17 * i);
+        Pixels[i][1] = static_cast<Uint8>(255 - 17 * i);
+        Pixels[i][2] = 128;
+        Pixels[i][3] = 255;
+    }
+
+    Uint8 Block[BC1BlockSize] = {};
+    CompressBC1Block(Pixels, Block);
+
+    const RGB565 Color0 = SplitRGB565(ReadEndpoint(Block, 0));
+    const RGB565 Color1 = SplitRGB565(ReadEndpoint(Block, 1));
+    EXPECT_EQ(29u, Color0.R);
+    EXPECT_EQ(4u, Color0.G);
+    EXPECT_EQ(16u, Color0.B);
+    EXPECT_EQ(2u, Color1.R);
+    EXPECT_EQ(59u, Color1.G);
+    EXPECT_EQ(16u, Color1.B);
+
+    // Cuatro píxeles por color de la paleta, de verde (Color1) a rojo (Color0)
+    const Uint32 ExpectedIndices[4] = {1, 3, 2, 0};
+    for (Uint32 i = 0; i < 16; ++i)
+        EXPECT_EQ(ExpectedIndices[i / 4], GetColorIndex(Block, i)) << "píxel " << i;
+
+    EXPECT_LE(GetMaxColorError(Pixels, Block), 40);
+}
+
+TEST(BlockCompressionTest, FlatBlock)
+{
+    BlockPixels Pixels;
+    FillBlock(Pixels, 200, 100, 50, 255);
+
+    Uint8 Block[BC1BlockSize];
+    std::fill(std::begin(Block), std::end(Block), Uint8{0xCD});
+    CompressBC1Block(Pixels, Block);
+
+    // Un solo color: los dos extremos son iguales y todos los índices son 0
+    EXPECT_EQ(ReadEndpoint(Block, 0), ReadEndpoint(Block, 1));
+    const RGB565 Color = SplitRGB565(ReadEndpoint(Block, 0));
+    EXPECT_EQ(24u, Color.R); // 200 * 31 / 255 = 24.3
+    EXPECT_EQ(25u, Color.G); // 100 * 63 / 255 = 24.7
+    EXPECT_EQ(6u, Color.B);  // 50 * 31 / 255 = 6.1
+    for (Uint32 i = 0; i < 16; ++i)
+        EXPECT_EQ(0u, GetColorIndex(Block, i)) << "píxel " << i;
+}
+
+TEST(BlockCompressionTest, TwoColorBlock)
+{
+    // Tablero de dos colores que no están en la diagonal del gris
+    BlockPixels Pixels;
+    for (Uint32 i = 0; i < 16; ++i)
+    {
+        const bool Light = ((i / 4) + i) % 2 == 0;
+        Pixels[i][0]     = Light ? 240 : 16;
+        Pixels[i][1]     = Light ? 200 : 40;
+        Pixels[i][2]     = Light ? 32 : 160;
+        Pixels[i][3]     = 255;
+    }
+
+    Uint8 Block[BC1BlockSize] = {};
+    CompressBC1Block(Pixels, Block);
+
+    // Color0 > Color1 selecciona el modo de cuatro colores; cada píxel usa su extremo
+    const Uint16 Color0 = ReadEndpoint(Block, 0);
+    const Uint16 Color1 = ReadEndpoint(Block, 1);
+    EXPECT_GT(Color0, Color1);
+    for (Uint32 i = 0; i < 16; ++i)
+    {
+        const bool Light = Pixels[i][0] == 240;
+        EXPECT_EQ(Light ? 0u : 1u, GetColorIndex(Block, i)) << "píxel " << i;
+    }
+    EXPECT_LE(GetMaxColorError(Pixels, Block), 24);
+}
+
+TEST(BlockCompressionTest, BC3Alpha)
+{
+    BlockPixels Pixels;
+    FillBlock(Pixels, 64, 128, 192, 0);
+    for (Uint32 i = 0; i < 16; ++i)
+        Pixels[i][3] = static_cast<Uint8>(i * 17);
+
+    Uint8 Block[BC3BlockSize] = {};
+    CompressBC3Block(Pixels, Block);
+
+    // Alfa en el modo de ocho valores: el máximo primero; 0 y 255 se reproducen exactos
+    EXPECT_EQ(255, Block[0]);
+    EXPECT_EQ(0, Block[1]);
+
+    Uint64 AlphaIndices = 0;
+    for (Uint32 b = 0; b < 6; ++b)
+        AlphaIndices |= Uint64{Block[2 + b]} << (b * 8);
+    EXPECT_EQ(1u, AlphaIndices & 7u);         // Alfa 0
+    EXPECT_EQ(0u, (AlphaIndices >> 45) & 7u); // Alfa 255
+
+    // El bloque de color va detrás y no depende del alfa
+    Uint8 ColorBlock[BC1BlockSize] = {};
+    CompressBC1Block(Pixels, ColorBlock);
+    EXPECT_TRUE(std::equal(std::begin(ColorBlock), std::end(ColorBlock), Block + 8));
+}
+
+TEST(BlockCompressionTest, ImageSize)
+{
+    EXPECT_EQ(8u, GetCompressedImageSize(1, 1, false));
+    EXPECT_EQ(16u, GetCompressedImageSize(1, 1, true));
+    EXPECT_EQ(2u * 1u * BC1BlockSize, GetCompressedImageSize(5, 3, false));
+    EXPECT_EQ(64u * 64u * BC3BlockSize, GetCompressedImageSize(256, 256, true));
+
+    // Los bloques que salen de la imagen repiten el borde: una imagen de 2x2 de un color es un bloque plano
+    const std::vector<Uint8> RGBA(2 * 2 * 4, 100);
+    const std::vector<Uint8> Data = CompressImageBC(RGBA.data(), 2, 2, false);
+    ASSERT_EQ(BC1BlockSize, Data.size());
+    EXPECT_EQ(ReadEndpoint(Data.data(), 0), ReadEndpoint(Data.data(), 1));
+}
+
+} // namespace
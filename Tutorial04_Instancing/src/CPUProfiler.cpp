@@ -0,0 +1,165 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+#include "CPUProfiler.hpp"
+
+namespace Diligent
+{
+
+namespace CPUProfiler
+{
+
+namespace
+{
+
+// Anillos de todos los hilos que han registrado alguna zona. Solo se bloquea al registrar un
+// hilo nuevo y al exportar; los anillos viven hasta el final del programa.
+struct RingRegistry
+{
+    std::mutex                                    Mtx;
+    std::vector<std::unique_ptr<ThreadEventRing>> Rings;
+};
+
+RingRegistry& GetRegistry()
+{
+    static RingRegistry Registry;
+    return Registry;
+}
+
+ThreadEventRing& GetThreadRing()
+{
+    thread_local ThreadEventRing* pRing = nullptr;
+    if (pRing == nullptr)
+    {
+        RingRegistry&               Registry = GetRegistry();
+        std::lock_guard<std::mutex> Lock{Registry.Mtx};
+        Registry.Rings.emplace_back(new ThreadEventRing{static_cast<Uint32>(Registry.Rings.size())});
+        pRing = Registry.Rings.back().get();
+    }
+    return *pRing;
+}
+
+void WriteEscaped(std::FILE* pFile, const char* Str)
+{
+    for (; *Str != '\0'; ++Str)
+    {
+        if (*Str == '"' || *Str == '\\')
+            std::fputc('\\', pFile);
+        std::fputc(*Str, pFile);
+    }
+}
+
+} // namespace
+
+void ThreadEventRing::Snapshot(std::vector<ZoneEvent>& Events) const
+{
+    const Uint64 Head  = m_Head.load(std::memory_order_acquire);
+    Uint64       First = Head > Capacity ? Head - Capacity : 0;
+
+    const size_t Start = Events.size();
+    for (Uint64 i = First; i < Head; ++i)
+        Events.push_back(m_Events[i & (Capacity - 1)]);
+
+    // La valla impide que las lecturas de la copia se muevan detrás de la nueva lectura de la
+    // cabeza. El hilo escribe en la posición NewHead antes de publicarla, y esa posición es la
+    // del evento NewHead - Capacity: los eventos anteriores a NewHead + 1 - Capacity se han
+    // podido sobrescribir (o estar a medio escribir) durante la copia.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const Uint64 NewHead    = m_Head.load(std::memory_order_relaxed);
+    const Uint64 FirstValid = NewHead + 1 > Capacity ? NewHead + 1 - Capacity : 0;
+    if (FirstValid > First)
+    {
+        const Uint64 NumOverwritten = std::min(FirstValid - First, Head - First);
+        Events.erase(Events.begin() + Start, Events.begin() + Start + static_cast<size_t>(NumOverwritten));
+    }
+}
+
+Uint64 GetTimeNs()
+{
+    using namespace std::chrono;
+    return static_cast<Uint64>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void RecordZone(const char* Name, Uint64 BeginNs, Uint64 EndNs)
+{
+    GetThreadRing().Push({Name, BeginNs, EndNs});
+}
+
+int ExportChromeTrace(const char* FilePath)
+{
+    std::FILE* pFile = std::fopen(FilePath, "w");
+    if (pFile == nullptr)
+        return -1;
+
+    // Eventos por hilo; los tiempos se escriben en microsegundos desde el evento más antiguo
+    std::vector<std::vector<ZoneEvent>> ThreadEvents;
+    {
+        RingRegistry&               Registry = GetRegistry();
+        std::lock_guard<std::mutex> Lock{Registry.Mtx};
+        ThreadEvents.resize(Registry.Rings.size());
+        for (const auto& pRing : Registry.Rings)
+            pRing->Snapshot(ThreadEvents[pRing->GetThreadIdx()]);
+    }
+
+    Uint64 OriginNs = ~Uint64{0};
+    for (const auto& Events : ThreadEvents)
+    {
+        for (const ZoneEvent& Event : Events)
+            OriginNs = std::min(OriginNs, Event.BeginNs);
+    }
+
+    int NumEvents = 0;
+    std::fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (size_t Thread = 0; Thread < ThreadEvents.size(); ++Thread)
+    {
+        std::fprintf(pFile, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Hilo %u\"}}",
+                     Thread == 0 ? "" : ",", static_cast<Uint32>(Thread), static_cast<Uint32>(Thread));
+        for (const ZoneEvent& Event : ThreadEvents[Thread])
+        {
+            std::fprintf(pFile, ",\n{\"name\":\"");
+            WriteEscaped(pFile, Event.Name);
+            std::fprintf(pFile, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         static_cast<Uint32>(Thread),
+                         static_cast<double>(Event.BeginNs - OriginNs) / 1000.0,
+                         static_cast<double>(Event.EndNs - Event.BeginNs) / 1000.0);
+            ++NumEvents;
+        }
+    }
+    std::fprintf(pFile, "\n]}\n");
+    std::fclose(pFile);
+    return NumEvents;
+}
+
+} // namespace CPUProfiler
+
+} // namespace Diligent
@@ -0,0 +1,136 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "BasicTypes.h"
+
+// Perfil del CPU: cada zona con ámbito registra su inicio y su fin en un anillo propio del hilo
+// que la ejecuta, sin bloqueos; ExportChromeTrace() vuelca los eventos de todos los hilos en el
+// formato JSON de chrome://tracing y Perfetto. Con TUTORIAL04_CPU_PROFILER a 0 (la opción
+// TUTORIAL04_ENABLE_CPU_PROFILER de CMake lo pone a 1) las macros no generan código.
+#ifndef TUTORIAL04_CPU_PROFILER
+#    define TUTORIAL04_CPU_PROFILER 0
+#endif
+
+namespace Diligent
+{
+
+namespace CPUProfiler
+{
+
+struct ZoneEvent
+{
+    const char* Name    = nullptr; // Literal: solo se guarda el puntero
+    Uint64      BeginNs = 0;
+    Uint64      EndNs   = 0;
+};
+
+// Anillo de eventos de un hilo. Solo lo escribe su hilo; el índice de escritura es atómico para
+// que la exportación pueda leerlo desde otro hilo sin detener al que escribe. Cuando se llena,
+// los eventos más antiguos se sobrescriben.
+class ThreadEventRing
+{
+public:
+    static constexpr Uint32 Capacity = 1u << 16;
+
+    explicit ThreadEventRing(Uint32 ThreadIdx) :
+        m_Events{new ZoneEvent[Capacity]},
+        m_ThreadIdx{ThreadIdx}
+    {}
+
+    void Push(const ZoneEvent& Event)
+    {
+        const Uint64 Head = m_Head.load(std::memory_order_relaxed);
+
+        m_Events[Head & (Capacity - 1)] = Event;
+        m_Head.store(Head + 1, std::memory_order_release);
+    }
+
+    // Copia los eventos del anillo y descarta los que el hilo ha podido sobrescribir mientras
+    void Snapshot(std::vector<ZoneEvent>& Events) const;
+
+    Uint32 GetThreadIdx() const { return m_ThreadIdx; }
+
+private:
+    std::unique_ptr<ZoneEvent[]> m_Events;
+    std::atomic<Uint64>          m_Head{0};
+    const Uint32                 m_ThreadIdx;
+};
+
+Uint64 GetTimeNs();
+
+// Añade el evento al anillo del hilo actual; el primer evento de cada hilo registra su anillo
+void RecordZone(const char* Name, Uint64 BeginNs, Uint64 EndNs);
+
+// Escribe los eventos de todos los hilos en FilePath. Devuelve el número de eventos escritos,
+// o -1 si no se ha podido crear el archivo.
+int ExportChromeTrace(const char* FilePath);
+
+class ScopedZone
+{
+public:
+    explicit ScopedZone(const char* Name) :
+        m_Name{Name},
+        m_BeginNs{GetTimeNs()}
+    {}
+
+    ~ScopedZone()
+    {
+        RecordZone(m_Name, m_BeginNs, GetTimeNs());
+    }
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+    const char* const m_Name;
+    const Uint64      m_BeginNs;
+};
+
+} // namespace CPUProfiler
+
+} // namespace Diligent
+
+// Mide el resto del ámbito actual con el nombre Name (cadena con duración estática: solo se guarda el puntero)
+#if TUTORIAL04_CPU_PROFILER
+#    define CPU_PROFILER_CONCAT_IMPL(A, B) A##B
+#    define CPU_PROFILER_CONCAT(A, B)      CPU_PROFILER_CONCAT_IMPL(A, B)
+#    define CPU_PROFILE_ZONE(Name)         ::Diligent::CPUProfiler::ScopedZone CPU_PROFILER_CONCAT(CPUProfileZone_, __LINE__){Name}
+#else
+// sizeof no evalúa el nombre, pero evita avisos por variables que solo usa la zona
+#    define CPU_PROFILE_ZONE(Name) \
+        do                         \
+        {                          \
+            (void)sizeof(Name);    \
+        } while (false)
+#endif
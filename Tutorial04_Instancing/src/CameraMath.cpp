@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <cmath>
+
+#include "CameraMath.hpp"
+
+namespace Diligent
+{
+
+float4x4 GetPanZoomViewMatrix(const CameraParams& Cam)
+{
+    return float4x4::Translation(Cam.PanOffset.x, Cam.PanOffset.y, 0.0f) *
+           float4x4::Scale(Cam.Zoom, Cam.Zoom, Cam.Zoom) *
+           float4x4::RotationX(-0.8f) *
+           float4x4::Translation(0.f, 0.f, 20.0f);
+}
+
+float4x4 GetOrbitViewMatrix(const CameraParams& Cam)
+{
+    // La escala con Y negativo voltea el móvil verticalmente para corregir la orientación
+    return float4x4::Translation(0.0f, 0.0f, -Cam.OrbitDistance) *
+           float4x4::RotationX(Cam.OrbitAngleX) *
+           float4x4::RotationY(Cam.OrbitAngleY) *
+           float4x4::Scale(1.0f, -1.0f, 1.0f);
+}
+
+float4x4 GetFreeViewMatrix(const CameraParams& Cam)
+{
+    const float4x4 Rotation = float4x4::RotationZ(Cam.RotZ) *
+                              float4x4::RotationY(Cam.RotY) *
+                              float4x4::RotationX(Cam.RotX);
+
+    // Un factor de escala muy pequeño aleja radicalmente la vista
+    return Rotation *
+           float4x4::Scale(Cam.ViewZoom, Cam.ViewZoom, Cam.ViewZoom) *
+           float4x4::Translation(-Cam.Position.x, -Cam.Position.y, -Cam.Position.z);
+}
+
+float3 GetPanZoomCameraPosition(const CameraParams& Cam)
+{
+    return float3{Cam.PanOffset.x, Cam.PanOffset.y, 20.0f / Cam.Zoom};
+}
+
+float3 GetOrbitCameraPosition(const CameraParams& Cam)
+{
+    float3 Dir;
+    Dir.x = -std::sin(Cam.OrbitAngleY) * std::cos(Cam.OrbitAngleX);
+    Dir.y = -std::sin(Cam.OrbitAngleX);
+    Dir.z = -std::cos(Cam.OrbitAngleY) * std::cos(Cam.OrbitAngleX);
+    return -normalize(Dir) * Cam.OrbitDistance;
+}
+
+float3 GetFreeCameraPosition(const CameraParams& Cam)
+{
+    return Cam.Position;
+}
+
+} // namespace Diligent
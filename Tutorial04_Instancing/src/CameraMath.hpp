@@ -0,0 +1,66 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Parámetros de las tres cámaras del tutorial. Cada ventana usa sólo los suyos.
+struct CameraParams
+{
+    // Ventana 1: paneo y zoom
+    float2 PanOffset = {0.0f, 0.0f};
+    float  Zoom      = 1.0f;
+
+    // Ventana 2: control orbital
+    float OrbitAngleX   = -0.8f;
+    float OrbitAngleY   = 0.0f;
+    float OrbitDistance = 20.0f;
+
+    // Ventana 3: cámara libre
+    float3 Position = {0.0f, 0.0f, 20.0f};
+    float  RotX     = 0.0f;
+    float  RotY     = 0.0f;
+    float  RotZ     = 0.0f;
+    float  ViewZoom = 0.01f; // Factor de zoom para la ventana 3
+};
+
+// Matrices de vista de cada cámara (convención v * M de BasicMath)
+float4x4 GetPanZoomViewMatrix(const CameraParams& Cam);
+float4x4 GetOrbitViewMatrix(const CameraParams& Cam);
+float4x4 GetFreeViewMatrix(const CameraParams& Cam);
+
+// Posición aproximada de la cámara para la iluminación especular
+float3 GetPanZoomCameraPosition(const CameraParams& Cam);
+float3 GetOrbitCameraPosition(const CameraParams& Cam);
+float3 GetFreeCameraPosition(const CameraParams& Cam);
+
+} // namespace Diligent
@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Estructuras de constantes con la misma disposición que los cbuffer de los shaders (reglas de
+// empaquetado de HLSL: un float4 nunca cruza un límite de 16 bytes). Todas se escriben cada frame
+// a través de TransientConstantAllocator.
+
+// cube_inst_lighting.vsh: Constants (uno por vista)
+struct CubeVSConstants
+{
+    float4x4 ViewProj;
+    float4x4 Rotation;
+    float4   LightDir;
+    float4   CameraPos;
+};
+static_assert(sizeof(CubeVSConstants) == 160, "CubeVSConstants no coincide con el cbuffer Constants");
+
+// cube_inst_lighting.psh y floor.psh: PSConstants
+struct CubePSConstants
+{
+    float    BlendFactor = 0;
+    float    Padding0[3] = {};
+    float4   LightDir;
+    float4   LightColor;
+    float4   AmbientColor;
+    float    SpecularPower     = 0;
+    float    SpecularIntensity = 0;
+    float    Padding1[2]       = {};
+    float4x4 LightViewProj; // Traspuesta: el shader la aplica con mul(v, M)
+    float4   ShadowParams;  // x: tamaño del texel en UV, y: sesgo de profundidad, z: SHADOW_MODE, w: varianza mínima
+};
+static_assert(sizeof(CubePSConstants) == 160, "CubePSConstants no coincide con el cbuffer PSConstants");
+
+// shadowmap.vsh: Constants
+struct ShadowVSConstants
+{
+    float4x4 LightViewProj;
+    float4x4 Rotation;
+};
+static_assert(sizeof(ShadowVSConstants) == 128, "ShadowVSConstants no coincide con el cbuffer Constants");
+
+// floor.vsh: Constants (también en la pasada de sombras del suelo)
+struct FloorVSConstants
+{
+    float4x4 Model;
+    float4x4 ViewProj;
+};
+static_assert(sizeof(FloorVSConstants) == 128, "FloorVSConstants no coincide con el cbuffer Constants");
+
+// cube_inst_multiview.vsh y floor_multiview.vsh: MultiViewConstants (una matriz por ventana)
+struct MultiViewConstants
+{
+    float4x4 ViewProj[3];
+    float4x4 Rotation;
+    float4   CameraPos[3];
+};
+static_assert(sizeof(MultiViewConstants) == 304, "MultiViewConstants no coincide con el cbuffer MultiViewConstants");
+
+// mobile_anim.csh: AnimConstants
+struct MobileAnimConstants
+{
+    float4 Rotations;  // x: rotación principal, y: primer nivel, z: segundo nivel, w: separación
+    uint4  GridParams; // x: tamaño de la rejilla, y: piezas por móvil, z: número de instancias
+};
+static_assert(sizeof(MobileAnimConstants) == 32, "MobileAnimConstants no coincide con el cbuffer AnimConstants");
+
+// vsm_blur.csh: VSMBlurConstants
+struct VSMBlurConstants
+{
+    int4 BlurParams; // x: radio del filtro en texels, y: tamaño del mapa en texels
+};
+static_assert(sizeof(VSMBlurConstants) == 16, "VSMBlurConstants no coincide con el cbuffer VSMBlurConstants");
+
+// instance_cull.csh: CullConstants (una matriz por ventana)
+struct CullConstants
+{
+    float4x4 ViewProj[3];
+    uint4    CullParams; // x: número de instancias, y: capacidad de cada segmento
+};
+static_assert(sizeof(CullConstants) == 208, "CullConstants no coincide con el cbuffer CullConstants");
+
+} // namespace Diligent
@@ -0,0 +1,166 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "GPUPassProfiler.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void GPUPassProfiler::Initialize(IRenderDevice* pDevice, Uint32 NumPasses)
+{
+    const DeviceFeatures& Features = pDevice->GetDeviceInfo().Features;
+    // Tras crear el dispositivo cada característica está activada o desactivada; las que no se
+    // pidieron en Tutorial04_Instancing::ModifyEngineInitInfo() siempre están desactivadas
+    m_Timestamps         = Features.TimestampQueries == DEVICE_FEATURE_STATE_ENABLED;
+    m_PipelineStatistics = m_Timestamps && Features.PipelineStatisticsQueries == DEVICE_FEATURE_STATE_ENABLED;
+
+    m_Queries.clear();
+    m_Average.assign(NumPasses, {});
+    m_Total.assign(NumPasses, {});
+    m_NumSamples.assign(NumPasses, 0);
+    m_NumTotalSamples.assign(NumPasses, 0);
+    m_LastSampleFrame.assign(NumPasses, 0);
+    m_Frame = 0;
+    if (!m_Timestamps)
+        return;
+
+    m_Queries.resize(size_t{NumFramesInFlight} * NumPasses);
+    for (PassQueries& Queries : m_Queries)
+    {
+        QueryDesc Desc;
+        Desc.Name = "GPU pass profiler timestamp";
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        pDevice->CreateQuery(Desc, &Queries.pBegin);
+        pDevice->CreateQuery(Desc, &Queries.pEnd);
+        if (m_PipelineStatistics)
+        {
+            Desc.Name = "GPU pass profiler pipeline statistics";
+            Desc.Type = QUERY_TYPE_PIPELINE_STATISTICS;
+            pDevice->CreateQuery(Desc, &Queries.pStats);
+        }
+    }
+}
+
+void GPUPassProfiler::BeginFrame()
+{
+    ++m_Frame;
+    if (!m_Timestamps)
+        return;
+
+    const Uint32 NumPasses = GetNumPasses();
+    PassQueries* pSlot     = &m_Queries[(m_Frame % NumFramesInFlight) * NumPasses];
+    for (Uint32 Pass = 0; Pass < NumPasses; ++Pass)
+    {
+        if (pSlot[Pass].Issued)
+            ReadBack(Pass, pSlot[Pass]);
+        pSlot[Pass].Issued = false;
+    }
+}
+
+void GPUPassProfiler::BeginPass(IDeviceContext* pContext, Uint32 Pass)
+{
+    if (!m_Timestamps)
+        return;
+
+    PassQueries& Queries = m_Queries[(m_Frame % NumFramesInFlight) * GetNumPasses() + Pass];
+    VERIFY(!Queries.Issued, "Cada pasada se mide como mucho una vez por frame");
+    pContext->EndQuery(Queries.pBegin);
+    if (Queries.pStats)
+        pContext->BeginQuery(Queries.pStats);
+}
+
+void GPUPassProfiler::EndPass(IDeviceContext* pContext, Uint32 Pass)
+{
+    if (!m_Timestamps)
+        return;
+
+    PassQueries& Queries = m_Queries[(m_Frame % NumFramesInFlight) * GetNumPasses() + Pass];
+    if (Queries.pStats)
+        pContext->EndQuery(Queries.pStats);
+    pContext->EndQuery(Queries.pEnd);
+    Queries.Issued = true;
+}
+
+void GPUPassProfiler::ReadBack(Uint32 Pass, PassQueries& Queries)
+{
+    // GetData() no espera: si el GPU aún no ha llegado a este frame la muestra se pierde
+    QueryDataTimestamp Begin, End;
+    if (!Queries.pBegin->GetData(&Begin, sizeof(Begin)) || !Queries.pEnd->GetData(&End, sizeof(End)) || End.Frequency == 0)
+        return;
+
+    PassStats Sample;
+    Sample.TimeMs = static_cast<double>(End.Counter - Begin.Counter) * 1000.0 / static_cast<double>(End.Frequency);
+    if (Queries.pStats)
+    {
+        QueryDataPipelineStatistics Stats;
+        if (!Queries.pStats->GetData(&Stats, sizeof(Stats)))
+            return;
+        Sample.Vertices      = static_cast<double>(Stats.InputVertices);
+        Sample.Primitives    = static_cast<double>(Stats.InputPrimitives);
+        Sample.PSInvocations = static_cast<double>(Stats.PSInvocations);
+    }
+
+    // Media móvil exponencial; la primera muestra la inicializa
+    PassStats&   Avg    = m_Average[Pass];
+    const double Weight = m_NumSamples[Pass] > 0 ? 0.05 : 1.0;
+    Avg.TimeMs += (Sample.TimeMs - Avg.TimeMs) * Weight;
+    Avg.Vertices += (Sample.Vertices - Avg.Vertices) * Weight;
+    Avg.Primitives += (Sample.Primitives - Avg.Primitives) * Weight;
+    Avg.PSInvocations += (Sample.PSInvocations - Avg.PSInvocations) * Weight;
+    ++m_NumSamples[Pass];
+    m_LastSampleFrame[Pass] = m_Frame;
+
+    PassStats& Total = m_Total[Pass];
+    Total.TimeMs += Sample.TimeMs;
+    Total.Vertices += Sample.Vertices;
+    Total.Primitives += Sample.Primitives;
+    Total.PSInvocations += Sample.PSInvocations;
+    ++m_NumTotalSamples[Pass];
+}
+
+GPUPassProfiler::PassStats GPUPassProfiler::GetMean(Uint32 Pass) const
+{
+    PassStats Mean;
+    if (const Uint32 NumSamples = m_NumTotalSamples[Pass])
+    {
+        Mean.TimeMs        = m_Total[Pass].TimeMs / NumSamples;
+        Mean.Vertices      = m_Total[Pass].Vertices / NumSamples;
+        Mean.Primitives    = m_Total[Pass].Primitives / NumSamples;
+        Mean.PSInvocations = m_Total[Pass].PSInvocations / NumSamples;
+    }
+    return Mean;
+}
+
+void GPUPassProfiler::ResetTotals()
+{
+    m_Total.assign(m_Total.size(), {});
+    m_NumTotalSamples.assign(m_NumTotalSamples.size(), 0);
+}
+
+} // namespace Diligent
@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+// Perfil del GPU por pasada: un par de timestamps y, si el dispositivo las admite, una consulta
+// de estadísticas del pipeline alrededor de cada pasada. Cada frame usa su propio juego de
+// consultas y los resultados se leen NumFramesInFlight frames después sin esperar al GPU: si
+// todavía no están disponibles, la muestra se descarta.
+// Las consultas de estadísticas no pueden anidarse, así que las pasadas de un mismo contexto no
+// deben solaparse. Solo se admite el contexto inmediato.
+class GPUPassProfiler
+{
+public:
+    static constexpr Uint32 NumFramesInFlight = 4;
+
+    struct PassStats
+    {
+        double TimeMs        = 0;
+        double Vertices      = 0; // Vértices leídos por el input assembler
+        double Primitives    = 0; // Primitivas leídas por el input assembler
+        double PSInvocations = 0;
+    };
+
+    void Initialize(IRenderDevice* pDevice, Uint32 NumPasses);
+
+    // Lee los resultados del juego de consultas que va a reutilizar este frame
+    void BeginFrame();
+
+    void BeginPass(IDeviceContext* pContext, Uint32 Pass);
+    void EndPass(IDeviceContext* pContext, Uint32 Pass);
+
+    bool IsSupported() const { return m_Timestamps; }
+    bool HasPipelineStatistics() const { return m_PipelineStatistics; }
+    Uint32 GetNumPasses() const { return static_cast<Uint32>(m_Average.size()); }
+
+    // Media móvil de las últimas muestras
+    const PassStats& GetAverage(Uint32 Pass) const { return m_Average[Pass]; }
+    // La pasada se ha medido recientemente (por ejemplo, no pertenece a otro modo de render)
+    bool IsActive(Uint32 Pass) const { return m_NumSamples[Pass] > 0 && m_LastSampleFrame[Pass] + 2 * NumFramesInFlight >= m_Frame; }
+
+    // Media exacta de todas las muestras desde el último ResetTotals()
+    PassStats GetMean(Uint32 Pass) const;
+    Uint32    GetNumSamples(Uint32 Pass) const { return m_NumTotalSamples[Pass]; }
+    void      ResetTotals();
+
+private:
+    struct PassQueries
+    {
+        RefCntAutoPtr<IQuery> pBegin;
+        RefCntAutoPtr<IQuery> pEnd;
+        RefCntAutoPtr<IQuery> pStats;
+        bool                  Issued = false;
+    };
+
+    void ReadBack(Uint32 Pass, PassQueries& Queries);
+
+    std::vector<PassQueries> m_Queries; // NumFramesInFlight juegos de NumPasses pasadas
+    std::vector<PassStats>   m_Average;
+    std::vector<PassStats>   m_Total;
+    std::vector<Uint32>      m_NumSamples;
+    std::vector<Uint32>      m_NumTotalSamples;
+    std::vector<Uint64>      m_LastSampleFrame;
+
+    Uint64 m_Frame              = 0;
+    bool   m_Timestamps         = false;
+    bool   m_PipelineStatistics = false;
+};
+
+} // namespace Diligent
@@ -0,0 +1,525 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Benchmark sin ventana: renderiza un número fijo de frames de la escena en un render target
+// propio, con un paso de tiempo fijo para que la animación sea determinista, y escribe los
+// tiempos de cada frame en un CSV. Con Vulkan por software (lavapipe) funciona en máquinas
+// de integración continua sin GPU.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Tutorial04_Instancing.hpp"
+#include "Timer.hpp"
+#include "CPUProfiler.hpp"
+
+#if VULKAN_SUPPORTED
+#    include "Graphics/GraphicsEngineVulkan/interface/EngineFactoryVk.h"
+#endif
+#if D3D11_SUPPORTED
+#    include "Graphics/GraphicsEngineD3D11/interface/EngineFactoryD3D11.h"
+#endif
+#if D3D12_SUPPORTED
+#    include "Graphics/GraphicsEngineD3D12/interface/EngineFactoryD3D12.h"
+#endif
+
+using namespace Diligent;
+
+namespace
+{
+
+struct BenchmarkArgs
+{
+    RENDER_DEVICE_TYPE DeviceType  = RENDER_DEVICE_TYPE_VULKAN;
+    const char*        BackendName = "vk";
+    Uint32             NumFrames   = 600;
+    Uint32             NumWarmup   = 60; // No se escriben en el CSV
+    Uint32             Width       = 1280;
+    Uint32             Height      = 720;
+    Uint32             GridSize    = 1;
+    Uint32             NumViews    = 3;
+    const char*        CSVPath     = "tutorial04_benchmark.csv";
+    const char*        PassCSVPath = "tutorial04_passes.csv";
+    const char*        TracePath   = nullptr; // Traza del perfil del CPU (TUTORIAL04_CPU_PROFILER)
+    const char*        AssetsDir   = nullptr;
+    const char*        StateCache  = nullptr; // nullptr: ruta por defecto del sample
+    Uint32             FrameRate   = 60;      // Frecuencia de presentación simulada
+    Uint32             TickRate    = 60;      // Ticks por segundo de la simulación
+    Uint32             Reuse       = 0;       // Reutilizar las instancias entre ticks
+    Uint32             OnDemand    = 0;       // Renderizar cada vista solo cuando cambia
+};
+
+// Frames que el CPU puede adelantarse al GPU; las consultas de un frame se leen al esperarlo
+constexpr Uint32 MaxFramesInFlight = 2;
+
+void PrintUsage(const char* ExeName)
+{
+    std::printf("Usage: %s [options]\n"
+                "  --backend vk|d3d11|d3d12   Graphics backend (default: vk)\n"
+                "  --frames N                 Measured frames (default: 600)\n"
+                "  --warmup N                 Frames rendered before measuring (default: 60)\n"
+                "  --width W --height H       Offscreen target size (default: 1280x720)\n"
+                "  --grid N                   N x N mobiles; 1 renders the single mobile (default: 1)\n"
+                "  --views N                  Camera views to render, 1 to 3 (default: 3)\n"
+                "  --csv FILE                 Per-frame output (default: tutorial04_benchmark.csv)\n"
+                "  --pass-csv FILE            Per-pass GPU averages (default: tutorial04_passes.csv)\n"
+                "  --assets DIR               Directory with the shaders and textures\n"
+                "  --trace FILE               Chrome trace of the CPU zones (profiler builds only)\n"
+                "  --state-cache FILE|none    Shader/PSO cache file (default: tutorial04_state_cache_<backend>.bin)\n"
+                "  --fps N                    Simulated present rate; each frame advances 1/N s (default: 60)\n"
+                "  --tick-rate N              Simulation ticks per second (default: 60)\n"
+                "  --reuse-instances 0|1      Reuse instances on frames without a tick (default: 0)\n"
+                "  --on-demand 0|1            Re-render each view only when its inputs change (default: 0)\n",
+                ExeName);
+}
+
+bool ParseUInt(const char* Str, Uint32& Value)
+{
+    char*               End    = nullptr;
+    const unsigned long Parsed = std::strtoul(Str, &End, 10);
+    if (End == Str || *End != '\0')
+        return false;
+    Value = static_cast<Uint32>(Parsed);
+    return true;
+}
+
+bool ParseArgs(int argc, char** argv, BenchmarkArgs& Args)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* Arg   = argv[i];
+        const char* Value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (Value == nullptr)
+            return false;
+        ++i;
+
+        bool Valid = true;
+        if (std::strcmp(Arg, "--backend") == 0)
+        {
+            Args.BackendName = Value;
+            if (std::strcmp(Value, "vk") == 0)
+                Args.DeviceType = RENDER_DEVICE_TYPE_VULKAN;
+            else if (std::strcmp(Value, "d3d11") == 0)
+                Args.DeviceType = RENDER_DEVICE_TYPE_D3D11;
+            else if (std::strcmp(Value, "d3d12") == 0)
+                Args.DeviceType = RENDER_DEVICE_TYPE_D3D12;
+            else
+                Valid = false;
+        }
+        else if (std::strcmp(Arg, "--frames") == 0)
+            Valid = ParseUInt(Value, Args.NumFrames);
+        else if (std::strcmp(Arg, "--warmup") == 0)
+            Valid = ParseUInt(Value, Args.NumWarmup);
+        else if (std::strcmp(Arg, "--width") == 0)
+            Valid = ParseUInt(Value, Args.Width);
+        else if (std::strcmp(Arg, "--height") == 0)
+            Valid = ParseUInt(Value, Args.Height);
+        else if (std::strcmp(Arg, "--grid") == 0)
+            Valid = ParseUInt(Value, Args.GridSize);
+        else if (std::strcmp(Arg, "--views") == 0)
+            Valid = ParseUInt(Value, Args.NumViews) && Args.NumViews >= 1 && Args.NumViews <= 3;
+        else if (std::strcmp(Arg, "--csv") == 0)
+            Args.CSVPath = Value;
+        else if (std::strcmp(Arg, "--pass-csv") == 0)
+            Args.PassCSVPath = Value;
+        else if (std::strcmp(Arg, "--assets") == 0)
+            Args.AssetsDir = Value;
+        else if (std::strcmp(Arg, "--trace") == 0)
+            Args.TracePath = Value;
+        else if (std::strcmp(Arg, "--state-cache") == 0)
+            Args.StateCache = Value;
+        else if (std::strcmp(Arg, "--fps") == 0)
+            Valid = ParseUInt(Value, Args.FrameRate) && Args.FrameRate > 0;
+        else if (std::strcmp(Arg, "--tick-rate") == 0)
+            Valid = ParseUInt(Value, Args.TickRate) && Args.TickRate > 0;
+        else if (std::strcmp(Arg, "--reuse-instances") == 0)
+            Valid = ParseUInt(Value, Args.Reuse) && Args.Reuse <= 1;
+        else if (std::strcmp(Arg, "--on-demand") == 0)
+            Valid = ParseUInt(Value, Args.OnDemand) && Args.OnDemand <= 1;
+        else
+            Valid = false;
+
+        if (!Valid)
+        {
+            std::fprintf(stderr, "Invalid argument: %s %s\n", Arg, Value);
+            return false;
+        }
+    }
+    return Args.NumFrames > 0 && Args.Width > 0 && Args.Height > 0;
+}
+
+// Crea el dispositivo y los contextos sin swap chain. El sample ajusta la configuración del
+// motor (contextos diferidos, características) igual que en la aplicación con ventana.
+bool CreateDevice(const BenchmarkArgs&           Args,
+                  Tutorial04_Instancing&         Sample,
+                  RefCntAutoPtr<IEngineFactory>& pFactory,
+                  RefCntAutoPtr<IRenderDevice>&  pDevice,
+                  std::vector<IDeviceContext*>&  Contexts,
+                  Uint32&                        NumImmediateCtx)
+{
+    SwapChainDesc SCDesc;
+
+    auto PrepareContexts = [&](EngineCreateInfo& EngineCI, IEngineFactory* pEngineFactory) {
+        Sample.ModifyEngineInitInfo({pEngineFactory, Args.DeviceType, EngineCI, SCDesc});
+        NumImmediateCtx = std::max(1u, EngineCI.NumImmediateContexts);
+        Contexts.assign(NumImmediateCtx + EngineCI.NumDeferredContexts, nullptr);
+    };
+
+    switch (Args.DeviceType)
+    {
+#if VULKAN_SUPPORTED
+        case RENDER_DEVICE_TYPE_VULKAN:
+        {
+#    if EXPLICITLY_LOAD_ENGINE_VK_DLL
+            auto GetEngineFactoryVk = LoadGraphicsEngineVk();
+#    endif
+            IEngineFactoryVk*  pFactoryVk = GetEngineFactoryVk();
+            EngineVkCreateInfo EngineCI;
+            PrepareContexts(EngineCI, pFactoryVk);
+            pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &pDevice, Contexts.data());
+            pFactory = pFactoryVk;
+            break;
+        }
+#endif
+
+#if D3D11_SUPPORTED
+        case RENDER_DEVICE_TYPE_D3D11:
+        {
+#    if ENGINE_DLL
+            auto GetEngineFactoryD3D11 = LoadGraphicsEngineD3D11();
+#    endif
+            IEngineFactoryD3D11*  pFactoryD3D11 = GetEngineFactoryD3D11();
+            EngineD3D11CreateInfo EngineCI;
+            PrepareContexts(EngineCI, pFactoryD3D11);
+            pFactoryD3D11->CreateDeviceAndContextsD3D11(EngineCI, &pDevice, Contexts.data());
+            pFactory = pFactoryD3D11;
+            break;
+        }
+#endif
+
+#if D3D12_SUPPORTED
+        case RENDER_DEVICE_TYPE_D3D12:
+        {
+#    if ENGINE_DLL
+            auto GetEngineFactoryD3D12 = LoadGraphicsEngineD3D12();
+#    endif
+            IEngineFactoryD3D12*  pFactoryD3D12 = GetEngineFactoryD3D12();
+            EngineD3D12CreateInfo EngineCI;
+            PrepareContexts(EngineCI, pFactoryD3D12);
+            pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &pDevice, Contexts.data());
+            pFactory = pFactoryD3D12;
+            break;
+        }
+#endif
+
+        default:
+            // OpenGL necesita una ventana para crear el contexto
+            std::fprintf(stderr, "Backend '%s' is not available in headless mode on this platform\n", Args.BackendName);
+            return false;
+    }
+    return pDevice != nullptr;
+}
+
+// Tiempos de un frame; los del GPU se leen cuando el frame ha terminado
+struct FrameRecord
+{
+    double UpdateMs     = 0;
+    double RenderMs     = 0;
+    double GPUMs        = -1; // Negativo si no hay consultas de timestamp
+    Uint32 NumInstances = 0;
+};
+
+// Las rutas relativas de los ficheros de salida se resuelven antes de cambiar al directorio de
+// los assets, para que se escriban donde se lanzó el benchmark
+std::string GetOutputPath(const char* Path)
+{
+    std::error_code             Error;
+    const std::filesystem::path Absolute = std::filesystem::absolute(Path, Error);
+    return Error ? std::string{Path} : Absolute.string();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchmarkArgs Args;
+    if (!ParseArgs(argc, argv, Args))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // Los shaders y las texturas se cargan con rutas relativas, como en la aplicación con ventana
+    std::string CSVPath, PassCSVPath, TracePath, StateCache;
+    if (Args.AssetsDir != nullptr)
+    {
+        CSVPath          = GetOutputPath(Args.CSVPath);
+        PassCSVPath      = GetOutputPath(Args.PassCSVPath);
+        Args.CSVPath     = CSVPath.c_str();
+        Args.PassCSVPath = PassCSVPath.c_str();
+        if (Args.TracePath != nullptr)
+        {
+            TracePath      = GetOutputPath(Args.TracePath);
+            Args.TracePath = TracePath.c_str();
+        }
+        if (Args.StateCache != nullptr && std::strcmp(Args.StateCache, "none") != 0)
+        {
+            StateCache      = GetOutputPath(Args.StateCache);
+            Args.StateCache = StateCache.c_str();
+        }
+
+        std::error_code Error;
+        std::filesystem::current_path(Args.AssetsDir, Error);
+        if (Error)
+        {
+            std::fprintf(stderr, "Failed to change directory to '%s': %s\n", Args.AssetsDir, Error.message().c_str());
+            return 1;
+        }
+    }
+
+    std::FILE* pCSV = std::fopen(Args.CSVPath, "w");
+    if (pCSV == nullptr)
+    {
+        std::fprintf(stderr, "Failed to open '%s' for writing\n", Args.CSVPath);
+        return 1;
+    }
+
+    std::unique_ptr<Tutorial04_Instancing> pSample{new Tutorial04_Instancing{}};
+
+    RefCntAutoPtr<IEngineFactory> pFactory;
+    RefCntAutoPtr<IRenderDevice>  pDevice;
+    std::vector<IDeviceContext*>  Contexts;
+    Uint32                        NumImmediateCtx = 1;
+    if (!CreateDevice(Args, *pSample, pFactory, pDevice, Contexts, NumImmediateCtx))
+    {
+        std::fprintf(stderr, "Failed to create the render device\n");
+        std::fclose(pCSV);
+        return 1;
+    }
+    IDeviceContext* pCtx = Contexts[0];
+
+    pSample->SetOffscreenTarget(Args.Width, Args.Height);
+    if (Args.StateCache != nullptr)
+        pSample->SetStateCachePath(std::strcmp(Args.StateCache, "none") != 0 ? Args.StateCache : nullptr);
+    {
+        SampleInitInfo InitInfo;
+        InitInfo.pEngineFactory  = pFactory;
+        InitInfo.pDevice         = pDevice;
+        InitInfo.ppContexts      = Contexts.data();
+        InitInfo.NumImmediateCtx = NumImmediateCtx;
+        InitInfo.NumDeferredCtx  = static_cast<Uint32>(Contexts.size()) - NumImmediateCtx;
+        pSample->Initialize(InitInfo);
+    }
+    // Los frames medidos necesitan todos los PSO; sin ventana no hay pantalla de carga
+    pSample->WaitForScene();
+    pSample->SetBenchmarkScene(Args.GridSize, Args.NumViews);
+    pSample->SetSimulation(Args.TickRate, Args.Reuse != 0);
+    pSample->SetOnDemandRendering(Args.OnDemand != 0);
+
+    // Paso de tiempo fijo del benchmark: la animación no depende de la velocidad del dispositivo
+    const double FrameTime = 1.0 / Args.FrameRate;
+
+    // Un par de timestamps y un valor de la fence por frame en vuelo
+    const bool TimestampQueries = pDevice->GetDeviceInfo().Features.TimestampQueries;
+
+    RefCntAutoPtr<IQuery> pTimestamps[MaxFramesInFlight + 1][2];
+    if (TimestampQueries)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Benchmark frame timestamp";
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        for (auto& Pair : pTimestamps)
+        {
+            pDevice->CreateQuery(Desc, &Pair[0]);
+            pDevice->CreateQuery(Desc, &Pair[1]);
+        }
+    }
+
+    RefCntAutoPtr<IFence> pFrameFence;
+    {
+        FenceDesc Desc;
+        Desc.Name = "Benchmark frame fence";
+        pDevice->CreateFence(Desc, &pFrameFence);
+    }
+
+    const Uint32             TotalFrames = Args.NumWarmup + Args.NumFrames;
+    std::vector<FrameRecord> Records(TotalFrames);
+
+    auto ResolveFrame = [&](Uint32 Frame) {
+        if (!TimestampQueries)
+            return;
+        auto&              Pair = pTimestamps[Frame % _countof(pTimestamps)];
+        QueryDataTimestamp Begin, End;
+        if (Pair[0]->GetData(&Begin, sizeof(Begin)) && Pair[1]->GetData(&End, sizeof(End)) && End.Frequency != 0)
+            Records[Frame].GPUMs = static_cast<double>(End.Counter - Begin.Counter) * 1000.0 / static_cast<double>(End.Frequency);
+    };
+
+    for (Uint32 Frame = 0; Frame < TotalFrames; ++Frame)
+    {
+        // El frame que usó este juego de consultas tiene que haber terminado
+        if (Frame >= _countof(pTimestamps))
+        {
+            const Uint32 OldFrame = Frame - _countof(pTimestamps);
+            pFrameFence->Wait(Uint64{OldFrame} + 1);
+            ResolveFrame(OldFrame);
+        }
+
+        // Las medias por pasada solo incluyen los frames medidos
+        if (Frame == Args.NumWarmup)
+            pSample->GetGPUProfiler().ResetTotals();
+
+        FrameRecord& Record = Records[Frame];
+        auto&        Pair   = pTimestamps[Frame % _countof(pTimestamps)];
+
+        Timer UpdateTimer;
+        pSample->Update(Frame * FrameTime, FrameTime);
+        Record.UpdateMs = UpdateTimer.GetElapsedTime() * 1000.0;
+
+        Timer RenderTimer;
+        if (TimestampQueries)
+            pCtx->EndQuery(Pair[0]);
+        pSample->Render();
+        if (TimestampQueries)
+            pCtx->EndQuery(Pair[1]);
+        Record.RenderMs     = RenderTimer.GetElapsedTime() * 1000.0;
+        Record.NumInstances = pSample->GetNumInstances();
+
+        // Sin swap chain nadie llama a Present(): el frame se envía y se cierra aquí
+        pCtx->EnqueueSignal(pFrameFence, Uint64{Frame} + 1);
+        pCtx->Flush();
+        pCtx->FinishFrame();
+        pDevice->ReleaseStaleResources();
+    }
+
+    pCtx->WaitForIdle();
+    for (Uint32 Frame = TotalFrames > _countof(pTimestamps) ? TotalFrames - _countof(pTimestamps) : 0; Frame < TotalFrames; ++Frame)
+        ResolveFrame(Frame);
+
+    std::fprintf(pCSV, "frame,update_ms,render_ms,gpu_ms,instances,views,backend,width,height\n");
+    double SumUpdateMs = 0, SumRenderMs = 0, SumGPUMs = 0;
+    Uint32 NumGPUFrames = 0;
+    for (Uint32 Frame = Args.NumWarmup; Frame < TotalFrames; ++Frame)
+    {
+        const FrameRecord& Record = Records[Frame];
+        std::fprintf(pCSV, "%u,%.4f,%.4f,", Frame - Args.NumWarmup, Record.UpdateMs, Record.RenderMs);
+        if (Record.GPUMs >= 0)
+            std::fprintf(pCSV, "%.4f", Record.GPUMs);
+        std::fprintf(pCSV, ",%u,%u,%s,%u,%u\n", Record.NumInstances, pSample->GetNumActiveViews(), Args.BackendName, Args.Width, Args.Height);
+
+        SumUpdateMs += Record.UpdateMs;
+        SumRenderMs += Record.RenderMs;
+        if (Record.GPUMs >= 0)
+        {
+            SumGPUMs += Record.GPUMs;
+            ++NumGPUFrames;
+        }
+    }
+    std::fclose(pCSV);
+
+    // Medias por pasada del perfil del GPU de la escena; las pasadas que no se ejecutan en este
+    // modo de render no tienen muestras
+    const GPUPassProfiler& Profiler = pSample->GetGPUProfiler();
+    if (Profiler.IsSupported())
+    {
+        if (std::FILE* pPassCSV = std::fopen(Args.PassCSVPath, "w"))
+        {
+            std::fprintf(pPassCSV, "pass,gpu_ms,vertices,primitives,ps_invocations,samples\n");
+            for (Uint32 Pass = 0; Pass < Profiler.GetNumPasses(); ++Pass)
+            {
+                if (Profiler.GetNumSamples(Pass) == 0)
+                    continue;
+                const GPUPassProfiler::PassStats Mean = Profiler.GetMean(Pass);
+                std::fprintf(pPassCSV, "\"%s\",%.4f,%.0f,%.0f,%.0f,%u\n", Tutorial04_Instancing::GetGPUProfilePassName(Pass),
+                             Mean.TimeMs, Mean.Vertices, Mean.Primitives, Mean.PSInvocations, Profiler.GetNumSamples(Pass));
+            }
+            std::fclose(pPassCSV);
+        }
+        else
+        {
+            std::fprintf(stderr, "Failed to open '%s' for writing\n", Args.PassCSVPath);
+        }
+    }
+
+    // Arranque: Initialize() hasta poder dibujar la interfaz, la escena lista con sus PSO, las
+    // texturas del móvil copiadas y el primer frame en el CPU
+    const Tutorial04_Instancing::StartupStats& Startup = pSample->GetStartupStats();
+    std::printf("Startup: init %.1f ms, scene ready %.1f ms, textures ready %.1f ms (longest task %.1f ms, %.1f ms of tasks), first frame %.1f ms, ",
+                Startup.InitTimeMs, Startup.SceneReadyTimeMs, Startup.TexturesReadyMs, Startup.LongestTaskMs, Startup.TotalTaskMs,
+                Startup.SceneReadyTimeMs + (TotalFrames > 0 ? Records[0].UpdateMs + Records[0].RenderMs : 0.0));
+    if (Startup.StateCacheOn)
+        std::printf("state cache %s (%u hits, %u compiled)\n", Startup.StateCacheWarm ? "warm" : "cold", Startup.NumCacheHits, Startup.NumCacheMisses);
+    else
+        std::printf("state cache off\n");
+
+    std::printf("%u frames (%s, %ux%u, %u views, %u instances): update %.3f ms, render %.3f ms",
+                Args.NumFrames, Args.BackendName, Args.Width, Args.Height, pSample->GetNumActiveViews(), pSample->GetNumInstances(),
+                SumUpdateMs / Args.NumFrames, SumRenderMs / Args.NumFrames);
+    if (NumGPUFrames > 0)
+        std::printf(", GPU %.3f ms", SumGPUMs / NumGPUFrames);
+    std::printf("\n");
+
+    // Incluye los frames de calentamiento
+    std::printf("Simulation: %u fps, %u ticks/s, instances generated in %u frames, reused in %u\n", Args.FrameRate, Args.TickRate,
+                pSample->GetNumGeneratedInstanceFrames(), pSample->GetNumReusedInstanceFrames());
+    if (Args.OnDemand != 0)
+    {
+        std::printf("On-demand rendering: %u frames, view renders", pSample->GetNumOnDemandFrames());
+        for (Uint32 View = 0; View < pSample->GetNumActiveViews(); ++View)
+            std::printf("%s %u", View > 0 ? "," : "", pSample->GetNumViewRenders(View));
+        std::printf("\n");
+    }
+
+    if (Args.TracePath != nullptr)
+    {
+#if TUTORIAL04_CPU_PROFILER
+        // Los anillos guardan los eventos más recientes de cada hilo
+        const int NumEvents = CPUProfiler::ExportChromeTrace(Args.TracePath);
+        if (NumEvents >= 0)
+            std::printf("%d CPU zone events written to %s\n", NumEvents, Args.TracePath);
+        else
+            std::fprintf(stderr, "Failed to open '%s' for writing\n", Args.TracePath);
+#else
+        std::fprintf(stderr, "--trace requires a build with TUTORIAL04_ENABLE_CPU_PROFILER\n");
+#endif
+    }
+
+    // El sample libera sus recursos antes que el dispositivo y los contextos
+    pSample.reset();
+    for (IDeviceContext* pContext : Contexts)
+    {
+        if (pContext != nullptr)
+            pContext->Release();
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <algorithm>
+
+#include "InitTaskGraph.hpp"
+#include "ThreadPool.hpp"
+#include "DebugUtilities.hpp"
+#include "Timer.hpp"
+
+namespace Diligent
+{
+
+InitTaskGraph::TaskId InitTaskGraph::AddTask(const char* Name, std::function<void()> Func, std::initializer_list<TaskId> Dependencies)
+{
+    VERIFY(m_NumFinished.load() == 0, "No se pueden añadir tareas a un grafo en ejecución");
+
+    const TaskId Id = static_cast<TaskId>(m_Tasks.size());
+
+    std::unique_ptr<Task> pTask{new Task};
+    pTask->Name            = Name;
+    pTask->Func            = std::move(Func);
+    pTask->NumDependencies = static_cast<Uint32>(Dependencies.size());
+    for (TaskId Dependency : Dependencies)
+    {
+        VERIFY(Dependency < Id, "Una tarea solo puede depender de tareas añadidas antes");
+        m_Tasks[Dependency]->Dependents.push_back(Id);
+    }
+    m_Tasks.emplace_back(std::move(pTask));
+    return Id;
+}
+
+void InitTaskGraph::Run(WorkStealingThreadPool* pPool)
+{
+    m_pPool = pPool != nullptr && pPool->GetNumWorkers() > 0 ? pPool : nullptr;
+    m_NumFinished.store(0);
+    for (auto& pTask : m_Tasks)
+        pTask->NumPending.store(pTask->NumDependencies);
+
+    if (m_pPool == nullptr)
+    {
+        for (TaskId Id = 0; Id < GetNumTasks(); ++Id)
+            Execute(Id);
+        return;
+    }
+
+    // Se recogen antes de lanzar: una tarea puede terminar y lanzar a sus dependientes
+    // mientras este bucle sigue recorriendo el grafo
+    std::vector<TaskId> Roots;
+    for (TaskId Id = 0; Id < GetNumTasks(); ++Id)
+    {
+        if (m_Tasks[Id]->NumDependencies == 0)
+            Roots.push_back(Id);
+    }
+    for (TaskId Id : Roots)
+        Launch(Id);
+}
+
+void InitTaskGraph::Launch(TaskId Id)
+{
+    if (m_pPool != nullptr)
+        m_pPool->Enqueue([this, Id]() { Execute(Id); });
+}
+
+void InitTaskGraph::Execute(TaskId Id)
+{
+    Task& T = *m_Tasks[Id];
+
+    Timer TaskTimer;
+    T.Func();
+    T.TimeMs = static_cast<float>(TaskTimer.GetElapsedTime() * 1000.0);
+
+    for (TaskId Dependent : T.Dependents)
+    {
+        if (m_Tasks[Dependent]->NumPending.fetch_sub(1) == 1)
+            Launch(Dependent);
+    }
+
+    // Se cuenta después de lanzar a los dependientes para que IsFinished() no se adelante
+    {
+        std::lock_guard<std::mutex> Lock{m_FinishedMtx};
+        m_NumFinished.fetch_add(1);
+    }
+    m_FinishedCV.notify_all();
+}
+
+void InitTaskGraph::Wait()
+{
+    std::unique_lock<std::mutex> Lock{m_FinishedMtx};
+    m_FinishedCV.wait(Lock, [this]() { return IsFinished(); });
+}
+
+void InitTaskGraph::Clear()
+{
+    VERIFY(IsFinished(), "No se puede vaciar un grafo en ejecución");
+    m_Tasks.clear();
+    m_NumFinished.store(0);
+    m_pPool = nullptr;
+}
+
+float InitTaskGraph::GetLongestTaskTimeMs() const
+{
+    float LongestMs = 0;
+    for (const auto& pTask : m_Tasks)
+        LongestMs = std::max(LongestMs, pTask->TimeMs);
+    return LongestMs;
+}
+
+float InitTaskGraph::GetTotalTaskTimeMs() const
+{
+    float TotalMs = 0;
+    for (const auto& pTask : m_Tasks)
+        TotalMs += pTask->TimeMs;
+    return TotalMs;
+}
+
+} // namespace Diligent
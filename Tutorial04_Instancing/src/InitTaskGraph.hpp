@@ -0,0 +1,99 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+class WorkStealingThreadPool;
+
+// Grafo de tareas de inicialización con dependencias. Cada tarea se encola en el pool en
+// cuanto terminan todas sus dependencias, así que el tiempo total se acerca al del camino
+// más largo del grafo en lugar de a la suma de todas las tareas. Sin pool las tareas se
+// ejecutan en el hilo llamador en orden de inserción, que es siempre un orden topológico
+// porque una tarea solo puede depender de tareas añadidas antes.
+class InitTaskGraph
+{
+public:
+    using TaskId = Uint32;
+
+    TaskId AddTask(const char* Name, std::function<void()> Func, std::initializer_list<TaskId> Dependencies = {});
+
+    // Lanza las tareas sin dependencias. Con pPool == nullptr (o sin hilos trabajadores) las
+    // ejecuta todas antes de retornar.
+    void Run(WorkStealingThreadPool* pPool);
+
+    // Bloquea hasta que terminan todas las tareas
+    void Wait();
+
+    void Clear();
+
+    bool   IsFinished() const { return GetNumFinished() == GetNumTasks(); }
+    Uint32 GetNumTasks() const { return static_cast<Uint32>(m_Tasks.size()); }
+    Uint32 GetNumFinished() const { return m_NumFinished.load(); }
+
+    // Duración de cada tarea; solo son válidas cuando IsFinished()
+    const char* GetTaskName(TaskId Id) const { return m_Tasks[Id]->Name; }
+    float       GetTaskTimeMs(TaskId Id) const { return m_Tasks[Id]->TimeMs; }
+    float       GetLongestTaskTimeMs() const;
+    float       GetTotalTaskTimeMs() const;
+
+private:
+    struct Task
+    {
+        const char*           Name = nullptr;
+        std::function<void()> Func;
+        std::vector<TaskId>   Dependents;
+        Uint32                NumDependencies = 0;
+        std::atomic<Uint32>   NumPending{0};
+        float                 TimeMs = 0;
+    };
+
+    void Launch(TaskId Id);
+    void Execute(TaskId Id);
+
+    std::vector<std::unique_ptr<Task>> m_Tasks;
+    WorkStealingThreadPool*            m_pPool = nullptr;
+    std::atomic<Uint32>                m_NumFinished{0};
+
+    std::mutex              m_FinishedMtx;
+    std::condition_variable m_FinishedCV;
+};
+
+} // namespace Diligent
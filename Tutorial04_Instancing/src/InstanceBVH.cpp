@@ -0,0 +1,323 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <algorithm>
+#include <cfloat>
+
+#include "InstanceBVH.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+BoundBox MergeBoxes(const BoundBox& A, const BoundBox& B)
+{
+    BoundBox Box;
+    Box.Min = (min)(A.Min, B.Min);
+    Box.Max = (max)(A.Max, B.Max);
+    return Box;
+}
+
+bool BoxesOverlap(const BoundBox& A, const BoundBox& B)
+{
+    return A.Min.x <= B.Max.x && A.Max.x >= B.Min.x &&
+        A.Min.y <= B.Max.y && A.Max.y >= B.Min.y &&
+        A.Min.z <= B.Max.z && A.Max.z >= B.Min.z;
+}
+
+} // namespace
+
+BoundBox InstanceBVH::ComputeInstanceBox(const InstanceDataType& Instance)
+{
+    // El cubo [-1, 1]^3 rotado cabe en una esfera de radio sqrt(3). Su imagen por la parte
+    // lineal de la matriz (vectores fila) se extiende en el eje j hasta sqrt(3) * |columna j|.
+    const float4x4& M = Instance.Transform;
+    const float3    Center{M._41, M._42, M._43};
+    const float3    Extent = float3{
+                              std::sqrt(M._11 * M._11 + M._21 * M._21 + M._31 * M._31),
+                              std::sqrt(M._12 * M._12 + M._22 * M._22 + M._32 * M._32),
+                              std::sqrt(M._13 * M._13 + M._23 * M._23 + M._33 * M._33),
+                          } *
+        1.7320508f;
+
+    BoundBox Box;
+    Box.Min = Center - Extent;
+    Box.Max = Center + Extent;
+    return Box;
+}
+
+bool InstanceBVH::Update(const InstanceDataType* pInstances, Uint32 NumInstances)
+{
+    if (NumInstances != GetNumInstances() || m_Nodes.empty())
+    {
+        Build(pInstances, NumInstances);
+        return true;
+    }
+
+    Refit(pInstances);
+    return false;
+}
+
+void InstanceBVH::Build(const InstanceDataType* pInstances, Uint32 NumInstances)
+{
+    Clear();
+    if (NumInstances == 0)
+        return;
+
+    m_InstanceBoxes.resize(NumInstances);
+    m_Centroids.resize(NumInstances);
+    m_Indices.resize(NumInstances);
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        m_InstanceBoxes[i] = ComputeInstanceBox(pInstances[i]);
+        m_Centroids[i]     = (m_InstanceBoxes[i].Min + m_InstanceBoxes[i].Max) * 0.5f;
+        m_Indices[i]       = i;
+    }
+
+    // Un árbol binario con hojas de hasta MaxLeafSize instancias tiene menos de 2N nodos
+    m_Nodes.reserve(size_t{NumInstances} * 2);
+    BuildRecursive(0, NumInstances);
+
+    m_Centroids.clear();
+}
+
+Uint32 InstanceBVH::BuildRecursive(Uint32 First, Uint32 Count)
+{
+    const Uint32 NodeIdx = static_cast<Uint32>(m_Nodes.size());
+    m_Nodes.emplace_back();
+
+    BoundBox Box         = m_InstanceBoxes[m_Indices[First]];
+    float3   CentroidMin = m_Centroids[m_Indices[First]];
+    float3   CentroidMax = CentroidMin;
+    for (Uint32 i = First + 1; i < First + Count; ++i)
+    {
+        Box         = MergeBoxes(Box, m_InstanceBoxes[m_Indices[i]]);
+        CentroidMin = (min)(CentroidMin, m_Centroids[m_Indices[i]]);
+        CentroidMax = (max)(CentroidMax, m_Centroids[m_Indices[i]]);
+    }
+    m_Nodes[NodeIdx].Box = Box;
+
+    if (Count <= MaxLeafSize)
+    {
+        m_Nodes[NodeIdx].First = First;
+        m_Nodes[NodeIdx].Count = Count;
+        return NodeIdx;
+    }
+
+    // Partir por la mediana de los centroides en el eje de mayor extensión
+    const float3 CentroidExtent = CentroidMax - CentroidMin;
+    int          Axis           = 0;
+    if (CentroidExtent.y > CentroidExtent[Axis])
+        Axis = 1;
+    if (CentroidExtent.z > CentroidExtent[Axis])
+        Axis = 2;
+
+    const Uint32 Half = Count / 2;
+    std::nth_element(m_Indices.begin() + First, m_Indices.begin() + First + Half, m_Indices.begin() + First + Count,
+                     [this, Axis](Uint32 A, Uint32 B) {
+                         return m_Centroids[A][Axis] < m_Centroids[B][Axis];
+                     });
+
+    BuildRecursive(First, Half);
+    const Uint32 RightChild = BuildRecursive(First + Half, Count - Half);
+    // m_Nodes puede haberse realojado durante la recursión
+    m_Nodes[NodeIdx].RightChild = RightChild;
+    return NodeIdx;
+}
+
+void InstanceBVH::Refit(const InstanceDataType* pInstances)
+{
+    const Uint32 NumInstances = GetNumInstances();
+    for (Uint32 i = 0; i < NumInstances; ++i)
+        m_InstanceBoxes[i] = ComputeInstanceBox(pInstances[i]);
+
+    // Los hijos siempre tienen índices mayores que su padre
+    for (size_t n = m_Nodes.size(); n-- > 0;)
+    {
+        Node& N = m_Nodes[n];
+        if (N.Count > 0)
+        {
+            N.Box = m_InstanceBoxes[m_Indices[N.First]];
+            for (Uint32 i = N.First + 1; i < N.First + N.Count; ++i)
+                N.Box = MergeBoxes(N.Box, m_InstanceBoxes[m_Indices[i]]);
+        }
+        else
+        {
+            N.Box = MergeBoxes(m_Nodes[n + 1].Box, m_Nodes[N.RightChild].Box);
+        }
+    }
+}
+
+void InstanceBVH::Clear()
+{
+    m_Nodes.clear();
+    m_Indices.clear();
+    m_InstanceBoxes.clear();
+    m_Centroids.clear();
+}
+
+void InstanceBVH::AppendSubtree(Uint32 NodeIdx, std::vector<Uint32>& Result) const
+{
+    // Los nodos del subárbol son contiguos y sus hojas cubren un rango contiguo de m_Indices:
+    // basta con localizar la primera y la última hoja
+    Uint32 FirstLeaf = NodeIdx;
+    while (m_Nodes[FirstLeaf].Count == 0)
+        FirstLeaf = FirstLeaf + 1;
+    Uint32 LastLeaf = NodeIdx;
+    while (m_Nodes[LastLeaf].Count == 0)
+        LastLeaf = m_Nodes[LastLeaf].RightChild;
+
+    const Uint32 Begin = m_Nodes[FirstLeaf].First;
+    const Uint32 End   = m_Nodes[LastLeaf].First + m_Nodes[LastLeaf].Count;
+    Result.insert(Result.end(), m_Indices.begin() + Begin, m_Indices.begin() + End);
+}
+
+void InstanceBVH::QueryFrustum(const ViewFrustum& Frustum, std::vector<Uint32>& Visible) const
+{
+    if (m_Nodes.empty())
+        return;
+
+    Uint32 Stack[64];
+    Uint32 StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize > 0)
+    {
+        const Uint32 NodeIdx = Stack[--StackSize];
+        const Node&  N       = m_Nodes[NodeIdx];
+
+        const BoxVisibility Visibility = GetBoxVisibility(Frustum, N.Box);
+        if (Visibility == BoxVisibility::Invisible)
+            continue;
+
+        // Si el nodo está completamente dentro, todo su subárbol es visible sin más pruebas
+        if (Visibility == BoxVisibility::FullyVisible)
+        {
+            AppendSubtree(NodeIdx, Visible);
+        }
+        else if (N.Count > 0)
+        {
+            for (Uint32 i = N.First; i < N.First + N.Count; ++i)
+            {
+                if (GetBoxVisibility(Frustum, m_InstanceBoxes[m_Indices[i]]) != BoxVisibility::Invisible)
+                    Visible.push_back(m_Indices[i]);
+            }
+        }
+        else
+        {
+            VERIFY(StackSize + 2 <= _countof(Stack), "Desbordamiento de la pila de recorrido");
+            Stack[StackSize++] = N.RightChild;
+            Stack[StackSize++] = NodeIdx + 1;
+        }
+    }
+}
+
+void InstanceBVH::QueryBox(const BoundBox& Box, std::vector<Uint32>& Result) const
+{
+    if (m_Nodes.empty())
+        return;
+
+    Uint32 Stack[64];
+    Uint32 StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize > 0)
+    {
+        const Uint32 NodeIdx = Stack[--StackSize];
+        const Node&  N       = m_Nodes[NodeIdx];
+        if (!BoxesOverlap(N.Box, Box))
+            continue;
+
+        if (N.Count > 0)
+        {
+            for (Uint32 i = N.First; i < N.First + N.Count; ++i)
+            {
+                if (BoxesOverlap(m_InstanceBoxes[m_Indices[i]], Box))
+                    Result.push_back(m_Indices[i]);
+            }
+        }
+        else
+        {
+            VERIFY(StackSize + 2 <= _countof(Stack), "Desbordamiento de la pila de recorrido");
+            Stack[StackSize++] = N.RightChild;
+            Stack[StackSize++] = NodeIdx + 1;
+        }
+    }
+}
+
+Uint32 InstanceBVH::CastRay(const float3& Origin, const float3& Direction, float* pHitDist) const
+{
+    Uint32 Closest     = InvalidIndex;
+    float  ClosestDist = FLT_MAX;
+    if (m_Nodes.empty())
+        return Closest;
+
+    Uint32 Stack[64];
+    Uint32 StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize > 0)
+    {
+        const Node& N = m_Nodes[Stack[--StackSize]];
+
+        // Descartar los nodos que no corta el rayo o que empiezan más lejos que el mejor impacto
+        float EnterDist = 0, ExitDist = 0;
+        if (!IntersectRayBox(Origin, Direction, N.Box.Min, N.Box.Max, EnterDist, ExitDist) ||
+            ExitDist < 0 || EnterDist > ClosestDist)
+            continue;
+
+        if (N.Count > 0)
+        {
+            for (Uint32 i = N.First; i < N.First + N.Count; ++i)
+            {
+                const BoundBox& Box = m_InstanceBoxes[m_Indices[i]];
+                if (IntersectRayBox(Origin, Direction, Box.Min, Box.Max, EnterDist, ExitDist) && ExitDist >= 0)
+                {
+                    const float HitDist = std::max(EnterDist, 0.f);
+                    if (HitDist < ClosestDist)
+                    {
+                        ClosestDist = HitDist;
+                        Closest     = m_Indices[i];
+                    }
+                }
+            }
+        }
+        else
+        {
+            VERIFY(StackSize + 2 <= _countof(Stack), "Desbordamiento de la pila de recorrido");
+            Stack[StackSize++] = N.RightChild;
+            Stack[StackSize++] = static_cast<Uint32>(&N - m_Nodes.data()) + 1;
+        }
+    }
+
+    if (pHitDist != nullptr && Closest != InvalidIndex)
+        *pHitDist = ClosestDist;
+    return Closest;
+}
+
+} // namespace Diligent
@@ -0,0 +1,98 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "AdvancedMath.hpp"
+#include "InstanceData.hpp"
+
+namespace Diligent
+{
+
+// Jerarquía de volúmenes envolventes (BVH) sobre las cajas en espacio de mundo de las instancias.
+// Se construye una vez con particiones por la mediana y, mientras el número de instancias no
+// cambia, cada frame sólo se reajustan las cajas (refit) de abajo arriba: la topología se
+// conserva, lo que es suficiente porque las piezas se mueven alrededor de pivotes fijos.
+// Los nodos se guardan en orden de profundidad: el hijo izquierdo sigue a su padre y el
+// derecho se indica explícitamente, por lo que un recorrido inverso visita hijos antes que padres.
+class InstanceBVH
+{
+public:
+    static constexpr Uint32 InvalidIndex = ~Uint32{0};
+    static constexpr Uint32 MaxLeafSize  = 4;
+
+    // Reajusta las cajas a las nuevas transformaciones, o reconstruye el árbol si el número de
+    // instancias ha cambiado. Devuelve true si se ha reconstruido.
+    bool Update(const InstanceDataType* pInstances, Uint32 NumInstances);
+
+    void Build(const InstanceDataType* pInstances, Uint32 NumInstances);
+    void Refit(const InstanceDataType* pInstances);
+    void Clear();
+
+    // Añade a Visible los índices de las instancias cuya caja no queda fuera del frustum
+    void QueryFrustum(const ViewFrustum& Frustum, std::vector<Uint32>& Visible) const;
+
+    // Añade a Result los índices de las instancias cuya caja se solapa con Box
+    void QueryBox(const BoundBox& Box, std::vector<Uint32>& Result) const;
+
+    // Devuelve la instancia más cercana cuya caja corta el rayo, o InvalidIndex
+    Uint32 CastRay(const float3& Origin, const float3& Direction, float* pHitDist = nullptr) const;
+
+    Uint32          GetNumInstances() const { return static_cast<Uint32>(m_InstanceBoxes.size()); }
+    Uint32          GetNumNodes() const { return static_cast<Uint32>(m_Nodes.size()); }
+    const BoundBox& GetInstanceBox(Uint32 Instance) const { return m_InstanceBoxes[Instance]; }
+
+    // Caja de todas las instancias (la de la raíz). El árbol no debe estar vacío.
+    const BoundBox& GetBounds() const { return m_Nodes.front().Box; }
+
+    // Caja en espacio de mundo del cubo unidad de la instancia, válida para cualquier
+    // rotación previa del cubo (g_Rotation en el vertex shader)
+    static BoundBox ComputeInstanceBox(const InstanceDataType& Instance);
+
+private:
+    struct Node
+    {
+        BoundBox Box;
+        Uint32   First      = 0; // Hoja: primer elemento en m_Indices
+        Uint32   Count      = 0; // Hoja: número de instancias; 0 en nodos internos
+        Uint32   RightChild = 0; // Nodo interno: índice del hijo derecho (el izquierdo es el siguiente)
+    };
+
+    Uint32 BuildRecursive(Uint32 First, Uint32 Count);
+    void   AppendSubtree(Uint32 NodeIdx, std::vector<Uint32>& Result) const;
+
+    std::vector<Node>     m_Nodes;
+    std::vector<Uint32>   m_Indices;       // Instancias ordenadas por hoja
+    std::vector<BoundBox> m_InstanceBoxes; // Caja de cada instancia, por índice de instancia
+    std::vector<float3>   m_Centroids;     // Sólo durante la construcción
+};
+
+} // namespace Diligent
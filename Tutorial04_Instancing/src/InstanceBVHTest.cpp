@@ -0,0 +1,185 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+
+// Pruebas de las consultas de InstanceBVH después de un refit: las instancias se mueven lejos
+// de donde estaban al construir el árbol, así que la topología ya no se corresponde con sus
+// posiciones y solo las cajas reajustadas dan el resultado correcto. Cada consulta se compara
+// con la prueba de todas las instancias una a una.
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "InstanceBVH.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Rejilla de GridSize x GridSize cubos de escala CubeScale separados Spacing unidades en X y Z
+constexpr Uint32 GridSize  = 8;
+constexpr Uint32 NumCubes  = GridSize * GridSize;
+constexpr float  Spacing   = 4.0f;
+constexpr float  CubeScale = 0.5f;
+
+float3 GetGridPosition(Uint32 Idx)
+{
+    return float3{Spacing * static_cast<float>(Idx / GridSize), 0.0f, Spacing * static_cast<float>(Idx % GridSize)};
+}
+
+InstanceDataType MakeInstance(const float3& Pos)
+{
+    InstanceDataType Instance;
+    Instance.Transform   = float4x4::Scale(CubeScale, CubeScale, CubeScale) * float4x4::Translation(Pos.x, Pos.y, Pos.z);
+    Instance.TexSelector = 0;
+    return Instance;
+}
+
+// Cada instancia pasa a la posición de la simétrica en la rejilla, un poco más arriba
+std::vector<InstanceDataType> MakeMovedInstances()
+{
+    std::vector<InstanceDataType> Instances(NumCubes);
+    for (Uint32 i = 0; i < NumCubes; ++i)
+        Instances[i] = MakeInstance(GetGridPosition(NumCubes - 1 - i) + float3{0, 1, 0});
+    return Instances;
+}
+
+class InstanceBVHTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::vector<InstanceDataType> Initial(NumCubes);
+        for (Uint32 i = 0; i < NumCubes; ++i)
+            Initial[i] = MakeInstance(GetGridPosition(i));
+        ASSERT_TRUE(m_BVH.Update(Initial.data(), NumCubes));
+
+        m_Moved = MakeMovedInstances();
+        // Con el mismo número de instancias solo se reajustan las cajas
+        ASSERT_FALSE(m_BVH.Update(m_Moved.data(), NumCubes));
+        ASSERT_EQ(NumCubes, m_BVH.GetNumInstances());
+    }
+
+    InstanceBVH                   m_BVH;
+    std::vector<InstanceDataType> m_Moved;
+};
+
+bool BoxesOverlap(const BoundBox& A, const BoundBox& B)
+{
+    return A.Min.x <= B.Max.x && A.Max.x >= B.Min.x &&
+        A.Min.y <= B.Max.y && A.Max.y >= B.Min.y &&
+        A.Min.z <= B.Max.z && A.Max.z >= B.Min.z;
+}
+
+TEST_F(InstanceBVHTest, RefitBoxes)
+{
+    for (Uint32 i = 0; i < NumCubes; ++i)
+    {
+        const BoundBox  Expected = InstanceBVH::ComputeInstanceBox(m_Moved[i]);
+        const BoundBox& Box      = m_BVH.GetInstanceBox(i);
+        for (int c = 0; c < 3; ++c)
+        {
+            EXPECT_EQ(Expected.Min[c], Box.Min[c]) << "instancia " << i << ", eje " << c;
+            EXPECT_EQ(Expected.Max[c], Box.Max[c]) << "instancia " << i << ", eje " << c;
+        }
+    }
+
+    // La raíz cubre las cajas de todas las instancias en su nueva altura
+    const BoundBox& Bounds = m_BVH.GetBounds();
+    EXPECT_NEAR(1.0f - CubeScale * 1.7320508f, Bounds.Min.y, 1e-5f);
+    EXPECT_NEAR(1.0f + CubeScale * 1.7320508f, Bounds.Max.y, 1e-5f);
+}
+
+TEST_F(InstanceBVHTest, QueryFrustum)
+{
+    // Volumen ortográfico alineado con los ejes que contiene las posiciones 0..12 en X y en Z:
+    // los cubos de las cuatro primeras filas y columnas de la rejilla
+    const float4x4 ViewProj = float4x4::OrthoOffCenter(-1.0f, 13.0f, -5.0f, 5.0f, -1.0f, 13.0f, false);
+    ViewFrustum    Frustum;
+    ExtractViewFrustumPlanesFromMatrix(ViewProj, Frustum, false);
+
+    std::vector<Uint32> Visible;
+    m_BVH.QueryFrustum(Frustum, Visible);
+    std::sort(Visible.begin(), Visible.end());
+
+    std::vector<Uint32> Expected;
+    for (Uint32 i = 0; i < NumCubes; ++i)
+    {
+        if (GetBoxVisibility(Frustum, InstanceBVH::ComputeInstanceBox(m_Moved[i])) != BoxVisibility::Invisible)
+            Expected.push_back(i);
+    }
+    EXPECT_EQ(Expected, Visible);
+    EXPECT_EQ(16u, Visible.size());
+}
+
+TEST_F(InstanceBVHTest, QueryBox)
+{
+    // Contiene las posiciones 0..8 en X y en Z, en las que ahora están las últimas instancias
+    BoundBox Query;
+    Query.Min = float3{-1.0f, -10.0f, -1.0f};
+    Query.Max = float3{9.0f, 10.0f, 9.0f};
+
+    std::vector<Uint32> Result;
+    m_BVH.QueryBox(Query, Result);
+    std::sort(Result.begin(), Result.end());
+
+    std::vector<Uint32> Expected;
+    for (Uint32 i = 0; i < NumCubes; ++i)
+    {
+        if (BoxesOverlap(InstanceBVH::ComputeInstanceBox(m_Moved[i]), Query))
+            Expected.push_back(i);
+    }
+    EXPECT_EQ(Expected, Result);
+    ASSERT_EQ(9u, Result.size());
+    EXPECT_EQ(NumCubes - 1, Result.back()); // La instancia que estaba en la esquina opuesta
+}
+
+TEST_F(InstanceBVHTest, CastRay)
+{
+    // Rayo vertical sobre la posición (12, 20) de la rejilla, que ahora ocupa la instancia simétrica
+    const Uint32 Target  = NumCubes - 1 - (3 * GridSize + 5);
+    float        HitDist = 0;
+    EXPECT_EQ(Target, m_BVH.CastRay(float3{12.0f, 50.0f, 20.0f}, float3{0, -1, 0}, &HitDist));
+    EXPECT_NEAR(50.0f - (1.0f + CubeScale * 1.7320508f), HitDist, 1e-4f);
+
+    // Entre dos cubos no hay impacto
+    EXPECT_EQ(InstanceBVH::InvalidIndex, m_BVH.CastRay(float3{2.0f, 50.0f, 2.0f}, float3{0, -1, 0}));
+
+    // A la altura a la que se construyó el árbol ya no queda ninguna caja
+    EXPECT_EQ(InstanceBVH::InvalidIndex, m_BVH.CastRay(float3{-10.0f, -0.5f, 0.0f}, float3{1, 0, 0}));
+
+    // Rayo horizontal por la primera columna: el impacto más cercano es el primer cubo
+    const Uint32 First = NumCubes - 1;
+    EXPECT_EQ(First, m_BVH.CastRay(float3{-10.0f, 1.0f, 0.0f}, float3{1, 0, 0}, &HitDist));
+    EXPECT_NEAR(10.0f - CubeScale * 1.7320508f, HitDist, 1e-4f);
+}
+
+} // namespace
@@ -0,0 +1,196 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "InstanceData.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Conversión a half float con redondeo al más cercano. Los valores que se codifican
+// (componentes de cuaterniones y escalas de las piezas) nunca son subnormales ni enormes,
+// así que éstos se llevan a cero o a infinito sin más.
+Uint16 FloatToHalf(float Value)
+{
+    Uint32 Bits = 0;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+
+    const Uint32 Sign     = (Bits >> 16) & 0x8000u;
+    const Int32  Exponent = static_cast<Int32>((Bits >> 23) & 0xFFu) - 127 + 15;
+    const Uint32 Mantissa = Bits & 0x7FFFFFu;
+    if (Exponent <= 0)
+        return static_cast<Uint16>(Sign);
+    if (Exponent >= 31)
+        return static_cast<Uint16>(Sign | 0x7C00u);
+
+    // Un acarreo del redondeo pasa correctamente al exponente
+    Uint32 Half = Sign | (static_cast<Uint32>(Exponent) << 10) | (Mantissa >> 13);
+    if ((Mantissa & 0x1000u) != 0)
+        ++Half;
+    return static_cast<Uint16>(Half);
+}
+
+Uint16 EncodeMaterial(float TexSelector)
+{
+    return static_cast<Uint16>(std::max(TexSelector, 0.f) + 0.5f);
+}
+
+void EncodeAffine(const InstanceDataType& Src, AffineInstanceData& Dst)
+{
+    const float4x4& M = Src.Transform;
+    for (Uint32 c = 0; c < 3; ++c)
+        Dst.Columns[c] = float4{M.m[0][c], M.m[1][c], M.m[2][c], M.m[3][c]};
+    Dst.Material = EncodeMaterial(Src.TexSelector);
+    Dst.Padding  = 0;
+}
+
+void EncodeQuatTRS(const InstanceDataType& Src, QuatTRSInstanceData& Dst)
+{
+    const float4x4& M = Src.Transform;
+
+    // Con la convención v * M, cada fila de la parte 3x3 es un eje de la rotación multiplicado
+    // por la escala de ese eje
+    float R[3][3];
+    for (Uint32 r = 0; r < 3; ++r)
+    {
+        const float Scale = std::sqrt(M.m[r][0] * M.m[r][0] + M.m[r][1] * M.m[r][1] + M.m[r][2] * M.m[r][2]);
+        const float Inv   = Scale > 1e-8f ? 1.f / Scale : 0.f;
+        for (Uint32 c = 0; c < 3; ++c)
+            R[r][c] = M.m[r][c] * Inv;
+        Dst.Scale[r]       = FloatToHalf(Scale);
+        Dst.Translation[r] = M.m[3][r];
+    }
+
+    // Cuaternión de la matriz de rotación. R es la traspuesta de la matriz con la convención
+    // M * v, de ahí los índices intercambiados respecto a la fórmula habitual.
+    float       q[4]; // x, y, z, w
+    const float Trace = R[0][0] + R[1][1] + R[2][2];
+    if (Trace > 0)
+    {
+        const float S = std::sqrt(Trace + 1.f) * 2.f;
+        q[3]          = 0.25f * S;
+        q[0]          = (R[1][2] - R[2][1]) / S;
+        q[1]          = (R[2][0] - R[0][2]) / S;
+        q[2]          = (R[0][1] - R[1][0]) / S;
+    }
+    else if (R[0][0] > R[1][1] && R[0][0] > R[2][2])
+    {
+        const float S = std::sqrt(1.f + R[0][0] - R[1][1] - R[2][2]) * 2.f;
+        q[3]          = (R[1][2] - R[2][1]) / S;
+        q[0]          = 0.25f * S;
+        q[1]          = (R[1][0] + R[0][1]) / S;
+        q[2]          = (R[2][0] + R[0][2]) / S;
+    }
+    else if (R[1][1] > R[2][2])
+    {
+        const float S = std::sqrt(1.f + R[1][1] - R[0][0] - R[2][2]) * 2.f;
+        q[3]          = (R[2][0] - R[0][2]) / S;
+        q[0]          = (R[1][0] + R[0][1]) / S;
+        q[1]          = 0.25f * S;
+        q[2]          = (R[2][1] + R[1][2]) / S;
+    }
+    else
+    {
+        const float S = std::sqrt(1.f + R[2][2] - R[0][0] - R[1][1]) * 2.f;
+        q[3]          = (R[0][1] - R[1][0]) / S;
+        q[0]          = (R[2][0] + R[0][2]) / S;
+        q[1]          = (R[2][1] + R[1][2]) / S;
+        q[2]          = 0.25f * S;
+    }
+    for (Uint32 i = 0; i < 4; ++i)
+        Dst.Rotation[i] = FloatToHalf(q[i]);
+
+    Dst.Material = EncodeMaterial(Src.TexSelector);
+}
+
+} // namespace
+
+Uint32 GetInstanceStride(INSTANCE_FORMAT Format)
+{
+    switch (Format)
+    {
+        case INSTANCE_FORMAT_FULL: return sizeof(InstanceDataType);
+        case INSTANCE_FORMAT_AFFINE: return sizeof(AffineInstanceData);
+        case INSTANCE_FORMAT_QUAT_TRS: return sizeof(QuatTRSInstanceData);
+        default:
+            UNEXPECTED("Formato de instancia desconocido");
+            return sizeof(InstanceDataType);
+    }
+}
+
+const char* GetInstanceFormatName(INSTANCE_FORMAT Format)
+{
+    switch (Format)
+    {
+        case INSTANCE_FORMAT_FULL: return "Matriz 4x4 (68 B)";
+        case INSTANCE_FORMAT_AFFINE: return "Afín 3x4 (52 B)";
+        case INSTANCE_FORMAT_QUAT_TRS: return "Cuaternión + TRS (28 B)";
+        default:
+            UNEXPECTED("Formato de instancia desconocido");
+            return "";
+    }
+}
+
+void EncodeInstances(INSTANCE_FORMAT Format, const InstanceDataType* pSrc, Uint32 Count, void* pDst)
+{
+    switch (Format)
+    {
+        case INSTANCE_FORMAT_FULL:
+            std::memcpy(pDst, pSrc, sizeof(InstanceDataType) * Count);
+            break;
+
+        case INSTANCE_FORMAT_AFFINE:
+        {
+            AffineInstanceData* pAffine = static_cast<AffineInstanceData*>(pDst);
+            for (Uint32 i = 0; i < Count; ++i)
+                EncodeAffine(pSrc[i], pAffine[i]);
+            break;
+        }
+
+        case INSTANCE_FORMAT_QUAT_TRS:
+        {
+            QuatTRSInstanceData* pQuat = static_cast<QuatTRSInstanceData*>(pDst);
+            for (Uint32 i = 0; i < Count; ++i)
+                EncodeQuatTRS(pSrc[i], pQuat[i]);
+            break;
+        }
+
+        default:
+            UNEXPECTED("Formato de instancia desconocido");
+    }
+}
+
+} // namespace Diligent
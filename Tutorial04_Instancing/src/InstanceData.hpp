@@ -0,0 +1,86 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Datos por instancia tal y como los lee el vertex shader (atributos 2..6)
+struct InstanceDataType
+{
+    float4x4 Transform;
+    float    TexSelector; // 0 para mezcla 1-2, 1 para mezcla 1-3, 2 para mezcla 1-4
+};
+static_assert(sizeof(InstanceDataType) == sizeof(float) * 17, "El layout de instancia debe estar empaquetado");
+
+// Formatos del buffer de instancias. El CPU siempre genera InstanceDataType y lo codifica al
+// subirlo; los shaders lo decodifican según la macro INSTANCE_FORMAT (instance_decode.fxh).
+enum INSTANCE_FORMAT : Uint8
+{
+    INSTANCE_FORMAT_FULL = 0, // InstanceDataType tal cual
+    INSTANCE_FORMAT_AFFINE,   // AffineInstanceData
+    INSTANCE_FORMAT_QUAT_TRS, // QuatTRSInstanceData
+    INSTANCE_FORMAT_COUNT
+};
+
+// Matriz afín 3x4: la última columna de Transform es siempre (0, 0, 0, 1), así que sólo se
+// guardan las tres primeras columnas
+struct AffineInstanceData
+{
+    float4 Columns[3];
+    Uint16 Material; // TexSelector como entero
+    Uint16 Padding;
+};
+static_assert(sizeof(AffineInstanceData) == 52, "El layout de instancia debe estar empaquetado");
+
+// Escala por eje, rotación y traslación (v * S * R * T). La traslación se mantiene en float:
+// en la rejilla grande las posiciones llegan a cientos de unidades y un half float sólo
+// tendría precisión de décimas.
+struct QuatTRSInstanceData
+{
+    Uint16 Rotation[4];    // Cuaternión unitario (x, y, z, w) en half float
+    float  Translation[3];
+    Uint16 Scale[3];       // Half float
+    Uint16 Material;       // TexSelector como entero
+};
+static_assert(sizeof(QuatTRSInstanceData) == 28, "El layout de instancia debe estar empaquetado");
+
+// Tamaño en bytes de una instancia en el formato Format
+Uint32 GetInstanceStride(INSTANCE_FORMAT Format);
+
+const char* GetInstanceFormatName(INSTANCE_FORMAT Format);
+
+// Codifica Count instancias de pSrc en pDst con el formato Format. Las transformaciones de
+// INSTANCE_FORMAT_QUAT_TRS deben ser escala por eje seguida de rotación y traslación, que es
+// lo que producen las piezas del móvil.
+void EncodeInstances(INSTANCE_FORMAT Format, const InstanceDataType* pSrc, Uint32 Count, void* pDst);
+
+} // namespace Diligent
@@ -0,0 +1,207 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+
+// Pruebas de los formatos compactos del buffer de instancias: cada instancia codificada con
+// EncodeInstances() y decodificada como lo hace instance_decode.fxh debe dar la misma matriz y
+// el mismo material. La decodificación de aquí es una copia en C++ de la de los shaders.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "InstanceData.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Escalas, rotaciones y traslaciones como las de las piezas del móvil y de la rejilla grande,
+// incluidas rotaciones de 180 grados, que llevan a cada rama de la conversión a cuaternión
+std::vector<InstanceDataType> MakeInstances()
+{
+    std::vector<InstanceDataType> Instances;
+    for (Uint32 i = 0; i < 24; ++i)
+    {
+        const float f = static_cast<float>(i);
+
+        float4x4 Rotation = float4x4::RotationY(0.7f * f) * float4x4::RotationX(-0.4f + 0.3f * f) * float4x4::RotationZ(0.2f * f);
+        if (i % 4 == 1)
+            Rotation = float4x4::RotationX(PI_F);
+        else if (i % 4 == 2)
+            Rotation = float4x4::RotationY(PI_F);
+        else if (i % 4 == 3)
+            Rotation = float4x4::RotationZ(PI_F);
+
+        InstanceDataType Instance;
+        Instance.Transform = float4x4::Scale(0.1f + 0.15f * f, 0.85f, 2.0f - 0.05f * f) * Rotation *
+            float4x4::Translation(300.0f - 25.0f * f, 2.6f + f, -180.0f + 16.0f * f);
+        Instance.TexSelector = static_cast<float>(i % 3);
+        Instances.push_back(Instance);
+    }
+    return Instances;
+}
+
+float HalfToFloat(Uint16 Half)
+{
+    const Uint32 Sign     = (Half & 0x8000u) << 16;
+    const Uint32 Exponent = (Half >> 10) & 0x1Fu;
+    const Uint32 Mantissa = Half & 0x3FFu;
+
+    // El codificador lleva los subnormales a cero y no genera NaN
+    Uint32 Bits = Sign;
+    if (Exponent == 31)
+        Bits |= 0x7F800000u;
+    else if (Exponent != 0)
+        Bits |= ((Exponent - 15 + 127) << 23) | (Mantissa << 13);
+
+    float Value = 0;
+    std::memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+// AffineToMatrix() de instance_decode.fxh
+float4x4 DecodeAffine(const AffineInstanceData& Src, float& TexSelector)
+{
+    const float4* Col = Src.Columns;
+
+    float4x4 Mat;
+    for (Uint32 r = 0; r < 4; ++r)
+    {
+        for (Uint32 c = 0; c < 3; ++c)
+            Mat.m[r][c] = Col[c][r];
+        Mat.m[r][3] = r == 3 ? 1.0f : 0.0f;
+    }
+    TexSelector = static_cast<float>(Src.Material);
+    return Mat;
+}
+
+// QuatTRSToMatrix() de instance_decode.fxh
+float4x4 DecodeQuatTRS(const QuatTRSInstanceData& Src, float& TexSelector)
+{
+    const float x = HalfToFloat(Src.Rotation[0]);
+    const float y = HalfToFloat(Src.Rotation[1]);
+    const float z = HalfToFloat(Src.Rotation[2]);
+    const float w = HalfToFloat(Src.Rotation[3]);
+
+    const float Rows[3][3] =
+    {
+        {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y)},
+        {2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x)},
+        {2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y)}
+    };
+
+    float4x4 Mat;
+    for (Uint32 r = 0; r < 3; ++r)
+    {
+        const float Scale = HalfToFloat(Src.Scale[r]);
+        for (Uint32 c = 0; c < 3; ++c)
+            Mat.m[r][c] = Rows[r][c] * Scale;
+        Mat.m[r][3] = 0.0f;
+        Mat.m[3][r] = Src.Translation[r];
+    }
+    Mat.m[3][3] = 1.0f;
+    TexSelector = static_cast<float>(Src.Material);
+    return Mat;
+}
+
+// RotScaleTolerance es relativa a la escala de cada fila; la traslación se compara exacta
+void ExpectMatrixNear(const float4x4& Ref, const float4x4& Val, float RotScaleTolerance, size_t Idx)
+{
+    for (int r = 0; r < 4; ++r)
+    {
+        const float RowScale  = std::sqrt(Ref.m[r][0] * Ref.m[r][0] + Ref.m[r][1] * Ref.m[r][1] + Ref.m[r][2] * Ref.m[r][2]);
+        const float Tolerance = r < 3 ? RotScaleTolerance * std::max(RowScale, 1.0f) : 0.0f;
+        for (int c = 0; c < 4; ++c)
+            EXPECT_NEAR(Ref.m[r][c], Val.m[r][c], Tolerance) << "instancia " << Idx << ", fila " << r << ", columna " << c;
+    }
+}
+
+TEST(InstanceDataTest, Strides)
+{
+    EXPECT_EQ(68u, GetInstanceStride(INSTANCE_FORMAT_FULL));
+    EXPECT_EQ(52u, GetInstanceStride(INSTANCE_FORMAT_AFFINE));
+    EXPECT_EQ(28u, GetInstanceStride(INSTANCE_FORMAT_QUAT_TRS));
+}
+
+TEST(InstanceDataTest, FullRoundTrip)
+{
+    const std::vector<InstanceDataType> Instances = MakeInstances();
+    const Uint32                        Count     = static_cast<Uint32>(Instances.size());
+
+    std::vector<InstanceDataType> Encoded(Count);
+    EncodeInstances(INSTANCE_FORMAT_FULL, Instances.data(), Count, Encoded.data());
+    EXPECT_EQ(0, std::memcmp(Instances.data(), Encoded.data(), sizeof(InstanceDataType) * Count));
+}
+
+TEST(InstanceDataTest, AffineRoundTrip)
+{
+    const std::vector<InstanceDataType> Instances = MakeInstances();
+    const Uint32                        Count     = static_cast<Uint32>(Instances.size());
+
+    // Una instancia más para detectar escrituras fuera de rango
+    std::vector<AffineInstanceData> Encoded(Count + 1);
+    Encoded[Count].Material = 0xCDCD;
+    EncodeInstances(INSTANCE_FORMAT_AFFINE, Instances.data(), Count, Encoded.data());
+
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        float          TexSelector = -1;
+        const float4x4 Decoded     = DecodeAffine(Encoded[i], TexSelector);
+        ExpectMatrixNear(Instances[i].Transform, Decoded, 0.0f, i);
+        EXPECT_EQ(Instances[i].TexSelector, TexSelector) << "instancia " << i;
+        EXPECT_EQ(0u, Encoded[i].Padding) << "instancia " << i;
+    }
+    EXPECT_EQ(0xCDCDu, Encoded[Count].Material);
+}
+
+TEST(InstanceDataTest, QuatTRSRoundTrip)
+{
+    const std::vector<InstanceDataType> Instances = MakeInstances();
+    const Uint32                        Count     = static_cast<Uint32>(Instances.size());
+
+    std::vector<QuatTRSInstanceData> Encoded(Count + 1);
+    Encoded[Count].Material = 0xCDCD;
+    EncodeInstances(INSTANCE_FORMAT_QUAT_TRS, Instances.data(), Count, Encoded.data());
+
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        // El cuaternión y la escala en half float tienen 11 bits de mantisa
+        float          TexSelector = -1;
+        const float4x4 Decoded     = DecodeQuatTRS(Encoded[i], TexSelector);
+        ExpectMatrixNear(Instances[i].Transform, Decoded, 4e-3f, i);
+        EXPECT_EQ(Instances[i].TexSelector, TexSelector) << "instancia " << i;
+    }
+    EXPECT_EQ(0xCDCDu, Encoded[Count].Material);
+}
+
+} // namespace
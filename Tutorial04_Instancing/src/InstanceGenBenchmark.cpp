@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Microbenchmarks de la generación de instancias, sin dispositivo ni ventana. Miden
+// instancias por segundo con el kernel escalar, el mejor kernel SIMD soportado y el pool de
+// hilos, sobre rejillas de 1, 7x7 y 37x37 móviles (24, 1176 y 32856 instancias).
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "BatchTransform.hpp"
+#include "CameraMath.hpp"
+#include "MobileGrid.hpp"
+#include "MobileRig.hpp"
+#include "ThreadPool.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+BATCH_TRANSFORM_ISA GetBestSIMDISA()
+{
+    if (IsBatchTransformISASupported(BATCH_TRANSFORM_ISA_AVX2))
+        return BATCH_TRANSFORM_ISA_AVX2;
+    if (IsBatchTransformISASupported(BATCH_TRANSFORM_ISA_SSE))
+        return BATCH_TRANSFORM_ISA_SSE;
+    return BATCH_TRANSFORM_ISA_COUNT;
+}
+
+// Fija el kernel de matrices durante una prueba y restaura el anterior al terminar
+class ScopedBatchTransformISA
+{
+public:
+    explicit ScopedBatchTransformISA(BATCH_TRANSFORM_ISA ISA) :
+        m_PrevISA{GetBatchTransformISA()},
+        m_Applied{ISA < BATCH_TRANSFORM_ISA_COUNT && SetBatchTransformISA(ISA)}
+    {}
+    ~ScopedBatchTransformISA() { SetBatchTransformISA(m_PrevISA); }
+
+    bool IsApplied() const { return m_Applied; }
+
+private:
+    const BATCH_TRANSFORM_ISA m_PrevISA;
+    const bool                m_Applied;
+};
+
+// Las instancias se generan una vez por iteración, como en cada frame del tutorial
+void RunGridBenchmark(benchmark::State& State, BATCH_TRANSFORM_ISA ISA, WorkStealingThreadPool* pPool)
+{
+    ScopedBatchTransformISA ScopedISA{ISA};
+    if (!ScopedISA.IsApplied())
+    {
+        State.SkipWithError("Kernel de matrices no soportado");
+        return;
+    }
+
+    MobileGrid Grid;
+    Grid.SetGridSize(static_cast<Uint32>(State.range(0)));
+    std::vector<InstanceDataType> Instances(Grid.GetNumInstances());
+
+    MobileAnimState Anim;
+    for (auto _ : State)
+    {
+        if (pPool != nullptr)
+            Grid.WriteInstancesParallel(*pPool, Anim, Instances.data());
+        else
+            Grid.WriteInstances(Anim, 0, Grid.GetNumMobiles(), Instances.data());
+        benchmark::DoNotOptimize(Instances.data());
+        benchmark::ClobberMemory();
+
+        Anim.MainRotation += 0.003f;
+        Anim.FirstTierRotation += 0.005f;
+        Anim.SecondTierRotation += 0.007f;
+    }
+
+    State.SetItemsProcessed(static_cast<int64_t>(State.iterations()) * Grid.GetNumInstances());
+    State.SetLabel(GetBatchTransformISAName(ISA));
+}
+
+void BM_GridScalar(benchmark::State& State)
+{
+    RunGridBenchmark(State, BATCH_TRANSFORM_ISA_SCALAR, nullptr);
+}
+
+void BM_GridSIMD(benchmark::State& State)
+{
+    RunGridBenchmark(State, GetBestSIMDISA(), nullptr);
+}
+
+void BM_GridThreaded(benchmark::State& State)
+{
+    // El hilo llamador también ejecuta bloques en ParallelFor()
+    const Uint32           NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    WorkStealingThreadPool Pool{NumThreads - 1};
+    RunGridBenchmark(State, GetBestSIMDISA(), &Pool);
+    State.counters["threads"] = static_cast<double>(NumThreads);
+}
+
+// Móvil individual del modo por defecto: sólo se recalculan los subárboles de los pivotes
+void BM_MobileRig(benchmark::State& State)
+{
+    const BATCH_TRANSFORM_ISA ISA = State.range(0) != 0 ? GetBestSIMDISA() : BATCH_TRANSFORM_ISA_SCALAR;
+    ScopedBatchTransformISA   ScopedISA{ISA};
+    if (!ScopedISA.IsApplied())
+    {
+        State.SkipWithError("Kernel de matrices no soportado");
+        return;
+    }
+
+    MobileAnimState Anim;
+    MobileRig       Rig;
+    Rig.Build(Anim);
+    InstanceDataType Instances[NumMobileParts];
+    for (auto _ : State)
+    {
+        Anim.MainRotation += 0.003f;
+        Anim.FirstTierRotation += 0.005f;
+        Anim.SecondTierRotation += 0.007f;
+        benchmark::DoNotOptimize(Rig.Update(Anim));
+        Rig.WriteInstances(Instances);
+        benchmark::ClobberMemory();
+    }
+
+    State.SetItemsProcessed(static_cast<int64_t>(State.iterations()) * NumMobileParts);
+    State.SetLabel(GetBatchTransformISAName(ISA));
+}
+
+// Matrices de vista de las tres ventanas, como en UpdateCameraMatrices()
+void BM_CameraMatrices(benchmark::State& State)
+{
+    CameraParams Cameras[3];
+    for (auto _ : State)
+    {
+        Cameras[1].OrbitAngleY += 0.01f;
+        Cameras[2].RotY += 0.01f;
+        benchmark::DoNotOptimize(GetPanZoomViewMatrix(Cameras[0]));
+        benchmark::DoNotOptimize(GetOrbitViewMatrix(Cameras[1]));
+        benchmark::DoNotOptimize(GetFreeViewMatrix(Cameras[2]));
+    }
+    State.SetItemsProcessed(static_cast<int64_t>(State.iterations()) * 3);
+}
+
+} // namespace
+
+// Lado de la rejilla: 24, 1176 y 32856 instancias
+BENCHMARK(BM_GridScalar)->Arg(1)->Arg(7)->Arg(37);
+BENCHMARK(BM_GridSIMD)->Arg(1)->Arg(7)->Arg(37);
+BENCHMARK(BM_GridThreaded)->Arg(1)->Arg(7)->Arg(37)->UseRealTime();
+BENCHMARK(BM_MobileRig)->ArgName("simd")->Arg(0)->Arg(1);
+BENCHMARK(BM_CameraMatrices);
+
+BENCHMARK_MAIN();
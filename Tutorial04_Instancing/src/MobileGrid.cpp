@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <cmath>
+#include <utility>
+
+#include "MobileGrid.hpp"
+#include "BatchTransform.hpp"
+#include "ThreadPool.hpp"
+
+namespace Diligent
+{
+
+MobileGrid::MobileGrid()
+{
+    const MobileMaterialOrder& Order = GetMobileMaterialOrder();
+    for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+    {
+        Uint32 FirstInMaterial = 0;
+        for (Uint32 Level = 0; Level < MOBILE_LEVEL_COUNT; ++Level)
+        {
+            PartGroup Group{static_cast<MOBILE_LEVEL>(Level), Material, FirstInMaterial, {}, {}};
+            for (Uint32 i = Order.FirstPart[Material]; i < Order.FirstPart[Material + 1]; ++i)
+            {
+                const MobilePart& Part = MobileParts[Order.Parts[i]];
+                if (Part.Level == Level)
+                {
+                    Group.Local.push_back(Part.GetLocalTransform());
+                    Group.TexSelector.push_back(Part.TexSelector);
+                }
+            }
+            if (!Group.Local.empty())
+            {
+                FirstInMaterial += static_cast<Uint32>(Group.Local.size());
+                m_Groups.push_back(std::move(Group));
+            }
+        }
+    }
+}
+
+void MobileGrid::GetMaterialRange(Uint32 Material, Uint32 FirstMobile, Uint32 NumMobiles, Uint32& FirstInstance, Uint32& NumInstances) const
+{
+    const MobileMaterialOrder& Order          = GetMobileMaterialOrder();
+    const Uint32               PartsPerMobile = Order.GetNumParts(Material);
+
+    FirstInstance = GetNumMobiles() * Order.FirstPart[Material] + FirstMobile * PartsPerMobile;
+    NumInstances  = NumMobiles * PartsPerMobile;
+}
+
+float MobileGrid::GetMobilePhase(Uint32 MobileIdx)
+{
+    // Secuencia de la razón áurea: fases bien repartidas en [0, 2*PI)
+    const float Frac = static_cast<float>(MobileIdx) * 0.618034f;
+    return (Frac - std::floor(Frac)) * 2.0f * PI_F;
+}
+
+float3 MobileGrid::GetMobileOffset(Uint32 MobileIdx) const
+{
+    const float Center = 0.5f * static_cast<float>(m_GridSize - 1);
+    const float X      = static_cast<float>(MobileIdx % m_GridSize) - Center;
+    const float Z      = static_cast<float>(MobileIdx / m_GridSize) - Center;
+    return float3{X * MobileSpacing, 0.0f, Z * MobileSpacing};
+}
+
+void MobileGrid::WriteInstances(const MobileAnimState& State,
+                                Uint32                 FirstMobile,
+                                Uint32                 NumMobiles,
+                                InstanceDataType*      pInstances) const
+{
+    for (Uint32 MobileIdx = FirstMobile; MobileIdx < FirstMobile + NumMobiles; ++MobileIdx)
+    {
+        const float  Phase  = GetMobilePhase(MobileIdx);
+        const float3 Offset = GetMobileOffset(MobileIdx);
+
+        MobileAnimState MobileState = State;
+        MobileState.MainRotation += Phase;
+        MobileState.SecondTierRotation += 2.0f * Phase;
+
+        float4x4 LevelMatrix[MOBILE_LEVEL_COUNT];
+        LevelMatrix[MOBILE_LEVEL_STATIC] = float4x4::Translation(Offset.x, Offset.y, Offset.z);
+        LevelMatrix[MOBILE_LEVEL_FIRST]  = GetMobileFirstLevelPivot(MobileState) * LevelMatrix[MOBILE_LEVEL_STATIC];
+        LevelMatrix[MOBILE_LEVEL_SECOND] = GetMobileSecondLevelPivot(MobileState) * LevelMatrix[MOBILE_LEVEL_FIRST];
+
+        for (const PartGroup& Group : m_Groups)
+        {
+            Uint32 FirstInstance = 0, NumInstances = 0;
+            GetMaterialRange(Group.Material, MobileIdx, 1, FirstInstance, NumInstances);
+            BatchComposeInstances(Group.Local.data(), Group.TexSelector.data(), LevelMatrix[Group.Level],
+                                  pInstances + FirstInstance + Group.FirstInMaterial, Group.Local.size());
+        }
+    }
+}
+
+void MobileGrid::WriteInstancesParallel(WorkStealingThreadPool&                     Pool,
+                                        const MobileAnimState&                      State,
+                                        InstanceDataType*                           pInstances,
+                                        const std::function<void(Uint32, Uint32)>& OnChunk) const
+{
+    // Cada bloque escribe un rango disjunto de cada material
+    Pool.ParallelFor(GetNumMobiles(), MobilesPerChunk,
+                     [&](Uint32 FirstMobile, Uint32 EndMobile) {
+                         WriteInstances(State, FirstMobile, EndMobile - FirstMobile, pInstances);
+                         if (OnChunk)
+                             OnChunk(FirstMobile, EndMobile - FirstMobile);
+                     });
+}
+
+} // namespace Diligent
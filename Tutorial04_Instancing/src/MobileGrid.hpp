@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "InstanceData.hpp"
+#include "MobileLayout.hpp"
+
+namespace Diligent
+{
+
+class WorkStealingThreadPool;
+
+// Rejilla de GridSize x GridSize móviles sobre el plano XZ. Cada móvil tiene su propia fase
+// de animación. Las instancias se ordenan por material: primero las piezas del material 0 de
+// todos los móviles, después las del material 1, etc., para dibujar cada material con un único
+// draw. Dentro de cada material las piezas de un móvil son contiguas, así que rangos disjuntos
+// de móviles siguen pudiendo generarse en paralelo sobre el mismo buffer.
+class MobileGrid
+{
+public:
+    static constexpr float MobileSpacing = 10.0f;
+
+    // 16 móviles (384 instancias) por bloque en WriteInstancesParallel()
+    static constexpr Uint32 MobilesPerChunk = 16;
+
+    MobileGrid();
+
+    void   SetGridSize(Uint32 GridSize) { m_GridSize = GridSize; }
+    Uint32 GetGridSize() const { return m_GridSize; }
+    Uint32 GetNumMobiles() const { return m_GridSize * m_GridSize; }
+    Uint32 GetNumInstances() const { return GetNumMobiles() * NumMobileParts; }
+
+    // Fase de animación determinista del móvil
+    static float GetMobilePhase(Uint32 MobileIdx);
+
+    // Posición del móvil en la rejilla (centrada en el origen)
+    float3 GetMobileOffset(Uint32 MobileIdx) const;
+
+    // Rango de instancias del material Material que ocupan los móviles
+    // [FirstMobile, FirstMobile + NumMobiles)
+    void GetMaterialRange(Uint32 Material, Uint32 FirstMobile, Uint32 NumMobiles, Uint32& FirstInstance, Uint32& NumInstances) const;
+
+    // Escribe las instancias de los móviles [FirstMobile, FirstMobile + NumMobiles).
+    // pInstances apunta al comienzo del buffer de instancias completo.
+    void WriteInstances(const MobileAnimState& State,
+                        Uint32                 FirstMobile,
+                        Uint32                 NumMobiles,
+                        InstanceDataType*      pInstances) const;
+
+    // Escribe todos los móviles repartiendo bloques de MobilesPerChunk móviles entre los hilos
+    // de Pool. Si OnChunk no está vacía, se llama con el rango de móviles de cada bloque en el
+    // mismo hilo, justo después de escribirlo, mientras sus instancias siguen en caché.
+    void WriteInstancesParallel(WorkStealingThreadPool&                     Pool,
+                                const MobileAnimState&                      State,
+                                InstanceDataType*                           pInstances,
+                                const std::function<void(Uint32, Uint32)>& OnChunk = {}) const;
+
+private:
+    Uint32 m_GridSize = 1;
+
+    // Piezas de un mismo material y nivel, para componerlas por lotes con la matriz de su nivel
+    struct PartGroup
+    {
+        MOBILE_LEVEL          Level;
+        Uint32                Material;
+        Uint32                FirstInMaterial; // Posición del grupo entre las piezas de su material
+        std::vector<float4x4> Local;
+        std::vector<float>    TexSelector;
+    };
+    std::vector<PartGroup> m_Groups;
+};
+
+} // namespace Diligent
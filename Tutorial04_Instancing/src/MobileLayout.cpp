@@ -0,0 +1,111 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "MobileLayout.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+// clang-format off
+const MobilePart MobileParts[NumMobileParts] =
+{
+    // Base principal (placa superior)
+    {MOBILE_LEVEL_STATIC, float3{1.6f, 0.1f, 1.6f}, float3{0.0f, 4.8f, 0.0f}, 0.0f},
+
+    // === PRIMER NIVEL ===
+    // Palo central vertical
+    {MOBILE_LEVEL_STATIC, float3{0.1f, 1.0f, 0.1f}, float3{0.0f, 3.65f, 0.0f}, 1.0f},
+
+    // Brazos horizontales del primer nivel
+    {MOBILE_LEVEL_FIRST,  float3{3.6f, 0.1f, 0.1f}, float3{0.0f, 2.6f, 0.0f}, 1.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.1f, 0.1f, 3.6f}, float3{0.0f, 2.6f, 0.0f}, 1.0f},
+
+    // Cubos del primer nivel
+    {MOBILE_LEVEL_FIRST,  float3{0.6f, 0.6f, 0.6f}, float3{ 3.0f, 2.0f,  0.0f}, 0.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.6f, 0.6f, 0.6f}, float3{-3.0f, 2.0f,  0.0f}, 1.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.6f, 0.6f, 0.6f}, float3{ 0.0f, 2.0f,  3.0f}, 2.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.6f, 0.6f, 0.6f}, float3{ 0.0f, 2.0f, -3.0f}, 0.0f},
+
+    // === SEGUNDO NIVEL ===
+    // Palos verticales conectores
+    {MOBILE_LEVEL_FIRST,  float3{0.1f, 0.85f, 0.1f}, float3{ 0.0f, 0.85f,  3.0f}, 1.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.1f, 0.85f, 0.1f}, float3{ 0.0f, 0.85f, -3.0f}, 1.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.1f, 0.85f, 0.1f}, float3{ 3.0f, 0.85f,  0.0f}, 1.0f},
+    {MOBILE_LEVEL_FIRST,  float3{0.1f, 0.85f, 0.1f}, float3{-3.0f, 0.85f,  0.0f}, 1.0f},
+
+    // Brazos horizontales del segundo nivel
+    {MOBILE_LEVEL_SECOND, float3{2.0f, 0.1f, 0.1f}, float3{ 0.0f, 0.2f,  3.0f}, 1.0f},
+    {MOBILE_LEVEL_SECOND, float3{2.0f, 0.1f, 0.1f}, float3{ 0.0f, 0.2f, -3.0f}, 1.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.1f, 0.1f, 2.0f}, float3{ 3.0f, 0.2f,  0.0f}, 1.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.1f, 0.1f, 2.0f}, float3{-3.0f, 0.2f,  0.0f}, 1.0f},
+
+    // Cubos del segundo nivel (alternamos entre las mezclas 0, 1 y 2)
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{ 1.0f, -0.4f,  3.0f}, 0.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{-1.0f, -0.4f,  3.0f}, 1.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{ 1.0f, -0.4f, -3.0f}, 2.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{-1.0f, -0.4f, -3.0f}, 0.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{ 3.0f, -0.4f,  1.0f}, 1.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{ 3.0f, -0.4f, -1.0f}, 2.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{-3.0f, -0.4f,  1.0f}, 0.0f},
+    {MOBILE_LEVEL_SECOND, float3{0.6f, 0.6f, 0.6f}, float3{-3.0f, -0.4f, -1.0f}, 1.0f},
+};
+// clang-format on
+
+const MobileMaterialOrder& GetMobileMaterialOrder()
+{
+    static const MobileMaterialOrder Order = [] {
+        MobileMaterialOrder Res = {};
+        Uint32              Pos = 0;
+        for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+        {
+            Res.FirstPart[Material] = Pos;
+            for (Uint32 i = 0; i < NumMobileParts; ++i)
+            {
+                if (static_cast<Uint32>(MobileParts[i].TexSelector) == Material)
+                    Res.Parts[Pos++] = i;
+            }
+        }
+        Res.FirstPart[NumMobileMaterials] = Pos;
+        VERIFY(Pos == NumMobileParts, "Hay piezas con un material fuera de rango");
+        return Res;
+    }();
+    return Order;
+}
+
+float4x4 GetMobileFirstLevelPivot(const MobileAnimState& State)
+{
+    return float4x4::RotationY(State.MainRotation) * float4x4::RotationY(State.FirstTierRotation);
+}
+
+float4x4 GetMobileSecondLevelPivot(const MobileAnimState& State)
+{
+    return float4x4::RotationY(State.SecondTierRotation);
+}
+
+} // namespace Diligent
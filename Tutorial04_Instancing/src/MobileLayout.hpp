@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Nivel de la jerarquía del móvil del que cuelga cada pieza
+enum MOBILE_LEVEL : Uint32
+{
+    MOBILE_LEVEL_STATIC = 0, // Base y palo central: nunca se mueven
+    MOBILE_LEVEL_FIRST,      // Gira con la rotación principal + primer nivel
+    MOBILE_LEVEL_SECOND,     // Gira además con la rotación del segundo nivel
+    MOBILE_LEVEL_COUNT
+};
+
+// Ángulos animados del móvil
+struct MobileAnimState
+{
+    float MainRotation       = 0.0f;
+    float FirstTierRotation  = 0.0f;
+    float SecondTierRotation = 0.0f;
+};
+
+// Descripción de una pieza del móvil: un cubo escalado y desplazado respecto a su nivel
+struct MobilePart
+{
+    MOBILE_LEVEL Level;
+    float3       Scale;
+    float3       Offset;
+    float        TexSelector; // 0 para mezcla 1-2, 1 para mezcla 1-3, 2 para mezcla 1-4
+
+    float4x4 GetLocalTransform() const
+    {
+        return float4x4::Scale(Scale.x, Scale.y, Scale.z) * float4x4::Translation(Offset.x, Offset.y, Offset.z);
+    }
+};
+
+static constexpr Uint32 NumMobileParts = 24;
+
+// Materiales del móvil: el material de una pieza es su TexSelector
+static constexpr Uint32 NumMobileMaterials = 3;
+
+// Disposición de las piezas del móvil
+extern const MobilePart MobileParts[NumMobileParts];
+
+// Piezas del móvil agrupadas por material, conservando el orden original dentro de cada
+// material. Las piezas del material m son Parts[FirstPart[m]] .. Parts[FirstPart[m + 1] - 1].
+struct MobileMaterialOrder
+{
+    Uint32 Parts[NumMobileParts];
+    Uint32 FirstPart[NumMobileMaterials + 1];
+
+    Uint32 GetNumParts(Uint32 Material) const { return FirstPart[Material + 1] - FirstPart[Material]; }
+};
+const MobileMaterialOrder& GetMobileMaterialOrder();
+
+// Transformaciones locales de los pivotes animados: el primer nivel cuelga de la raíz y el
+// segundo del primero
+float4x4 GetMobileFirstLevelPivot(const MobileAnimState& State);
+float4x4 GetMobileSecondLevelPivot(const MobileAnimState& State);
+
+} // namespace Diligent
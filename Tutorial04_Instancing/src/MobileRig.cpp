@@ -0,0 +1,89 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "MobileRig.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void MobileRig::Build(const MobileAnimState& State)
+{
+    m_Graph.Clear();
+
+    // Pivotes animados: el segundo nivel cuelga del primero
+    m_PivotNodes[0] = m_Graph.AddNode(TransformGraph::InvalidNode, GetMobileFirstLevelPivot(State), false);
+    m_PivotNodes[1] = m_Graph.AddNode(m_PivotNodes[0], GetMobileSecondLevelPivot(State), false);
+
+    for (Uint32 i = 0; i < NumMobileParts; ++i)
+    {
+        const MobilePart& Part = MobileParts[i];
+        switch (Part.Level)
+        {
+            case MOBILE_LEVEL_STATIC:
+                // La base y el palo central no se mueven: su matriz de mundo queda en caché
+                m_PartNodes[i] = m_Graph.AddNode(TransformGraph::InvalidNode, Part.GetLocalTransform(), true);
+                break;
+
+            case MOBILE_LEVEL_FIRST:
+                m_PartNodes[i] = m_Graph.AddNode(m_PivotNodes[0], Part.GetLocalTransform(), false);
+                break;
+
+            case MOBILE_LEVEL_SECOND:
+                m_PartNodes[i] = m_Graph.AddNode(m_PivotNodes[1], Part.GetLocalTransform(), false);
+                break;
+
+            default:
+                UNEXPECTED("Nivel de pieza desconocido");
+        }
+    }
+}
+
+Uint32 MobileRig::Update(const MobileAnimState& State)
+{
+    VERIFY(m_Graph.GetNumNodes() > 0, "Build() no se ha llamado");
+
+    // Sólo cambian las transformaciones locales de los pivotes; el grafo recalcula
+    // únicamente los subárboles afectados
+    m_Graph.SetLocalTransform(m_PivotNodes[0], GetMobileFirstLevelPivot(State));
+    m_Graph.SetLocalTransform(m_PivotNodes[1], GetMobileSecondLevelPivot(State));
+    return m_Graph.Update();
+}
+
+void MobileRig::WriteInstances(InstanceDataType* pInstances) const
+{
+    const MobileMaterialOrder& Order = GetMobileMaterialOrder();
+    for (Uint32 i = 0; i < NumMobileParts; ++i)
+    {
+        const Uint32 Part         = Order.Parts[i];
+        pInstances[i].Transform   = m_Graph.GetWorldTransform(m_PartNodes[Part]);
+        pInstances[i].TexSelector = MobileParts[Part].TexSelector;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Reloj de simulación a paso fijo. Acumula el tiempo real de cada frame y lo convierte en
+// ticks de duración constante, de modo que la animación avanza igual a cualquier frecuencia
+// de presentación. GetAlpha() es la fracción del siguiente tick ya transcurrida, con la que el
+// render interpola entre los dos últimos estados simulados.
+class SimClock
+{
+public:
+    // Tras una pausa larga (un punto de ruptura, una ventana arrastrada) no se intenta recuperar
+    // todo el tiempo perdido: el resto se descarta
+    static constexpr Uint32 MaxTicksPerUpdate = 8;
+
+    void SetTickRate(Uint32 TicksPerSecond)
+    {
+        m_TickRate    = std::max(TicksPerSecond, 1u);
+        m_Accumulator = std::min(m_Accumulator, GetTickDuration());
+    }
+    Uint32 GetTickRate() const { return m_TickRate; }
+    double GetTickDuration() const { return 1.0 / m_TickRate; }
+
+    // Suma ElapsedTime y devuelve cuántos ticks hay que simular en este frame
+    Uint32 Advance(double ElapsedTime)
+    {
+        const double TickDuration = GetTickDuration();
+        // Sin la tolerancia, 4 frames de 1/240 s pueden quedarse justo por debajo de 1/60 s
+        const double Epsilon = TickDuration * 1e-6;
+
+        m_Accumulator += std::max(ElapsedTime, 0.0);
+        Uint32 NumTicks = 0;
+        while (m_Accumulator + Epsilon >= TickDuration && NumTicks < MaxTicksPerUpdate)
+        {
+            m_Accumulator -= TickDuration;
+            ++NumTicks;
+        }
+        if (m_Accumulator + Epsilon >= TickDuration)
+            m_Accumulator = std::fmod(m_Accumulator, TickDuration);
+        m_Accumulator = std::max(m_Accumulator, 0.0);
+
+        m_NumTicks += NumTicks;
+        return NumTicks;
+    }
+
+    float  GetAlpha() const { return static_cast<float>(std::min(m_Accumulator * m_TickRate, 1.0)); }
+    Uint64 GetNumTicks() const { return m_NumTicks; }
+
+    void Reset()
+    {
+        m_Accumulator = 0;
+        m_NumTicks    = 0;
+    }
+
+private:
+    Uint32 m_TickRate    = 60;
+    double m_Accumulator = 0;
+    Uint64 m_NumTicks    = 0;
+};
+
+} // namespace Diligent
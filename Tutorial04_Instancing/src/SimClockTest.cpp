@@ -0,0 +1,137 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+
+// Pruebas del reloj de simulación a paso fijo: ticks por frame a distintas frecuencias de
+// presentación, el límite de ticks tras una pausa y la fracción de interpolación.
+
+#include <gtest/gtest.h>
+
+#include "SimClock.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Presenta FramesPerTick frames por tick durante 10 ticks: un tick cada FramesPerTick frames y
+// alfa avanzando 1 / FramesPerTick por frame
+void ExpectOneTickEvery(Uint32 TickRate, Uint32 FramesPerTick)
+{
+    SimClock Clock;
+    Clock.SetTickRate(TickRate);
+    const double FrameTime = 1.0 / (TickRate * FramesPerTick);
+    for (Uint32 Tick = 0; Tick < 10; ++Tick)
+    {
+        for (Uint32 Frame = 1; Frame < FramesPerTick; ++Frame)
+        {
+            EXPECT_EQ(0u, Clock.Advance(FrameTime)) << "tick " << Tick << ", frame " << Frame;
+            EXPECT_NEAR(static_cast<float>(Frame) / FramesPerTick, Clock.GetAlpha(), 1e-4f) << "tick " << Tick << ", frame " << Frame;
+        }
+        // La tolerancia evita que el último frame se quede justo por debajo del tick
+        EXPECT_EQ(1u, Clock.Advance(FrameTime)) << "tick " << Tick;
+        EXPECT_NEAR(0.0f, Clock.GetAlpha(), 1e-4f) << "tick " << Tick;
+    }
+    EXPECT_EQ(10u, Clock.GetNumTicks());
+}
+
+TEST(SimClockTest, TicksAtHigherFrameRate)
+{
+    ExpectOneTickEvery(60, 4); // 240 fps
+    // Sin la tolerancia, la suma de seis frames de 1/540 s se queda por debajo de 1/90 s
+    ExpectOneTickEvery(90, 6);
+}
+
+TEST(SimClockTest, TicksAtLowerFrameRate)
+{
+    // 40 fps con ticks de 60 Hz: 1.5 ticks por frame
+    SimClock Clock;
+    Clock.SetTickRate(60);
+    EXPECT_EQ(1u, Clock.Advance(1.0 / 40.0));
+    EXPECT_NEAR(0.5f, Clock.GetAlpha(), 1e-4f);
+    EXPECT_EQ(2u, Clock.Advance(1.0 / 40.0));
+    EXPECT_NEAR(0.0f, Clock.GetAlpha(), 1e-4f);
+    EXPECT_EQ(3u, Clock.GetNumTicks());
+}
+
+TEST(SimClockTest, LongPauseIsCapped)
+{
+    // Medio segundo a 60 Hz serían 30 ticks: se simulan MaxTicksPerUpdate y se descarta el resto
+    // salvo la fracción del tick en curso
+    SimClock Clock;
+    Clock.SetTickRate(60);
+    EXPECT_EQ(SimClock::MaxTicksPerUpdate, Clock.Advance(0.51));
+    EXPECT_NEAR(0.6f, Clock.GetAlpha(), 1e-3f);
+    EXPECT_EQ(0u, Clock.Advance(0.0));
+    EXPECT_EQ(Uint64{SimClock::MaxTicksPerUpdate}, Clock.GetNumTicks());
+}
+
+TEST(SimClockTest, NegativeTimeIsIgnored)
+{
+    SimClock Clock;
+    Clock.SetTickRate(60);
+    Clock.Advance(1.0 / 120.0);
+    EXPECT_EQ(0u, Clock.Advance(-1.0));
+    EXPECT_NEAR(0.5f, Clock.GetAlpha(), 1e-4f);
+}
+
+TEST(SimClockTest, ChangeTickRate)
+{
+    SimClock Clock;
+    Clock.SetTickRate(60);
+    Clock.Advance(0.75 / 60.0);
+    EXPECT_NEAR(0.75f, Clock.GetAlpha(), 1e-4f);
+
+    // Con un tick más corto que el tiempo acumulado, este se recorta a un tick: alfa no pasa de
+    // 1 y el siguiente Advance() simula ese tick
+    Clock.SetTickRate(240);
+    EXPECT_EQ(240u, Clock.GetTickRate());
+    EXPECT_FLOAT_EQ(1.0f, Clock.GetAlpha());
+    EXPECT_EQ(1u, Clock.Advance(0.0));
+    EXPECT_NEAR(0.0f, Clock.GetAlpha(), 1e-4f);
+
+    // Una frecuencia nula se lleva a un tick por segundo
+    Clock.SetTickRate(0);
+    EXPECT_EQ(1u, Clock.GetTickRate());
+    EXPECT_DOUBLE_EQ(1.0, Clock.GetTickDuration());
+}
+
+TEST(SimClockTest, Reset)
+{
+    SimClock Clock;
+    Clock.SetTickRate(60);
+    Clock.Advance(2.5 / 60.0);
+    EXPECT_EQ(2u, Clock.GetNumTicks());
+
+    Clock.Reset();
+    EXPECT_EQ(0u, Clock.GetNumTicks());
+    EXPECT_FLOAT_EQ(0.0f, Clock.GetAlpha());
+    EXPECT_EQ(60u, Clock.GetTickRate());
+}
+
+} // namespace
@@ -0,0 +1,374 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Conversor de las texturas del móvil: reescala cada imagen a una capa cuadrada, genera la
+// cadena de mips en espacio lineal y la comprime en BC1 (o BC3 si hace falta alfa). El
+// resultado es un único DDS con un Texture2DArray sRGB que el sample carga sin decodificar ni
+// generar mips.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BlockCompression.hpp"
+#include "Image.h"
+#include "RefCntAutoPtr.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+struct ConverterArgs
+{
+    const char*              OutputPath = nullptr;
+    Uint32                   Size       = 256;
+    bool                     BC3        = false;
+    std::vector<const char*> Inputs;
+};
+
+void PrintUsage(const char* ExeName)
+{
+    std::printf("Usage: %s [options] -o OUTPUT.dds INPUT...\n"
+                "  --format bc1|bc3    Block compression; bc3 keeps the alpha channel (default: bc1)\n"
+                "  --size N            Width and height of every layer, a power of two (default: 256)\n"
+                "Each input image becomes one layer of an sRGB texture array with a full mip chain.\n",
+                ExeName);
+}
+
+bool ParseArgs(int argc, char** argv, ConverterArgs& Args)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* Arg = argv[i];
+        if (Arg[0] != '-')
+        {
+            Args.Inputs.push_back(Arg);
+            continue;
+        }
+
+        const char* Value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (Value == nullptr)
+            return false;
+        ++i;
+
+        if (std::strcmp(Arg, "-o") == 0)
+            Args.OutputPath = Value;
+        else if (std::strcmp(Arg, "--format") == 0)
+        {
+            if (std::strcmp(Value, "bc1") == 0)
+                Args.BC3 = false;
+            else if (std::strcmp(Value, "bc3") == 0)
+                Args.BC3 = true;
+            else
+                return false;
+        }
+        else if (std::strcmp(Arg, "--size") == 0)
+        {
+            char* End = nullptr;
+            Args.Size = static_cast<Uint32>(std::strtoul(Value, &End, 10));
+            if (End == Value || *End != '\0' || Args.Size < 4 || (Args.Size & (Args.Size - 1)) != 0)
+                return false;
+        }
+        else
+            return false;
+    }
+    return Args.OutputPath != nullptr && !Args.Inputs.empty();
+}
+
+float SRGBToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+}
+
+// Imagen RGBA en coma flotante con el color en espacio lineal: los mips se promedian así para
+// que no se oscurezcan
+struct LinearImage
+{
+    Uint32             Width  = 0;
+    Uint32             Height = 0;
+    std::vector<float> Pixels;
+
+    float*       Pixel(Uint32 x, Uint32 y) { return &Pixels[(y * Width + x) * 4]; }
+    const float* Pixel(Uint32 x, Uint32 y) const { return &Pixels[(y * Width + x) * 4]; }
+};
+
+bool LoadLinearImage(const char* Path, LinearImage& Img)
+{
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile(Path, &pImage, nullptr);
+    if (!pImage)
+    {
+        std::fprintf(stderr, "Failed to load %s\n", Path);
+        return false;
+    }
+
+    const ImageDesc& Desc = pImage->GetDesc();
+    if (Desc.ComponentType != VT_UINT8 || Desc.NumComponents == 0 || Desc.NumComponents > 4)
+    {
+        std::fprintf(stderr, "%s: only 8-bit images with 1 to 4 channels are supported\n", Path);
+        return false;
+    }
+
+    Img.Width  = Desc.Width;
+    Img.Height = Desc.Height;
+    Img.Pixels.resize(size_t{Desc.Width} * Desc.Height * 4);
+
+    const Uint8* pData = static_cast<const Uint8*>(pImage->GetData()->GetDataPtr());
+    for (Uint32 y = 0; y < Desc.Height; ++y)
+    {
+        const Uint8* pRow = pData + size_t{y} * Desc.RowStride;
+        for (Uint32 x = 0; x < Desc.Width; ++x)
+        {
+            const Uint8* pSrc = pRow + x * Desc.NumComponents;
+            float*       pDst = Img.Pixel(x, y);
+            // Una o dos componentes son escala de grises, con alfa en la segunda
+            const bool Grey = Desc.NumComponents < 3;
+            for (Uint32 c = 0; c < 3; ++c)
+                pDst[c] = SRGBToLinear(pSrc[Grey ? 0 : c] / 255.f);
+            const Uint32 AlphaIdx = Grey ? 1 : 3;
+            pDst[3]               = AlphaIdx < Desc.NumComponents ? pSrc[AlphaIdx] / 255.f : 1.f;
+        }
+    }
+    return true;
+}
+
+// Reescala a Size x Size: promedio del área de origen al reducir, bilineal al ampliar
+LinearImage ResizeImage(const LinearImage& Src, Uint32 Size)
+{
+    LinearImage Dst;
+    Dst.Width  = Size;
+    Dst.Height = Size;
+    Dst.Pixels.resize(size_t{Size} * Size * 4);
+
+    for (Uint32 y = 0; y < Size; ++y)
+    {
+        for (Uint32 x = 0; x < Size; ++x)
+        {
+            float* pDst = Dst.Pixel(x, y);
+            if (Src.Width >= Size && Src.Height >= Size)
+            {
+                const Uint32 x0 = x * Src.Width / Size, x1 = std::max((x + 1) * Src.Width / Size, x0 + 1);
+                const Uint32 y0 = y * Src.Height / Size, y1 = std::max((y + 1) * Src.Height / Size, y0 + 1);
+
+                float Sum[4] = {};
+                for (Uint32 sy = y0; sy < y1; ++sy)
+                {
+                    for (Uint32 sx = x0; sx < x1; ++sx)
+                    {
+                        for (Uint32 c = 0; c < 4; ++c)
+                            Sum[c] += Src.Pixel(sx, sy)[c];
+                    }
+                }
+                const float Scale = 1.f / static_cast<float>((x1 - x0) * (y1 - y0));
+                for (Uint32 c = 0; c < 4; ++c)
+                    pDst[c] = Sum[c] * Scale;
+            }
+            else
+            {
+                const float  u  = std::max((x + 0.5f) * Src.Width / Size - 0.5f, 0.f);
+                const float  v  = std::max((y + 0.5f) * Src.Height / Size - 0.5f, 0.f);
+                const Uint32 x0 = std::min(static_cast<Uint32>(u), Src.Width - 1);
+                const Uint32 y0 = std::min(static_cast<Uint32>(v), Src.Height - 1);
+                const Uint32 x1 = std::min(x0 + 1, Src.Width - 1);
+                const Uint32 y1 = std::min(y0 + 1, Src.Height - 1);
+                const float  fx = u - x0;
+                const float  fy = v - y0;
+                for (Uint32 c = 0; c < 4; ++c)
+                {
+                    const float Top    = Src.Pixel(x0, y0)[c] * (1 - fx) + Src.Pixel(x1, y0)[c] * fx;
+                    const float Bottom = Src.Pixel(x0, y1)[c] * (1 - fx) + Src.Pixel(x1, y1)[c] * fx;
+                    pDst[c]            = Top * (1 - fy) + Bottom * fy;
+                }
+            }
+        }
+    }
+    return Dst;
+}
+
+// Siguiente mip con un filtro de caja de 2x2
+LinearImage Downsample(const LinearImage& Src)
+{
+    LinearImage Dst;
+    Dst.Width  = std::max(Src.Width / 2, 1u);
+    Dst.Height = std::max(Src.Height / 2, 1u);
+    Dst.Pixels.resize(size_t{Dst.Width} * Dst.Height * 4);
+    for (Uint32 y = 0; y < Dst.Height; ++y)
+    {
+        for (Uint32 x = 0; x < Dst.Width; ++x)
+        {
+            const Uint32 sx0 = std::min(x * 2, Src.Width - 1), sx1 = std::min(x * 2 + 1, Src.Width - 1);
+            const Uint32 sy0 = std::min(y * 2, Src.Height - 1), sy1 = std::min(y * 2 + 1, Src.Height - 1);
+            for (Uint32 c = 0; c < 4; ++c)
+                Dst.Pixel(x, y)[c] = (Src.Pixel(sx0, sy0)[c] + Src.Pixel(sx1, sy0)[c] + Src.Pixel(sx0, sy1)[c] + Src.Pixel(sx1, sy1)[c]) * 0.25f;
+        }
+    }
+    return Dst;
+}
+
+std::vector<Uint8> ToSRGB8(const LinearImage& Img)
+{
+    std::vector<Uint8> Data(Img.Pixels.size());
+    for (size_t i = 0; i < Img.Pixels.size(); ++i)
+    {
+        const float Value = (i % 4) == 3 ? Img.Pixels[i] : LinearToSRGB(Img.Pixels[i]);
+        Data[i]           = static_cast<Uint8>(std::min(std::max(Value, 0.f), 1.f) * 255.f + 0.5f);
+    }
+    return Data;
+}
+
+// Cabeceras DDS con la extensión DX10, necesaria para los arrays de texturas
+// clang-format off
+constexpr Uint32 DDSMagic                   = 0x20534444; // "DDS "
+constexpr Uint32 DDSFourCCDX10              = 0x30315844; // "DX10"
+constexpr Uint32 DDSD_CAPS                  = 0x1;
+constexpr Uint32 DDSD_HEIGHT                = 0x2;
+constexpr Uint32 DDSD_WIDTH                 = 0x4;
+constexpr Uint32 DDSD_PIXELFORMAT           = 0x1000;
+constexpr Uint32 DDSD_MIPMAPCOUNT           = 0x20000;
+constexpr Uint32 DDSD_LINEARSIZE            = 0x80000;
+constexpr Uint32 DDPF_FOURCC                = 0x4;
+constexpr Uint32 DDSCAPS_COMPLEX            = 0x8;
+constexpr Uint32 DDSCAPS_TEXTURE            = 0x1000;
+constexpr Uint32 DDSCAPS_MIPMAP             = 0x400000;
+constexpr Uint32 DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+constexpr Uint32 DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+constexpr Uint32 DDS_DIMENSION_TEXTURE2D    = 3;
+// clang-format on
+
+struct DDSHeader
+{
+    Uint32 Size;
+    Uint32 Flags;
+    Uint32 Height;
+    Uint32 Width;
+    Uint32 PitchOrLinearSize;
+    Uint32 Depth;
+    Uint32 MipMapCount;
+    Uint32 Reserved1[11];
+    Uint32 PFSize;
+    Uint32 PFFlags;
+    Uint32 PFFourCC;
+    Uint32 PFRGBBitCount;
+    Uint32 PFBitMasks[4];
+    Uint32 Caps[4];
+    Uint32 Reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "La cabecera DDS debe ocupar 124 bytes");
+
+struct DDSHeaderDX10
+{
+    Uint32 DXGIFormat;
+    Uint32 ResourceDimension;
+    Uint32 MiscFlag;
+    Uint32 ArraySize;
+    Uint32 MiscFlags2;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    ConverterArgs Args;
+    if (!ParseArgs(argc, argv, Args))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Uint32 NumMips = 1;
+    while ((Args.Size >> NumMips) != 0)
+        ++NumMips;
+
+    // Los datos del DDS van capa a capa, y dentro de cada capa de mayor a menor mip
+    std::vector<Uint8> LayerData;
+    size_t             UncompressedSize = 0;
+    for (const char* Input : Args.Inputs)
+    {
+        LinearImage Src;
+        if (!LoadLinearImage(Input, Src))
+            return 1;
+
+        LinearImage Mip = ResizeImage(Src, Args.Size);
+        for (Uint32 Level = 0; Level < NumMips; ++Level)
+        {
+            if (Level > 0)
+                Mip = Downsample(Mip);
+            const std::vector<Uint8> Pixels     = ToSRGB8(Mip);
+            const std::vector<Uint8> Compressed = CompressImageBC(Pixels.data(), Mip.Width, Mip.Height, Args.BC3);
+            LayerData.insert(LayerData.end(), Compressed.begin(), Compressed.end());
+            UncompressedSize += Pixels.size();
+        }
+    }
+
+    DDSHeader Header         = {};
+    Header.Size              = sizeof(DDSHeader);
+    Header.Flags             = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    Header.Height            = Args.Size;
+    Header.Width             = Args.Size;
+    Header.PitchOrLinearSize = GetCompressedImageSize(Args.Size, Args.Size, Args.BC3);
+    Header.MipMapCount       = NumMips;
+    Header.PFSize            = 32;
+    Header.PFFlags           = DDPF_FOURCC;
+    Header.PFFourCC          = DDSFourCCDX10;
+    Header.Caps[0]           = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+    DDSHeaderDX10 HeaderDX10     = {};
+    HeaderDX10.DXGIFormat        = Args.BC3 ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM_SRGB;
+    HeaderDX10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+    HeaderDX10.ArraySize         = static_cast<Uint32>(Args.Inputs.size());
+
+    FILE* pFile = std::fopen(Args.OutputPath, "wb");
+    if (pFile == nullptr)
+    {
+        std::fprintf(stderr, "Failed to open %s for writing\n", Args.OutputPath);
+        return 1;
+    }
+    const bool Written = std::fwrite(&DDSMagic, sizeof(DDSMagic), 1, pFile) == 1 &&
+        std::fwrite(&Header, sizeof(Header), 1, pFile) == 1 &&
+        std::fwrite(&HeaderDX10, sizeof(HeaderDX10), 1, pFile) == 1 &&
+        std::fwrite(LayerData.data(), LayerData.size(), 1, pFile) == 1;
+    std::fclose(pFile);
+    if (!Written)
+    {
+        std::fprintf(stderr, "Failed to write %s\n", Args.OutputPath);
+        return 1;
+    }
+
+    std::printf("%s: %zu layers, %ux%u, %u mips, %s, %zu KB (%zu KB as RGBA8)\n", Args.OutputPath, Args.Inputs.size(),
+                Args.Size, Args.Size, NumMips, Args.BC3 ? "BC3" : "BC1", LayerData.size() >> 10, UncompressedSize >> 10);
+    return 0;
+}
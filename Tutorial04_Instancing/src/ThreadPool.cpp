@@ -0,0 +1,166 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "ThreadPool.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+WorkStealingThreadPool::WorkStealingThreadPool(Uint32 NumWorkers)
+{
+    for (Uint32 i = 0; i < NumWorkers + 1; ++i)
+        m_Queues.emplace_back(new TaskQueue);
+
+    m_Workers.reserve(NumWorkers);
+    for (Uint32 i = 0; i < NumWorkers; ++i)
+        m_Workers.emplace_back(&WorkStealingThreadPool::WorkerThread, this, i);
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_WakeMtx};
+        m_Stop = true;
+    }
+    m_WakeCV.notify_all();
+    for (auto& Worker : m_Workers)
+        Worker.join();
+}
+
+void WorkStealingThreadPool::Push(Uint32 QueueIdx, std::function<void()>&& Task)
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Queues[QueueIdx]->Mtx};
+        m_Queues[QueueIdx]->Tasks.emplace_back(std::move(Task));
+    }
+    {
+        // El contador se incrementa bajo m_WakeMtx para no perder la notificación de un
+        // hilo que acaba de comprobarlo y está a punto de dormirse
+        std::lock_guard<std::mutex> Lock{m_WakeMtx};
+        m_NumPendingTasks.fetch_add(1);
+    }
+    m_WakeCV.notify_one();
+}
+
+void WorkStealingThreadPool::Enqueue(std::function<void()> Task)
+{
+    // Repartimos las tareas entre las colas de los trabajadores para que empiecen sin robar
+    const Uint32 NumWorkers = GetNumWorkers();
+    const Uint32 QueueIdx   = NumWorkers > 0 ? m_NextQueue.fetch_add(1) % NumWorkers : 0;
+    Push(QueueIdx, std::move(Task));
+}
+
+bool WorkStealingThreadPool::RunPendingTask(Uint32 QueueIdx)
+{
+    std::function<void()> Task;
+
+    {
+        // Cola propia: las tareas más recientes primero (datos aún en caché)
+        TaskQueue&                  Queue = *m_Queues[QueueIdx];
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        if (!Queue.Tasks.empty())
+        {
+            Task = std::move(Queue.Tasks.back());
+            Queue.Tasks.pop_back();
+        }
+    }
+
+    const Uint32 NumQueues = static_cast<Uint32>(m_Queues.size());
+    for (Uint32 i = 1; i < NumQueues && !Task; ++i)
+    {
+        // Robo: las tareas más antiguas de otra cola
+        TaskQueue&                  Victim = *m_Queues[(QueueIdx + i) % NumQueues];
+        std::lock_guard<std::mutex> Lock{Victim.Mtx};
+        if (!Victim.Tasks.empty())
+        {
+            Task = std::move(Victim.Tasks.front());
+            Victim.Tasks.pop_front();
+        }
+    }
+
+    if (!Task)
+        return false;
+
+    m_NumPendingTasks.fetch_sub(1);
+    Task();
+    return true;
+}
+
+void WorkStealingThreadPool::WorkerThread(Uint32 WorkerIdx)
+{
+    for (;;)
+    {
+        if (RunPendingTask(WorkerIdx))
+            continue;
+
+        std::unique_lock<std::mutex> Lock{m_WakeMtx};
+        m_WakeCV.wait(Lock, [this] { return m_Stop || m_NumPendingTasks.load() > 0; });
+        if (m_Stop)
+            return;
+    }
+}
+
+void WorkStealingThreadPool::ParallelFor(Uint32 Count, Uint32 Grain, const std::function<void(Uint32, Uint32)>& Func)
+{
+    if (Count == 0)
+        return;
+
+    Grain = std::max(Grain, 1u);
+    const Uint32 NumChunks = (Count + Grain - 1) / Grain;
+    if (NumChunks == 1 || m_Workers.empty())
+    {
+        Func(0, Count);
+        return;
+    }
+
+    std::atomic<Uint32> NumRemaining{NumChunks};
+
+    // Los bloques se reparten por adelantado entre las colas de los trabajadores. El primero
+    // se queda en la cola del hilo llamador, que también roba cuando termina el suyo.
+    const Uint32 NumWorkers = GetNumWorkers();
+    for (Uint32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+    {
+        const Uint32 Begin = Chunk * Grain;
+        const Uint32 End   = std::min(Begin + Grain, Count);
+
+        const Uint32 QueueIdx = Chunk == 0 ? NumWorkers : (Chunk - 1) % NumWorkers;
+        Push(QueueIdx, [&Func, &NumRemaining, Begin, End]() {
+            Func(Begin, End);
+            NumRemaining.fetch_sub(1);
+        });
+    }
+
+    while (NumRemaining.load() > 0)
+    {
+        if (!RunPendingTask(NumWorkers))
+            std::this_thread::yield();
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Pool de hilos con robo de trabajo: cada hilo tiene su propia cola, consume las tareas más
+// recientes de la suya (LIFO) y, cuando se queda sin trabajo, roba las más antiguas (FIFO)
+// de las colas de los demás hilos.
+class WorkStealingThreadPool
+{
+public:
+    explicit WorkStealingThreadPool(Uint32 NumWorkers);
+    ~WorkStealingThreadPool();
+
+    // clang-format off
+    WorkStealingThreadPool(const WorkStealingThreadPool&)            = delete;
+    WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+    // clang-format on
+
+    Uint32 GetNumWorkers() const { return static_cast<Uint32>(m_Workers.size()); }
+
+    // Encola una tarea independiente
+    void Enqueue(std::function<void()> Task);
+
+    // Ejecuta Func(Begin, End) sobre el rango [0, Count) dividido en bloques de como mucho
+    // Grain elementos. El hilo llamador también ejecuta bloques, y la función no retorna
+    // hasta que todos han terminado, por lo que Func puede referenciar datos de la pila.
+    void ParallelFor(Uint32 Count, Uint32 Grain, const std::function<void(Uint32, Uint32)>& Func);
+
+private:
+    struct TaskQueue
+    {
+        std::mutex                        Mtx;
+        std::deque<std::function<void()>> Tasks;
+    };
+
+    void Push(Uint32 QueueIdx, std::function<void()>&& Task);
+    // Intenta ejecutar una tarea de la cola QueueIdx o, si está vacía, robar de otra cola
+    bool RunPendingTask(Uint32 QueueIdx);
+    void WorkerThread(Uint32 WorkerIdx);
+
+    // Una cola por hilo trabajador más una para el hilo que encola (índice NumWorkers)
+    std::vector<std::unique_ptr<TaskQueue>> m_Queues;
+    std::vector<std::thread>                m_Workers;
+
+    std::mutex              m_WakeMtx;
+    std::condition_variable m_WakeCV;
+    std::atomic<Uint32>     m_NumPendingTasks{0};
+    std::atomic<Uint32>     m_NextQueue{0};
+    bool                    m_Stop = false;
+};
+
+} // namespace Diligent
@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <algorithm>
+
+#include "TransformGraph.hpp"
+#include "BatchTransform.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+Uint32 TransformGraph::AddNode(Uint32 Parent, const float4x4& Local, bool IsStatic)
+{
+    const Uint32 Node = GetNumNodes();
+    VERIFY(Parent == InvalidNode || Parent < Node, "El padre debe añadirse antes que sus hijos");
+    VERIFY(!IsStatic || Parent == InvalidNode || m_Static[Parent], "Un nodo estático no puede colgar de un nodo dinámico");
+
+    m_Parent.push_back(Parent);
+    m_Local.push_back(Local);
+    m_World.push_back(Parent != InvalidNode ? Local * m_World[Parent] : Local);
+    m_Dirty.push_back(0);
+    m_Static.push_back(IsStatic ? 1 : 0);
+    if (!IsStatic)
+        m_DynamicNodes.push_back(Node);
+
+    return Node;
+}
+
+void TransformGraph::SetLocalTransform(Uint32 Node, const float4x4& Local)
+{
+    VERIFY(!m_Static[Node], "No se puede modificar la transformación de un nodo estático");
+    m_Local[Node] = Local;
+    m_Dirty[Node] = 1;
+}
+
+Uint32 TransformGraph::Update()
+{
+    // Los padres se procesan antes que los hijos, así que basta con heredar la marca de
+    // suciedad del padre. Los nodos estáticos nunca están sucios.
+    for (Uint32 Node : m_DynamicNodes)
+    {
+        const Uint32 Parent = m_Parent[Node];
+        if (Parent != InvalidNode)
+            m_Dirty[Node] |= m_Dirty[Parent];
+    }
+
+    // Los hermanos sucios consecutivos comparten la matriz del padre, por lo que se componen en
+    // un único lote con el kernel vectorizado
+    Uint32       NumUpdated      = 0;
+    const size_t NumDynamicNodes = m_DynamicNodes.size();
+    for (size_t i = 0; i < NumDynamicNodes;)
+    {
+        const Uint32 First = m_DynamicNodes[i];
+        if (!m_Dirty[First])
+        {
+            ++i;
+            continue;
+        }
+
+        const Uint32 Parent = m_Parent[First];
+        size_t       RunEnd = i + 1;
+        while (RunEnd < NumDynamicNodes &&
+               m_DynamicNodes[RunEnd] == First + (RunEnd - i) &&
+               m_Parent[m_DynamicNodes[RunEnd]] == Parent &&
+               m_Dirty[m_DynamicNodes[RunEnd]])
+        {
+            ++RunEnd;
+        }
+
+        const size_t RunLength = RunEnd - i;
+        if (Parent != InvalidNode)
+            BatchMultiply(&m_Local[First], m_World[Parent], &m_World[First], RunLength);
+        else
+            std::copy_n(&m_Local[First], RunLength, &m_World[First]);
+
+        NumUpdated += static_cast<Uint32>(RunLength);
+        i = RunEnd;
+    }
+
+    for (Uint32 Node : m_DynamicNodes)
+        m_Dirty[Node] = 0;
+
+    return NumUpdated;
+}
+
+void TransformGraph::Clear()
+{
+    m_Parent.clear();
+    m_Local.clear();
+    m_World.clear();
+    m_Dirty.clear();
+    m_Static.clear();
+    m_DynamicNodes.clear();
+}
+
+} // namespace Diligent
@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Grafo de transformaciones jerárquico almacenado como arrays planos (SoA).
+// Los nodos se guardan en orden topológico (el padre siempre precede a sus hijos), de modo
+// que una única pasada lineal basta para propagar las matrices de mundo.
+// Sólo se recalculan los nodos marcados como sucios y sus descendientes; los nodos estáticos
+// (ellos y todos sus ancestros) se calculan una vez al insertarse y quedan en caché.
+class TransformGraph
+{
+public:
+    static constexpr Uint32 InvalidNode = ~Uint32{0};
+
+    // Añade un nodo hijo de Parent (o raíz si Parent == InvalidNode) y devuelve su índice.
+    // Un nodo estático no puede tener un padre dinámico ni cambiar su transformación local.
+    Uint32 AddNode(Uint32 Parent, const float4x4& Local, bool IsStatic);
+
+    // Cambia la transformación local de un nodo dinámico y lo marca como sucio
+    void SetLocalTransform(Uint32 Node, const float4x4& Local);
+
+    // Recalcula las matrices de mundo de los subárboles sucios.
+    // Devuelve el número de matrices recalculadas.
+    Uint32 Update();
+
+    void Clear();
+
+    Uint32 GetNumNodes() const { return static_cast<Uint32>(m_Parent.size()); }
+    Uint32 GetNumDynamicNodes() const { return static_cast<Uint32>(m_DynamicNodes.size()); }
+
+    Uint32          GetParent(Uint32 Node) const { return m_Parent[Node]; }
+    bool            IsStatic(Uint32 Node) const { return m_Static[Node] != 0; }
+    const float4x4& GetLocalTransform(Uint32 Node) const { return m_Local[Node]; }
+    const float4x4& GetWorldTransform(Uint32 Node) const { return m_World[Node]; }
+
+private:
+    std::vector<Uint32>   m_Parent;
+    std::vector<float4x4> m_Local;
+    std::vector<float4x4> m_World;
+    std::vector<Uint8>    m_Dirty;
+    std::vector<Uint8>    m_Static;
+
+    // Índices de los nodos dinámicos en orden topológico: Update() sólo recorre esta lista
+    std::vector<Uint32> m_DynamicNodes;
+};
+
+} // namespace Diligent
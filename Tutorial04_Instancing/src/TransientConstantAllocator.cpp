@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include <algorithm>
+
+#include "TransientConstantAllocator.hpp"
+#include "DebugUtilities.hpp"
+#include "CPUProfiler.hpp"
+
+namespace Diligent
+{
+
+void TransientConstantAllocator::Initialize(IRenderDevice* pDevice, Uint32 Capacity, const char* Name)
+{
+    m_pBuffer.Release();
+
+    m_Alignment = std::max(pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment, 16u);
+    m_Capacity  = (Capacity + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = Name;
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    BuffDesc.Size           = m_Capacity;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+}
+
+void TransientConstantAllocator::BeginFrame(IDeviceContext* pContext)
+{
+    VERIFY(m_pData == nullptr, "El frame anterior no se cerró con EndFrame()");
+
+    // Solo la llamada a MapBuffer(); las escrituras hasta EndFrame() las mide quien las hace
+    CPU_PROFILE_ZONE("MapBuffer: constantes");
+
+    m_pContext = pContext;
+    void* pData = nullptr;
+    m_pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_DISCARD, pData);
+    m_pData = static_cast<Uint8*>(pData);
+
+    m_Offset           = 0;
+    m_FrameBytes       = 0;
+    m_FrameAllocations = 0;
+}
+
+void TransientConstantAllocator::EndFrame()
+{
+    if (m_pData == nullptr)
+        return;
+
+    m_pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+    m_pData    = nullptr;
+    m_pContext = nullptr;
+}
+
+void* TransientConstantAllocator::Allocate(Uint32 Size, Uint32& Offset)
+{
+    Offset = 0;
+    if (m_pData == nullptr)
+        return nullptr;
+
+    // La capacidad se dimensiona para las constantes de un frame completo; si aun así no caben,
+    // la comprobación se hace también en release para no escribir fuera del buffer mapeado
+    if (Size > m_Capacity - m_Offset)
+    {
+        DEV_ERROR("El asignador de constantes se ha quedado sin espacio");
+        return nullptr;
+    }
+
+    Offset = m_Offset;
+    m_Offset += (Size + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+    m_FrameBytes += Size;
+    ++m_FrameAllocations;
+    return m_pData + Offset;
+}
+
+} // namespace Diligent
@@ -0,0 +1,86 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <new>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+// Asignador lineal de constantes por frame sobre un único buffer dinámico.
+// Al comienzo del frame el buffer se mapea una sola vez con MAP_FLAG_DISCARD; cada Allocate()
+// devuelve una porción alineada a ConstantBufferOffsetAlignment y su desplazamiento, que se
+// aplica a las variables de shader con IShaderResourceVariable::SetBufferOffset(). El buffer
+// debe desmapearse con EndFrame() antes de cualquier draw o dispatch que lo lea.
+class TransientConstantAllocator
+{
+public:
+    void Initialize(IRenderDevice* pDevice, Uint32 Capacity, const char* Name);
+
+    void BeginFrame(IDeviceContext* pContext);
+    void EndFrame();
+
+    // Reserva Size bytes y devuelve un puntero para escribirlos; Offset recibe el
+    // desplazamiento de la porción dentro del buffer. Devuelve nullptr si no queda espacio en el
+    // buffer o si no se pudo mapear; quien llama no debe dibujar con esas constantes.
+    void* Allocate(Uint32 Size, Uint32& Offset);
+
+    template <typename T>
+    T* Allocate(Uint32& Offset)
+    {
+        void* pData = Allocate(static_cast<Uint32>(sizeof(T)), Offset);
+        return pData != nullptr ? new (pData) T{} : nullptr;
+    }
+
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+    Uint32   GetCapacity() const { return m_Capacity; }
+    Uint32   GetAlignment() const { return m_Alignment; }
+
+    // Estadísticas del último frame
+    Uint32 GetFrameBytes() const { return m_FrameBytes; }
+    Uint32 GetFrameAllocations() const { return m_FrameAllocations; }
+
+private:
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+    IDeviceContext*        m_pContext  = nullptr;
+    Uint8*                 m_pData     = nullptr;
+    Uint32                 m_Capacity  = 0;
+    Uint32                 m_Alignment = 256;
+    Uint32                 m_Offset    = 0;
+
+    Uint32 m_FrameBytes       = 0;
+    Uint32 m_FrameAllocations = 0;
+};
+
+} // namespace Diligent
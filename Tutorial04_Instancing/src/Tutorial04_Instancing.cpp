@@ -25,15 +25,24 @@
  *  of the possibility of such damages.
  */
 
+#include <cfloat>
+#include <cstdio>
 #include <random>
+#include <thread>
 
 #include "Tutorial04_Instancing.hpp"
 #include "MapHelper.hpp"
 #include "GraphicsUtilities.h"
 #include "TextureUtilities.h"
 #include "ColorConversion.h"
+#include "GraphicsAccessories.hpp"
+#include "DataBlobImpl.hpp"
 #include "../../Common/src/TexturedCube.hpp"
+#include "BatchTransform.hpp"
+#include "ShaderMacroHelper.hpp"
+#include "CPUProfiler.hpp"
 #include "imgui.h"
+#include "Timer.hpp"
 
 #ifdef PLATFORM_WIN32
 #   include <Windows.h>
@@ -42,95 +51,442 @@
 namespace Diligent
 {
 
-struct InstanceDataType
-{
-    float4x4 Transform;
-    float    TexSelector; // 0 para mezcla 1-2, 1 para mezcla 1-3, 2 para mezcla 1-4
-};
-
 SampleBase* CreateSample()
 {
     return new Tutorial04_Instancing();
 }
 
-void Tutorial04_Instancing::CreatePipelineState()
+// Layout de entrada del móvil: posición y UV por vértice en el slot 0 y los datos de instancia
+// en el formato Format en el slot 1 (ver instance_decode.fxh). Devuelve el número de elementos.
+static Uint32 GetCubeLayoutElements(INSTANCE_FORMAT Format, Uint32 InstanceDataStepRate, LayoutElement (&LayoutElems)[7])
 {
-    // Liberar referencias existentes para evitar fugas de memoria
-    m_pPSO.Release();
-    m_SRB.Release();
+    Uint32 NumElems = 0;
+    // Per-vertex data - first buffer slot
+    // Attribute 0 - vertex position
+    LayoutElems[NumElems++] = LayoutElement{0, 0, 3, VT_FLOAT32, False};
+    // Attribute 1 - texture coordinates
+    LayoutElems[NumElems++] = LayoutElement{1, 0, 2, VT_FLOAT32, False};
+
+    // Per-instance data - second buffer slot
+    auto AddInstanceElement = [&](Uint32 NumComponents, VALUE_TYPE ValueType) {
+        LayoutElems[NumElems] = LayoutElement{NumElems, 1, NumComponents, ValueType, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE, InstanceDataStepRate};
+        ++NumElems;
+    };
+    switch (Format)
+    {
+        case INSTANCE_FORMAT_FULL:
+            // Cuatro filas de la matriz 4x4 y el selector de textura
+            for (Uint32 Row = 0; Row < 4; ++Row)
+                AddInstanceElement(4, VT_FLOAT32);
+            AddInstanceElement(1, VT_FLOAT32);
+            break;
+
+        case INSTANCE_FORMAT_AFFINE:
+            // Tres columnas de la matriz afín y el índice de material
+            for (Uint32 Col = 0; Col < 3; ++Col)
+                AddInstanceElement(4, VT_FLOAT32);
+            AddInstanceElement(2, VT_UINT16);
+            break;
+
+        case INSTANCE_FORMAT_QUAT_TRS:
+            // Cuaternión en half float, traslación y escala (half float en bruto) con el índice de material
+            AddInstanceElement(4, VT_FLOAT16);
+            AddInstanceElement(3, VT_FLOAT32);
+            AddInstanceElement(4, VT_UINT16);
+            break;
+
+        default:
+            UNEXPECTED("Formato de instancia desconocido");
+    }
+    return NumElems;
+}
+
+// Sampler de comparación del mapa de sombras (PCF con filtrado bilineal). Lo declaran como
+// inmutable todos los PSO que reciben sombras: el móvil y el suelo, igual que el de los momentos.
+static SamplerDesc GetShadowMapSamplerDesc()
+{
+    SamplerDesc SamComparisonDesc;
+    SamComparisonDesc.MinFilter      = FILTER_TYPE_COMPARISON_LINEAR;
+    SamComparisonDesc.MagFilter      = FILTER_TYPE_COMPARISON_LINEAR;
+    SamComparisonDesc.MipFilter      = FILTER_TYPE_COMPARISON_LINEAR;
+    SamComparisonDesc.AddressU       = TEXTURE_ADDRESS_CLAMP;
+    SamComparisonDesc.AddressV       = TEXTURE_ADDRESS_CLAMP;
+    SamComparisonDesc.AddressW       = TEXTURE_ADDRESS_CLAMP;
+    SamComparisonDesc.ComparisonFunc = COMPARISON_FUNC_LESS_EQUAL;
+    return SamComparisonDesc;
+}
+
+// Sampler trilineal de los momentos del VSM: los mips sustituyen al filtro por píxel
+static SamplerDesc GetShadowMomentsSamplerDesc()
+{
+    SamplerDesc SamLinearClampDesc;
+    SamLinearClampDesc.MinFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MagFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MipFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.AddressU  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressV  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressW  = TEXTURE_ADDRESS_CLAMP;
+    return SamLinearClampDesc;
+}
+
+// Nombre de una permutación del pixel shader del móvil, para los PSO y la interfaz
+static const char* GetCubePSPermutationName(Uint32 Permutation)
+{
+    static const char* const Names[] =
+    {
+        "detalle", "detalle + especular",
+        "mezcla", "mezcla + especular",
+        "alternativa", "alternativa + especular",
+        "por instancia", "por instancia + especular",
+    };
+    return Permutation < _countof(Names) ? Names[Permutation] : "<desconocida>";
+}
+
+// Texturas del móvil en el orden de capas que espera cube_inst_lighting.psh
+static const char* const MaterialTextureFiles[] = {"DGLogo.png", "BrickWall.jpg", "BlendMap.png", "MetalPlate.jpg"};
+
+// Las mismas cuatro texturas comprimidas en BC y con los mips generados (Tutorial04_TextureConverter)
+static const char* const CompressedMaterialTexturesFile = "tutorial04_materials.dds";
+
+// Memoria de todas las capas y mips de una textura
+static Uint64 GetTextureMemorySize(const TextureDesc& Desc)
+{
+    Uint64 Size = 0;
+    for (Uint32 Mip = 0; Mip < Desc.MipLevels; ++Mip)
+        Size += GetMipLevelProperties(Desc, Mip).MipSize;
+    return Size * Desc.ArraySize;
+}
+
+static constexpr Uint32         MaterialLayerSize     = 256;
+static constexpr TEXTURE_FORMAT MaterialTextureFormat = TEX_FORMAT_RGBA8_UNORM_SRGB;
+
+// Compila un shader del móvil. El vertex shader solo depende del formato de instancia y el
+// pixel shader, de la permutación (ver GetCubePSPermutation()).
+RefCntAutoPtr<IShader> Tutorial04_Instancing::CreateCubeShader(SHADER_TYPE     Type,
+                                                               const char*     FilePath,
+                                                               INSTANCE_FORMAT InstanceFormat,
+                                                               Uint32          PSPermutation)
+{
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    ShaderMacroHelper Macros;
+    if (Type == SHADER_TYPE_PIXEL)
+    {
+        Macros.AddShaderMacro("CONVERT_PS_OUTPUT_TO_GAMMA", m_ConvertPSOutputToGamma);
+        Macros.AddShaderMacro("TEX_BLEND_MODE", static_cast<int>(PSPermutation / 2));
+        Macros.AddShaderMacro("SPECULAR", static_cast<int>(PSPermutation % 2));
+    }
+    else if (Type == SHADER_TYPE_VERTEX)
+    {
+        Macros.AddShaderMacro("INSTANCE_FORMAT", static_cast<int>(InstanceFormat));
+    }
+    ShaderCI.Macros = Macros;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+    ShaderCI.Desc.ShaderType            = Type;
+    ShaderCI.EntryPoint                 = "main";
+    ShaderCI.Desc.Name                  = FilePath;
+    ShaderCI.FilePath                   = FilePath;
 
+    RefCntAutoPtr<IShader> pShader;
+    CreateShaderWithCache(ShaderCI, &pShader);
+    return pShader;
+}
+
+// Crea un PSO para el móvil instanciado. Sustituye a TexturedCube::CreatePipelineState() para
+// declarar mutable el array de texturas y dejar los constant buffers como variables dinámicas,
+// que se enlazan con desplazamientos dentro del buffer de constantes del frame.
+// pVS y pGS (opcional) se compilan una vez por formato de instancia y se comparten entre las
+// permutaciones. InstanceDataStepRate indica cuántas instancias consecutivas comparten los datos
+// de instancia, InstanceFormat el formato en el que están codificados y pPS es la permutación
+// del pixel shader.
+RefCntAutoPtr<IPipelineState> Tutorial04_Instancing::CreateCubePSO(const char*     Name,
+                                                                   IShader*        pVS,
+                                                                   IShader*        pGS,
+                                                                   IShader*        pPS,
+                                                                   Uint32          InstanceDataStepRate,
+                                                                   INSTANCE_FORMAT InstanceFormat)
+{
     // Define vertex shader input layout
-    LayoutElement LayoutElems[] =
+    LayoutElement LayoutElems[7];
+    const Uint32  NumLayoutElems = GetCubeLayoutElements(InstanceFormat, InstanceDataStepRate, LayoutElems);
+
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PipelineStateDesc&              PSODesc          = PSOCreateInfo.PSODesc;
+    GraphicsPipelineDesc&           GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
+
+    PSODesc.Name         = Name;
+    PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    GraphicsPipeline.NumRenderTargets             = 1;
+    GraphicsPipeline.RTVFormats[0]                = GetTargetDesc().ColorBufferFormat;
+    GraphicsPipeline.DSVFormat                    = GetTargetDesc().DepthBufferFormat;
+    GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_BACK;
+    GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
+    GraphicsPipeline.InputLayout.LayoutElements   = LayoutElems;
+    GraphicsPipeline.InputLayout.NumElements      = NumLayoutElems;
+
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pGS = pGS;
+    PSOCreateInfo.pPS = pPS;
+
+    // Los constant buffers se enlazan con SetBufferRange()/SetBufferOffset(), que no están
+    // permitidos en variables estáticas
+    PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+    ShaderResourceVariableDesc Vars[] =
     {
-        // Per-vertex data - first buffer slot
-        // Attribute 0 - vertex position
-        LayoutElement{0, 0, 3, VT_FLOAT32, False},
-        // Attribute 1 - texture coordinates
-        LayoutElement{1, 0, 2, VT_FLOAT32, False},
-            
-        // Per-instance data - second buffer slot
-        // We will use four attributes to encode instance-specific 4x4 transformation matrix
-        // Attribute 2 - first row
-        LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        // Attribute 3 - second row
-        LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        // Attribute 4 - third row
-        LayoutElement{4, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        // Attribute 5 - fourth row
-        LayoutElement{5, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        // Selector de textura
-        LayoutElement{6, 1, 1, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+        {SHADER_TYPE_PIXEL, "g_Textures", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "g_ShadowMap", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "g_ShadowMoments", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
     };
+    PSODesc.ResourceLayout.Variables    = Vars;
+    PSODesc.ResourceLayout.NumVariables = _countof(Vars);
 
-    // Create a shader source stream factory to load shaders from files.
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-
-    TexturedCube::CreatePSOInfo CubePsoCI;
-    CubePsoCI.pDevice                = m_pDevice;
-    CubePsoCI.RTVFormat              = m_pSwapChain->GetDesc().ColorBufferFormat;
-    CubePsoCI.DSVFormat              = m_pSwapChain->GetDesc().DepthBufferFormat;
-    CubePsoCI.pShaderSourceFactory   = pShaderSourceFactory;
-    // Usar los nuevos shaders con iluminación
-    CubePsoCI.VSFilePath             = "cube_inst_lighting.vsh";
-    CubePsoCI.PSFilePath             = "cube_inst_lighting.psh";
-    CubePsoCI.ExtraLayoutElements    = LayoutElems;
-    CubePsoCI.NumExtraLayoutElements = _countof(LayoutElems);
-
-    m_pPSO = TexturedCube::CreatePipelineState(CubePsoCI, m_ConvertPSOutputToGamma);
-
-    // Create dynamic uniform buffer that will store our transformation matrix
-    // Dynamic buffers can be frequently updated by the CPU
-    m_VSConstants.Release();
-    m_PSConstants.Release();
-    CreateUniformBuffer(m_pDevice, sizeof(float4x4) * 2 + sizeof(float4) * 2, "VS constants CB", &m_VSConstants);
-    CreateUniformBuffer(m_pDevice, sizeof(float) + sizeof(float4) * 5 + sizeof(float) * 2 + sizeof(float4x4), "PS constants CB", &m_PSConstants);
-    
-    // Since we did not explicitly specify the type for 'Constants' variable, default
-    // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables
-    // never change and are bound directly to the pipeline state object.
-    if (m_pPSO)
+    SamplerDesc SamLinearClampDesc;
+    SamLinearClampDesc.MinFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MagFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MipFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.AddressU  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressV  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressW  = TEXTURE_ADDRESS_CLAMP;
+
+    ImmutableSamplerDesc ImtblSamplers[] =
     {
-        m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
-        m_pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->Set(m_PSConstants);
-        
-        // Since we are using mutable variable, we must create a shader resource binding object
-        m_pPSO->CreateShaderResourceBinding(&m_SRB, true);
+        {SHADER_TYPE_PIXEL, "g_Textures", SamLinearClampDesc},
+        {SHADER_TYPE_PIXEL, "g_ShadowMap", GetShadowMapSamplerDesc()},
+        {SHADER_TYPE_PIXEL, "g_ShadowMoments", GetShadowMomentsSamplerDesc()}
+    };
+    PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
+    PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+    RefCntAutoPtr<IPipelineState> pPSO;
+    CreateGraphicsPSOWithCache(PSOCreateInfo, &pPSO);
+    return pPSO;
+}
+
+// Crea el SRB de un PSO del móvil y enlaza las texturas, los mapas de sombras y el buffer de constantes pConstantsCB
+// (el del frame o el de un trabajo de grabación en paralelo)
+RefCntAutoPtr<IShaderResourceBinding> Tutorial04_Instancing::CreateCubeSRB(IPipelineState* pPSO, IBuffer* pConstantsCB, const char* VSConstantsName, Uint32 VSConstantsSize)
+{
+    RefCntAutoPtr<IShaderResourceBinding> pSRB;
+    pPSO->CreateShaderResourceBinding(&pSRB, true);
+
+    pSRB->GetVariableByName(SHADER_TYPE_VERTEX, VSConstantsName)->SetBufferRange(pConstantsCB, 0, VSConstantsSize);
+    pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferRange(pConstantsCB, 0, sizeof(CubePSConstants));
+
+    pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Textures")->Set(m_MaterialTexturesSRV);
+    pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMap")->Set(m_ShadowMapSRV);
+    pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMoments")->Set(m_ShadowMomentsSRV);
+    return pSRB;
+}
+
+void Tutorial04_Instancing::CreateCubePSOs(INSTANCE_FORMAT Format)
+{
+    // Usar los shaders con iluminación, con un PSO por formato de instancia y permutación del
+    // pixel shader. Todos usan los mismos recursos, así que el SRB creado con uno sirve para todos.
+    // El vertex shader es el mismo para todas las permutaciones.
+    RefCntAutoPtr<IShader> pVS = CreateCubeShader(SHADER_TYPE_VERTEX, "cube_inst_lighting.vsh", Format);
+    for (Uint32 Permutation = 0; Permutation < NumCubePSPermutations; ++Permutation)
+    {
+        const std::string      Name = std::string{"Cube PSO ("} + GetInstanceFormatName(Format) + ", " + GetCubePSPermutationName(Permutation) + ")";
+        RefCntAutoPtr<IShader> pPS  = CreateCubeShader(SHADER_TYPE_PIXEL, "cube_inst_lighting.psh", Format, Permutation);
+        m_CubePSOs[Format][Permutation] = CreateCubePSO(Name.c_str(), pVS, nullptr, pPS, 1, Format);
+    }
+}
+
+void Tutorial04_Instancing::CreateMultiViewPSOs()
+{
+    for (auto& FormatPSOs : m_MultiViewPSOs)
+    {
+        for (auto& pPSO : FormatPSOs)
+            pPSO.Release();
+    }
+    m_MultiViewSRB.Release();
+    m_pMultiViewFloorPSO.Release();
+    m_MultiViewFloorSRB.Release();
+
+    // El índice de viewport se escribe en el geometry shader
+    const auto& Features = m_pDevice->GetDeviceInfo().Features;
+    if (!Features.GeometryShaders || !Features.MultiViewport)
+    {
+        m_MultiView = false;
+        return;
+    }
+
+    // Móvil: mismos shaders de píxel que CreateCubePSOs(), pero cada elemento de instancia
+    // se mantiene durante NumViews instancias consecutivas. El geometry shader y los pixel
+    // shaders no dependen del formato de instancia y se compilan una sola vez.
+    RefCntAutoPtr<IShader> pGS = CreateCubeShader(SHADER_TYPE_GEOMETRY, "cube_inst_multiview.gsh", INSTANCE_FORMAT_FULL);
+    RefCntAutoPtr<IShader> pPSs[NumCubePSPermutations];
+    for (Uint32 Permutation = 0; Permutation < NumCubePSPermutations; ++Permutation)
+        pPSs[Permutation] = CreateCubeShader(SHADER_TYPE_PIXEL, "cube_inst_lighting.psh", INSTANCE_FORMAT_FULL, Permutation);
+
+    for (Uint8 Format = 0; Format < INSTANCE_FORMAT_COUNT; ++Format)
+    {
+        const INSTANCE_FORMAT  InstFormat = static_cast<INSTANCE_FORMAT>(Format);
+        RefCntAutoPtr<IShader> pVS        = CreateCubeShader(SHADER_TYPE_VERTEX, "cube_inst_multiview.vsh", InstFormat);
+        for (Uint32 Permutation = 0; Permutation < NumCubePSPermutations; ++Permutation)
+        {
+            const std::string Name = std::string{"Cube multi-view PSO ("} + GetInstanceFormatName(InstFormat) + ", " + GetCubePSPermutationName(Permutation) + ")";
+            m_MultiViewPSOs[Format][Permutation] = CreateCubePSO(Name.c_str(), pVS, pGS, pPSs[Permutation], NumViews, InstFormat);
+        }
+    }
+
+    // Suelo: una instancia por vista, sin datos de instancia
+    {
+        GraphicsPipelineStateCreateInfo PSOCreateInfo;
+        PipelineStateDesc&              PSODesc          = PSOCreateInfo.PSODesc;
+        GraphicsPipelineDesc&           GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
+
+        PSODesc.Name         = "Floor multi-view PSO";
+        PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+        GraphicsPipeline.NumRenderTargets             = 1;
+        GraphicsPipeline.RTVFormats[0]                = GetTargetDesc().ColorBufferFormat;
+        GraphicsPipeline.DSVFormat                    = GetTargetDesc().DepthBufferFormat;
+        GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_BACK;
+        GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
+
+        LayoutElement FloorLayoutElems[] =
+        {
+            LayoutElement{0, 0, 3, VT_FLOAT32, False},
+            LayoutElement{1, 0, 2, VT_FLOAT32, False}
+        };
+        GraphicsPipeline.InputLayout.LayoutElements = FloorLayoutElems;
+        GraphicsPipeline.InputLayout.NumElements    = _countof(FloorLayoutElems);
+
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+        ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+        auto CreateShader = [&](SHADER_TYPE Type, const char* Name, const char* FilePath) {
+            RefCntAutoPtr<IShader> pShader;
+            ShaderCI.Desc.ShaderType = Type;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = Name;
+            ShaderCI.FilePath        = FilePath;
+            CreateShaderWithCache(ShaderCI, &pShader);
+            return pShader;
+        };
+
+        RefCntAutoPtr<IShader> pVS = CreateShader(SHADER_TYPE_VERTEX, "Floor multi-view VS", "floor_multiview.vsh");
+        RefCntAutoPtr<IShader> pGS = CreateShader(SHADER_TYPE_GEOMETRY, "Floor multi-view GS", "floor_multiview.gsh");
+        RefCntAutoPtr<IShader> pPS = CreateShader(SHADER_TYPE_PIXEL, "Floor multi-view PS", "floor.psh");
+        PSOCreateInfo.pVS = pVS;
+        PSOCreateInfo.pGS = pGS;
+        PSOCreateInfo.pPS = pPS;
+
+        PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+        ShaderResourceVariableDesc Vars[] =
+        {
+            {SHADER_TYPE_PIXEL, "g_ShadowMap", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+            {SHADER_TYPE_PIXEL, "g_ShadowMoments", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+        };
+        PSODesc.ResourceLayout.Variables    = Vars;
+        PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+        ImmutableSamplerDesc ImtblSamplers[] =
+        {
+            {SHADER_TYPE_PIXEL, "g_ShadowMap", GetShadowMapSamplerDesc()},
+            {SHADER_TYPE_PIXEL, "g_ShadowMoments", GetShadowMomentsSamplerDesc()}
+        };
+        PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
+        PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+        CreateGraphicsPSOWithCache(PSOCreateInfo, &m_pMultiViewFloorPSO);
+    }
+
+    if (!m_MultiViewPSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation] || !m_pMultiViewFloorPSO)
+    {
+        for (auto& FormatPSOs : m_MultiViewPSOs)
+        {
+            for (auto& pPSO : FormatPSOs)
+                pPSO.Release();
+        }
+        m_pMultiViewFloorPSO.Release();
+        m_MultiView = false;
+        return;
     }
+
+    m_MultiViewSRB = CreateCubeSRB(m_MultiViewPSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation], m_FrameConstants.GetBuffer(), "MultiViewConstants", sizeof(MultiViewConstants));
+
+    m_pMultiViewFloorPSO->CreateShaderResourceBinding(&m_MultiViewFloorSRB, true);
+    m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "MultiViewConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(MultiViewConstants));
+    m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(CubePSConstants));
+    m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMap")->Set(m_ShadowMapSRV);
+    m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMoments")->Set(m_ShadowMomentsSRV);
 }
 
 void Tutorial04_Instancing::CreateInstanceBuffer()
 {
-    // Create instance data buffer that will store transformation matrices and instance IDs
+    m_InstanceBuffer.Release();
+    m_InstanceFence.Release();
+    for (auto& RingBuffer : m_InstanceRing)
+        RingBuffer.Release();
+    m_InstanceBufferCapacity = 0;
+
+    // Si el adaptador expone memoria unificada con escritura desde CPU, creamos un anillo de
+    // buffers (uno por frame en vuelo). El CPU escribe en ellos con MAP_FLAG_NO_OVERWRITE y una
+    // fence indica cuándo el GPU ha terminado de leer cada slot.
+    const auto& MemInfo = m_pDevice->GetAdapterInfo().Memory;
+    if ((MemInfo.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) != 0)
+    {
+        FenceDesc FenceCI;
+        FenceCI.Name = "Instance ring fence";
+        FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+        m_pDevice->CreateFence(FenceCI, &m_InstanceFence);
+
+        BufferDesc RingBuffDesc;
+        RingBuffDesc.Usage          = USAGE_UNIFIED;
+        RingBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+        RingBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        RingBuffDesc.Size           = sizeof(InstanceDataType) * MaxInstances;
+        for (Uint32 i = 0; i < NumInstanceFramesInFlight && m_InstanceFence; ++i)
+        {
+            const std::string Name = "Instance ring buffer " + std::to_string(i);
+            RingBuffDesc.Name      = Name.c_str();
+            m_pDevice->CreateBuffer(RingBuffDesc, nullptr, &m_InstanceRing[i]);
+            m_InstanceRingFenceValue[i] = 0;
+        }
+        if (!m_InstanceFence || !m_InstanceRing[NumInstanceFramesInFlight - 1])
+        {
+            m_InstanceFence.Release();
+            for (auto& RingBuffer : m_InstanceRing)
+                RingBuffer.Release();
+        }
+    }
+    // El contenido se escribe cada frame en PopulateInstanceBuffer(), llamado desde Render()
+}
+
+// Devuelve un buffer dinámico con capacidad para al menos NumInstances instancias.
+// Los buffers dinámicos se mapean con MAP_FLAG_DISCARD, que reserva el tamaño completo del
+// buffer en el heap dinámico cada frame, por lo que no lo dimensionamos para MaxInstances.
+static void ReserveDynamicInstanceBuffer(IRenderDevice*          pDevice,
+                                         RefCntAutoPtr<IBuffer>& pBuffer,
+                                         Uint32&                 Capacity,
+                                         Uint32                  NumInstances)
+{
+    if (pBuffer && Capacity >= NumInstances)
+        return;
+
+    Capacity = std::max(Capacity * 2, std::max(NumInstances, 64u));
+
+    pBuffer.Release();
     BufferDesc InstBuffDesc;
-    InstBuffDesc.Name = "Instance data buffer";
-    // Use default usage as this buffer will only be updated when grid size changes
-    InstBuffDesc.Usage     = USAGE_DEFAULT;
-    InstBuffDesc.BindFlags = BIND_VERTEX_BUFFER;
-    // Incluir espacio para matriz de transformación y selector de textura
-    InstBuffDesc.Size      = sizeof(float4x4) * MaxInstances + sizeof(float) * MaxInstances;
-    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_InstanceBuffer);
-    PopulateInstanceBuffer();
+    InstBuffDesc.Name           = "Instance data buffer";
+    InstBuffDesc.Usage          = USAGE_DYNAMIC;
+    InstBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+    InstBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    InstBuffDesc.Size           = sizeof(InstanceDataType) * Capacity;
+    pDevice->CreateBuffer(InstBuffDesc, nullptr, &pBuffer);
 }
 
 // Manejo de eventos nativos (mouse, teclado, etc.)
@@ -166,36 +522,20 @@ bool Tutorial04_Instancing::HandleNativeMessage(const void* pNativeMsgData)
 // Actualización de matrices de cámara
 void Tutorial04_Instancing::UpdateCameraMatrices()
 {
+    CPU_PROFILE_ZONE("UpdateCameraMatrices");
+
     // Ventana 1: Paneo y Zoom
-    ViewWindow1 = float4x4::Translation(CameraWindow1.PanOffset.x, CameraWindow1.PanOffset.y, 0.0f) *
-                  float4x4::Scale(CameraWindow1.Zoom, CameraWindow1.Zoom, CameraWindow1.Zoom) *
-                  float4x4::RotationX(-0.8f) *
-                  float4x4::Translation(0.f, 0.f, 20.0f);
-    
+    ViewWindow1 = GetPanZoomViewMatrix(CameraWindow1);
     // Ventana 2: Control Orbital
-    // Añadimos una matriz de escala con Y negativo para voltear el móvil verticalmente
-    ViewWindow2 = float4x4::Translation(0.0f, 0.0f, -CameraWindow2.OrbitDistance) *
-                  float4x4::RotationX(CameraWindow2.OrbitAngleX) *
-                  float4x4::RotationY(CameraWindow2.OrbitAngleY) *
-                  float4x4::Scale(1.0f, -1.0f, 1.0f); // Invierte el eje Y para corregir la orientación
-    
+    ViewWindow2 = GetOrbitViewMatrix(CameraWindow2);
     // Ventana 3: Cámara Libre con distancia aumentada
-    float4x4 rotation = float4x4::RotationZ(CameraWindow3.RotZ) *
-                        float4x4::RotationY(CameraWindow3.RotY) *
-                        float4x4::RotationX(CameraWindow3.RotX);
-    
-    // Aplicamos un factor de escala extremadamente pequeño para alejar radicalmente la vista
-    ViewWindow3 = rotation *
-                  float4x4::Scale(CameraWindow3.ViewZoom, CameraWindow3.ViewZoom, CameraWindow3.ViewZoom) *
-                  float4x4::Translation(-CameraWindow3.Position.x,
-                                       -CameraWindow3.Position.y,
-                                       -CameraWindow3.Position.z);
+    ViewWindow3 = GetFreeViewMatrix(CameraWindow3);
 }
 
 // Manejo de eventos de ratón para controles de cámara
 void Tutorial04_Instancing::HandleMouseEvent(int x, int y, bool buttonDown, bool buttonUp, int wheel)
 {
-    const auto& SCDesc = m_pSwapChain->GetDesc();
+    const auto& SCDesc = GetTargetDesc();
     float screenPosX = static_cast<float>(x) / SCDesc.Width;
     
     // Determinar en qué ventana está el ratón
@@ -213,6 +553,21 @@ void Tutorial04_Instancing::HandleMouseEvent(int x, int y, bool buttonDown, bool
         m_MouseCaptured = true;
         m_ActiveWindow = windowIdx;
         m_LastMousePos = float2(static_cast<float>(x), static_cast<float>(y));
+
+        // Con el culling en CPU la BVH también sirve para seleccionar instancias. Solo se
+        // reconstruye y reajusta cuando ese camino está activo (no con la animación en GPU ni con
+        // la pasada única); en otro caso estaría vacía o desfasada.
+        if (UseCPUCullingPath())
+        {
+            m_PickedInstance     = PickInstance(x, y, windowIdx);
+            m_NumPickedNeighbors = 0;
+            if (m_PickedInstance != InstanceBVH::InvalidIndex)
+            {
+                std::vector<Uint32> Neighbors;
+                m_InstanceBVH.QueryBox(m_InstanceBVH.GetInstanceBox(m_PickedInstance), Neighbors);
+                m_NumPickedNeighbors = static_cast<Uint32>(Neighbors.size()) - 1; // Sin contar la propia instancia
+            }
+        }
     }
     else if (buttonUp)
     {
@@ -280,56 +635,182 @@ void Tutorial04_Instancing::HandleMouseEvent(int x, int y, bool buttonDown, bool
     }
 }
 
+void Tutorial04_Instancing::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
+{
+    SampleBase::ModifyEngineInitInfo(Attribs);
+
+    // Un contexto diferido por trabajo de grabación (una pasada de una vista) y otro para la
+    // pasada de sombras. OpenGL no admite contextos diferidos y siempre graba en serie.
+    if (Attribs.DeviceType != RENDER_DEVICE_TYPE_GL && Attribs.DeviceType != RENDER_DEVICE_TYPE_GLES)
+        Attribs.EngineCI.NumDeferredContexts = NumRecordJobs + 1;
+
+    // Las características del dispositivo están desactivadas salvo que se pidan. Todas las que
+    // usa el sample son opcionales: sin ellas se desactiva el modo correspondiente.
+    DeviceFeatures& Features           = Attribs.EngineCI.Features;
+    Features.ComputeShaders            = DEVICE_FEATURE_STATE_OPTIONAL; // Animación y culling en el GPU, VSM
+    Features.GeometryShaders           = DEVICE_FEATURE_STATE_OPTIONAL; // Pasada única
+    Features.MultiViewport             = DEVICE_FEATURE_STATE_OPTIONAL;
+    Features.TextureCompressionBC      = DEVICE_FEATURE_STATE_OPTIONAL; // Materiales comprimidos
+    Features.TimestampQueries          = DEVICE_FEATURE_STATE_OPTIONAL; // Tiempos del GPU
+    Features.PipelineStatisticsQueries = DEVICE_FEATURE_STATE_OPTIONAL; // Estadísticas por pasada
+}
+
+void Tutorial04_Instancing::SetStateCachePath(const char* Path)
+{
+    m_StateCachePath    = Path != nullptr ? Path : "";
+    m_StateCachePathSet = true;
+}
+
+void Tutorial04_Instancing::CreateStateCache()
+{
+    if (!m_StateCachePathSet)
+        m_StateCachePath = std::string{"tutorial04_state_cache_"} + GetRenderDeviceTypeShortString(m_pDevice->GetDeviceInfo().Type) + ".bin";
+    m_pStateCache.Release();
+    if (m_StateCachePath.empty())
+        return;
+
+    // Las claves de los shaders son el hash de su código (con los includes), las macros, el
+    // backend y las opciones de compilación, así que editar un shader solo invalida sus entradas
+    RenderStateCacheCreateInfo CacheCI;
+    CacheCI.pDevice      = m_pDevice;
+    CacheCI.LogLevel     = RENDER_STATE_CACHE_LOG_LEVEL_NORMAL;
+    CacheCI.FileHashMode = RENDER_STATE_CACHE_FILE_HASH_MODE_BY_CONTENT;
+    CreateRenderStateCache(CacheCI, &m_pStateCache);
+    if (!m_pStateCache)
+    {
+        LOG_WARNING_MESSAGE("No se pudo crear la caché de estados: los shaders se compilan en cada arranque");
+        return;
+    }
+    m_StartupStats.StateCacheOn = true;
+
+    std::FILE* pFile = std::fopen(m_StateCachePath.c_str(), "rb");
+    if (pFile == nullptr)
+        return; // Primer arranque: se crea cuando la escena está lista
+
+    std::fseek(pFile, 0, SEEK_END);
+    const long Size = std::ftell(pFile);
+    std::fseek(pFile, 0, SEEK_SET);
+    if (Size > 0)
+    {
+        RefCntAutoPtr<DataBlobImpl> pData = DataBlobImpl::Create(static_cast<size_t>(Size));
+        if (std::fread(pData->GetDataPtr(), 1, static_cast<size_t>(Size), pFile) == static_cast<size_t>(Size))
+            m_StartupStats.StateCacheWarm = m_pStateCache->Load(pData, StateCacheContentVersion);
+    }
+    std::fclose(pFile);
+
+    if (!m_StartupStats.StateCacheWarm)
+        LOG_WARNING_MESSAGE("La caché de estados '", m_StateCachePath, "' no es válida para esta versión y se regenerará");
+}
+
+void Tutorial04_Instancing::SaveStateCache()
+{
+    if (!m_pStateCache || !m_StateCacheDirty)
+        return;
+
+    RefCntAutoPtr<IDataBlob> pData;
+    if (!m_pStateCache->WriteToBlob(StateCacheContentVersion, &pData) || !pData)
+        return;
+
+    std::FILE* pFile = std::fopen(m_StateCachePath.c_str(), "wb");
+    if (pFile == nullptr)
+    {
+        LOG_WARNING_MESSAGE("No se pudo escribir la caché de estados '", m_StateCachePath, "'");
+        return;
+    }
+    std::fwrite(pData->GetConstDataPtr(), 1, pData->GetSize(), pFile);
+    std::fclose(pFile);
+    m_StateCacheDirty = false;
+}
+
+void Tutorial04_Instancing::CountStateCacheLookup(bool Found)
+{
+    std::lock_guard<std::mutex> Lock{m_StateCacheMtx};
+    if (Found)
+    {
+        ++m_StartupStats.NumCacheHits;
+    }
+    else
+    {
+        ++m_StartupStats.NumCacheMisses;
+        m_StateCacheDirty = true;
+    }
+}
+
+void Tutorial04_Instancing::CreateShaderWithCache(const ShaderCreateInfo& ShaderCI, IShader** ppShader)
+{
+    if (m_pStateCache)
+        CountStateCacheLookup(m_pStateCache->CreateShader(ShaderCI, ppShader));
+    else
+        m_pDevice->CreateShader(ShaderCI, ppShader);
+}
+
+// Los PSO solo se guardan en la caché si sus shaders también se crearon con ella
+void Tutorial04_Instancing::CreateGraphicsPSOWithCache(const GraphicsPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO)
+{
+    if (m_pStateCache)
+        CountStateCacheLookup(m_pStateCache->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO));
+    else
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+}
+
+void Tutorial04_Instancing::CreateComputePSOWithCache(const ComputePipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO)
+{
+    if (m_pStateCache)
+        CountStateCacheLookup(m_pStateCache->CreateComputePipelineState(PSOCreateInfo, ppPSO));
+    else
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, ppPSO);
+}
+
 void Tutorial04_Instancing::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
+    m_InitTimer.Restart();
+    m_StartupStats = {};
+    m_SceneReady   = false;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &m_pShaderSourceFactory);
+    CreateStateCache();
+
     // Liberar referencias existentes para evitar fugas de memoria
-    m_pPSO.Release();
     m_SRB.Release();
     m_CubeVertexBuffer.Release();
     m_CubeIndexBuffer.Release();
-    m_TextureSRV.Release();
-    m_TextureDetailSRV.Release();
-    m_TextureBlendSRV.Release();
-    m_TextureAltSRV.Release();
+    m_MaterialTexturesSRV.Release();
     m_ShadowMapSRV.Release();
     m_InstanceBuffer.Release();
 
-    // Crear recursos de iluminación y sombras
-    CreateLightingBuffers();
+    // Todas las constantes de un frame caben holgadamente en 64 KB
+    m_FrameConstants.Initialize(m_pDevice, 64 << 10, "Frame constants CB");
+
+    if (IsOffscreen())
+        CreateOffscreenTarget();
+
+    // Recursos baratos en el hilo principal: los PSO y las tareas del pool los referencian
     CreateShadowMap();
-    CreateShadowMapPSO();
     CreateFloor();
     CreateFloorTexture();
-    CreateFloorPSO();
-
-    // Crear pipeline state y recursos del cubo
-    CreatePipelineState();
 
     // Load textured cube
     m_CubeVertexBuffer = TexturedCube::CreateVertexBuffer(m_pDevice, GEOMETRY_PRIMITIVE_VERTEX_FLAG_POS_TEX);
     m_CubeIndexBuffer  = TexturedCube::CreateIndexBuffer(m_pDevice);
-    
-    // Cargar todas las texturas necesarias para el multitexturing
-    m_TextureSRV = TexturedCube::LoadTexture(m_pDevice, "DGLogo.png")->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    m_TextureDetailSRV = TexturedCube::LoadTexture(m_pDevice, "BrickWall.jpg")->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    m_TextureBlendSRV = TexturedCube::LoadTexture(m_pDevice, "BlendMap.png")->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-    m_TextureAltSRV = TexturedCube::LoadTexture(m_pDevice, "MetalPlate.jpg")->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-   
-    // Set cube texture SRV in the SRB - Vinculamos todas las texturas
-    if (m_SRB)
-    {
-        m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
-        m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_TextureDetail")->Set(m_TextureDetailSRV);
-        m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_TextureBlend")->Set(m_TextureBlendSRV);
-        m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_TextureAlt")->Set(m_TextureAltSRV);
-        
-        // Comentar esta línea que podría causar problemas
-        //m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMap")->Set(m_ShadowMapSRV);
-    }
 
+    // Texture2DArray de los materiales, gris hasta que se decodifiquen las texturas
+    CreateMaterialTextureArray();
+
+    m_MobileRig.Build(m_MobileAnim);
+    CreateThreadPool(std::max(std::thread::hardware_concurrency(), 1u));
     CreateInstanceBuffer();
+
+    if (m_pDevice->GetDeviceInfo().Features.TimestampQueries)
+    {
+        for (auto& pQuery : m_PermutationQueries)
+            pQuery.reset(new DurationQueryHelper{m_pDevice});
+        m_ShadowUpdateQuery.reset(new DurationQueryHelper{m_pDevice});
+        m_ViewPassesQuery.reset(new DurationQueryHelper{m_pDevice});
+    }
+    m_GPUProfiler.Initialize(m_pDevice, GPU_PROFILE_PASS_COUNT);
+
+    StartAsyncInit();
     
     // Inicializar las vistas de cámara
     ViewWindow1 = float4x4::RotationX(-0.8f) * float4x4::Translation(0.f, 0.f, 20.0f);
@@ -352,6 +833,191 @@ void Tutorial04_Instancing::Initialize(const SampleInitInfo& InitInfo)
     CameraWindow3.ViewZoom = 0.226f; // Valor exacto de la imagen
 }
 
+Tutorial04_Instancing::~Tutorial04_Instancing()
+{
+    // Las tareas pendientes escriben en miembros del sample
+    m_InitGraph.Wait();
+    m_TextureGraph.Wait();
+}
+
+void Tutorial04_Instancing::StartAsyncInit()
+{
+    // Release() en los PSO y SRB que se van a recrear no es seguro con tareas en curso
+    m_InitGraph.Wait();
+    m_InitGraph.Clear();
+    m_TextureGraph.Wait();
+    m_TextureGraph.Clear();
+    m_SceneReady            = false;
+    m_MaterialTexturesReady = false;
+
+    // Cada PSO solo depende de recursos creados en Initialize(). Las texturas se decodifican en
+    // su propio grafo, en paralelo con los PSO, y se copian al array en FinishMaterialTextures().
+    m_InitGraph.AddTask("PSO del mapa de sombras", [this]() { CreateShadowMapPSO(); });
+    m_InitGraph.AddTask("Blur del VSM", [this]() { CreateVSMResources(); });
+    m_InitGraph.AddTask("PSO del suelo", [this]() { CreateFloorPSO(); });
+
+    InitTaskGraph::TaskId CubePSOTasks[INSTANCE_FORMAT_COUNT] = {};
+    static const char* const CubePSOTaskNames[] = {"PSO del móvil (completo)", "PSO del móvil (afín)", "PSO del móvil (cuaternión)"};
+    static_assert(_countof(CubePSOTaskNames) == INSTANCE_FORMAT_COUNT, "Falta el nombre de la tarea de algún formato");
+    for (Uint8 Format = 0; Format < INSTANCE_FORMAT_COUNT; ++Format)
+        CubePSOTasks[Format] = m_InitGraph.AddTask(CubePSOTaskNames[Format], [this, Format]() { CreateCubePSOs(static_cast<INSTANCE_FORMAT>(Format)); });
+
+    // Crear el SRB del cubo: vinculamos el array de texturas y las constantes del frame
+    m_InitGraph.AddTask(
+        "SRB del móvil", [this]() {
+            m_SRB.Release();
+            if (m_CubePSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation])
+                m_SRB = CreateCubeSRB(m_CubePSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation], m_FrameConstants.GetBuffer(), "Constants", sizeof(CubeVSConstants));
+        },
+        {CubePSOTasks[INSTANCE_FORMAT_FULL]});
+
+    m_InitGraph.AddTask("PSO de la pasada única", [this]() { CreateMultiViewPSOs(); });
+
+    // El renderizado bajo demanda se activa desde la interfaz; su PSO se crea aquí para que
+    // quede en la caché de estados que se guarda al terminar
+    m_InitGraph.AddTask("PSO de composición de vistas", [this]() { CreateViewCompositePSO(); });
+
+    // El culling en el GPU lee el buffer de instancias que crea la animación
+    const InitTaskGraph::TaskId MobileAnimTask = m_InitGraph.AddTask("Animación en el GPU", [this]() { CreateMobileAnimationResources(); });
+    m_InitGraph.AddTask("Culling en el GPU", [this]() { CreateCullingResources(); }, {MobileAnimTask});
+
+    // Con el array comprimido no hay nada que decodificar
+    static const char* const LoadTaskNames[] = {"Textura DGLogo", "Textura BrickWall", "Textura BlendMap", "Textura MetalPlate"};
+    static_assert(_countof(LoadTaskNames) == NumMaterialTextures, "Falta el nombre de la tarea de alguna textura");
+    static_assert(_countof(MaterialTextureFiles) == NumMaterialTextures, "Falta el fichero de alguna textura");
+    if (!m_MaterialTexturesCompressed)
+    {
+        m_TextureGraph.AddTask("PSO de copia de texturas", [this]() { CreateTextureBlitPSO(); });
+        for (Uint32 Layer = 0; Layer < NumMaterialTextures; ++Layer)
+        {
+            m_TextureGraph.AddTask(LoadTaskNames[Layer], [this, Layer]() {
+                // LoadTexture genera los mips de la fuente, que usa el muestreo trilineal al reducir
+                m_MaterialSources[Layer] = TexturedCube::LoadTexture(m_pDevice, MaterialTextureFiles[Layer]);
+            });
+        }
+    }
+
+    m_StartupStats.InitTimeMs = static_cast<float>(m_InitTimer.GetElapsedTime() * 1000.0);
+
+    // El contexto de OpenGL solo es válido en este hilo: las tareas se ejecutan aquí en serie.
+    // Los PSO se encolan primero para que la escena esté lista cuanto antes.
+    const bool              IsGL  = m_pDevice->GetDeviceInfo().IsGLDevice();
+    WorkStealingThreadPool* pPool = IsGL ? nullptr : m_pThreadPool.get();
+    m_InitGraph.Run(pPool);
+    m_TextureGraph.Run(pPool);
+    if (m_InitGraph.IsFinished())
+        FinishAsyncInit();
+    if (m_TextureGraph.IsFinished())
+        FinishMaterialTextures();
+}
+
+void Tutorial04_Instancing::FinishAsyncInit()
+{
+    VERIFY_EXPR(m_InitGraph.IsFinished() && !m_SceneReady);
+
+    CreateRecordingResources();
+
+    m_StartupStats.SceneReadyTimeMs = static_cast<float>(m_InitTimer.GetElapsedTime() * 1000.0);
+    m_StartupStats.LongestTaskMs    = std::max(m_StartupStats.LongestTaskMs, m_InitGraph.GetLongestTaskTimeMs());
+    m_StartupStats.TotalTaskMs += m_InitGraph.GetTotalTaskTimeMs();
+    m_SceneReady = true;
+
+    // Guardar la caché no cuenta en el arranque
+    SaveStateCache();
+}
+
+// Copia las texturas decodificadas al array de materiales, que hasta ahora se dibujaba en gris
+void Tutorial04_Instancing::FinishMaterialTextures()
+{
+    VERIFY_EXPR(m_TextureGraph.IsFinished() && !m_MaterialTexturesReady);
+
+    FillMaterialTextureArray();
+
+    m_StartupStats.TexturesReadyMs = static_cast<float>(m_InitTimer.GetElapsedTime() * 1000.0);
+    m_StartupStats.LongestTaskMs   = std::max(m_StartupStats.LongestTaskMs, m_TextureGraph.GetLongestTaskTimeMs());
+    m_StartupStats.TotalTaskMs += m_TextureGraph.GetTotalTaskTimeMs();
+    m_MaterialTexturesReady = true;
+
+    // El PSO de copia también se crea con la caché de estados
+    SaveStateCache();
+}
+
+void Tutorial04_Instancing::WaitForScene()
+{
+    if (!m_SceneReady)
+    {
+        m_InitGraph.Wait();
+        FinishAsyncInit();
+    }
+    if (!m_MaterialTexturesReady)
+    {
+        m_TextureGraph.Wait();
+        FinishMaterialTextures();
+    }
+}
+
+void Tutorial04_Instancing::SetOffscreenTarget(Uint32 Width, Uint32 Height)
+{
+    VERIFY(!m_pDevice, "El destino sin ventana se configura antes de Initialize()");
+    m_OffscreenDesc.Width  = std::max(Width, NumViews);
+    m_OffscreenDesc.Height = std::max(Height, 1u);
+}
+
+void Tutorial04_Instancing::SetBenchmarkScene(Uint32 GridSize, Uint32 NumActiveViews)
+{
+    m_GridSize       = static_cast<int>(std::min(std::max(GridSize, 1u), static_cast<Uint32>(MaxGridSize)));
+    m_GridMode       = GridSize > 1;
+    m_NumActiveViews = std::min(std::max(NumActiveViews, 1u), NumViews);
+    // La pasada única replica cada instancia en todas las vistas
+    if (m_NumActiveViews < NumViews)
+        m_MultiView = false;
+}
+
+void Tutorial04_Instancing::CreateOffscreenTarget()
+{
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Offscreen color target";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = m_OffscreenDesc.Width;
+    TexDesc.Height    = m_OffscreenDesc.Height;
+    TexDesc.Format    = m_OffscreenDesc.ColorBufferFormat;
+    TexDesc.BindFlags = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+    m_OffscreenColor.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_OffscreenColor);
+
+    TexDesc.Name      = "Offscreen depth target";
+    TexDesc.Format    = m_OffscreenDesc.DepthBufferFormat;
+    TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+    m_OffscreenDepth.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_OffscreenDepth);
+}
+
+const SwapChainDesc& Tutorial04_Instancing::GetTargetDesc() const
+{
+    return IsOffscreen() ? m_OffscreenDesc : m_pSwapChain->GetDesc();
+}
+
+ITextureView* Tutorial04_Instancing::GetTargetRTV() const
+{
+    return IsOffscreen() ? m_OffscreenColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET) : m_pSwapChain->GetCurrentBackBufferRTV();
+}
+
+ITextureView* Tutorial04_Instancing::GetTargetDSV() const
+{
+    return IsOffscreen() ? m_OffscreenDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL) : m_pSwapChain->GetDepthBufferDSV();
+}
+
+// Proyección común a las tres vistas, ajustada a la orientación de la superficie. Sin swap
+// chain no hay orientación que compensar.
+float4x4 Tutorial04_Instancing::GetProjectionMatrix() const
+{
+    if (!IsOffscreen())
+        return GetSurfacePretransformMatrix(float3{0, 0, 1}) * GetAdjustedProjectionMatrix(PI_F / 4.0f, 0.1f, 100.f);
+
+    const float AspectRatio = static_cast<float>(m_OffscreenDesc.Width) / static_cast<float>(m_OffscreenDesc.Height);
+    return float4x4::Projection(PI_F / 4.0f, AspectRatio, 0.1f, 100.f, m_pDevice->GetDeviceInfo().IsGLDevice());
+}
+
 static float blendFactor = 0.5f;
 static float specularPower = 32.0f;
 static float specularIntensity = 0.5f;
@@ -361,8 +1027,20 @@ static float4 ambientColor = float4(0.1f, 0.1f, 0.1f, 1.0f);
 
 void Tutorial04_Instancing::UpdateUI()
 {
+    CPU_PROFILE_ZONE("UpdateUI");
+
     // Actualizar matrices de cámara basadas en parámetros actuales
     UpdateCameraMatrices();
+
+    // Los controles cambian PSO y recursos que todavía se están creando en el pool
+    if (!m_SceneReady)
+    {
+        ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Controles", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+            ImGui::Text("Cargando recursos: %u/%u tareas", m_InitGraph.GetNumFinished(), m_InitGraph.GetNumTasks());
+        ImGui::End();
+        return;
+    }
     
     // Ventana 1: Paneo y Zoom
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
@@ -388,29 +1066,233 @@ void Tutorial04_Instancing::UpdateUI()
           {
               ambientColor.a = 1.0f;
           }
-      }
-      ImGui::End();
-    
-    ImGui::SliderFloat("Texture Blend Factor", &blendFactor, 0.0f, 1.0f);
-    if (ImGui::Begin("Ventana 1: Paneo y Zoom", nullptr))
-    {
-        ImGui::Text("Arrastre con el ratón para paneo");
-        ImGui::Text("Use la rueda del ratón para zoom");
-        
-        // Controladores de paneo
-        ImGui::SliderFloat("Pan X", &CameraWindow1.PanOffset.x, -10.0f, 10.0f);
-        ImGui::SliderFloat("Pan Y", &CameraWindow1.PanOffset.y, -10.0f, 10.0f);
-        
-        // Controlador de zoom
-        ImGui::SliderFloat("Zoom", &CameraWindow1.Zoom, 0.1f, 5.0f);
-        
-        if (ImGui::Button("Reset Camera"))
-        {
-            CameraWindow1.PanOffset = float2(0.0f, 0.0f);
-            CameraWindow1.Zoom = 1.0f;
-        }
-    }
-    ImGui::End();
+
+          ImGui::Checkbox("Sombras", &m_ShadowsEnabled);
+          ImGui::Checkbox("Animar escena", &m_AnimateScene);
+
+          // Simulación a paso fijo: la velocidad de la animación no depende de los fps
+          int TickRate = static_cast<int>(m_SimClock.GetTickRate());
+          if (ImGui::SliderInt("Ticks por segundo", &TickRate, 10, 240))
+              m_SimClock.SetTickRate(static_cast<Uint32>(TickRate));
+          // Sin interpolar: las instancias solo se regeneran cuando la simulación avanza
+          ImGui::Checkbox("Reutilizar instancias entre ticks", &m_ReuseInstancesBetweenTicks);
+          ImGui::Text("Ticks este frame: %u; instancias generadas en %u frames, reutilizadas en %u", m_SimTicksLastFrame,
+                      m_NumGeneratedInstanceFrames, m_NumReusedInstanceFrames);
+          if (m_ShadowsEnabled)
+          {
+              // El mapa solo se renderiza cuando cambian la luz o las piezas animadas
+              ImGui::Text("Mapa de sombras: %u actualizaciones en %u frames", m_ShadowMapUpdates, m_ShadowFrames);
+              ImGui::Text("Capa estática (suelo): %u actualizaciones", m_StaticShadowUpdates);
+              ImGui::Text("Proyección de la luz: %u ajustes, %ux%u texels", m_LightFitUpdates, ShadowMapSize, ShadowMapSize);
+
+              // Cambiar de filtro o de radio obliga a regenerar los momentos
+              bool FilterChanged = false;
+              if (ImGui::RadioButton("PCF 3x3", m_ShadowFilter == SHADOW_MODE_PCF))
+              {
+                  m_ShadowFilter = SHADOW_MODE_PCF;
+                  FilterChanged  = true;
+              }
+              if (m_pVSMBlurPSOs[0])
+              {
+                  ImGui::SameLine();
+                  if (ImGui::RadioButton("VSM", m_ShadowFilter == SHADOW_MODE_VSM))
+                  {
+                      m_ShadowFilter = SHADOW_MODE_VSM;
+                      FilterChanged  = true;
+                  }
+                  if (m_ShadowFilter == SHADOW_MODE_VSM)
+                      FilterChanged |= ImGui::SliderInt("Radio del filtro VSM", &m_VSMBlurRadius, 1, 8);
+              }
+              if (FilterChanged)
+                  m_ShadowMapValid = false;
+          }
+          if (m_ShadowUpdateQuery)
+          {
+              static const char* const ModeNames[] = {"sin sombras", "PCF", "VSM"};
+              static_assert(_countof(ModeNames) == SHADOW_MODE_COUNT, "Falta el nombre de algún modo de sombra");
+              for (Uint32 Mode = 0; Mode < SHADOW_MODE_COUNT; ++Mode)
+              {
+                  if (m_ViewPassesTimeMs[Mode] > 0)
+                      ImGui::Text("%s: actualización %.3f ms, vistas %.3f ms", ModeNames[Mode], m_ShadowUpdateTimeMs[Mode], m_ViewPassesTimeMs[Mode]);
+              }
+          }
+
+          ImGui::Separator();
+          const char* InstanceSource = "buffer dinámico";
+          if (m_pCurrInstanceBuffer == m_GPUInstanceBuffer)
+              InstanceSource = "compute shader";
+          else if (m_pCurrInstanceBuffer == m_CulledInstanceBuffer)
+              InstanceSource = "culling en CPU";
+          else if (m_pCurrInstanceBuffer != nullptr && m_pCurrInstanceBuffer != m_InstanceBuffer)
+              InstanceSource = "anillo persistente";
+          ImGui::Text("Instancias: %u (%s)", m_NumInstances, InstanceSource);
+          if (m_pMobileAnimPSO)
+              ImGui::Checkbox("Animación en GPU", &m_GPUAnimation);
+          // La pasada única dibuja todas las vistas en el destino, así que no se puede guardar cada una
+          if (ImGui::Checkbox("Renderizado bajo demanda", &m_OnDemandRendering))
+              SetOnDemandRendering(m_OnDemandRendering);
+          if (m_OnDemandRendering)
+              ImGui::Text("Vistas renderizadas: %u / %u / %u en %u frames", m_ViewRenders[0], m_ViewRenders[1], m_ViewRenders[2], m_OnDemandFrames);
+          if (m_MultiViewPSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation] && !m_OnDemandRendering)
+              ImGui::Checkbox("Pasada única para las tres vistas", &m_MultiView);
+          if (m_pCullPSO && m_GPUAnimation && !m_MultiView)
+              ImGui::Checkbox("Culling en GPU", &m_GPUCulling);
+          if (!m_GPUAnimation && !m_MultiView)
+          {
+              ImGui::Checkbox("Culling en CPU (BVH)", &m_CPUCulling);
+              if (m_CPUCulling)
+              {
+                  ImGui::Text("Visibles por vista: %u / %u / %u", m_ViewNumInstances[0], m_ViewNumInstances[1], m_ViewNumInstances[2]);
+                  ImGui::Text("Nodos de la BVH: %u", m_InstanceBVH.GetNumNodes());
+                  if (m_PickedInstance != InstanceBVH::InvalidIndex)
+                      ImGui::Text("Seleccionada: %u (%u vecinas)", m_PickedInstance, m_NumPickedNeighbors);
+                  else
+                      ImGui::TextDisabled("Haz clic en una pieza para seleccionarla");
+              }
+          }
+          if (m_RecordJobs[0].pSRB && !m_MultiView && !m_OnDemandRendering)
+          {
+              ImGui::Checkbox("Grabación en paralelo (contextos diferidos)", &m_ParallelRecording);
+              if (m_ParallelRecording && !CanRecordInParallel())
+                  ImGui::TextDisabled("El buffer de instancias dinámico obliga a grabar en serie");
+          }
+          if (!m_GPUAnimation)
+              ImGui::Checkbox("Draws ordenados por material", &m_MaterialSortedDraws);
+          if (m_PermutationQueries[0] && !m_MultiView)
+          {
+              ImGui::Checkbox("Medir coste por permutación", &m_MeasurePermutations);
+              if (m_MeasurePermutations)
+              {
+                  // Tiempo en el GPU de los draws del móvil de la vista principal
+                  for (Uint32 Permutation = 0; Permutation < NumCubePSPermutations; ++Permutation)
+                  {
+                      if (m_PermutationTimeMs[Permutation] > 0)
+                          ImGui::Text("  %s: %.3f ms", GetCubePSPermutationName(Permutation), m_PermutationTimeMs[Permutation]);
+                  }
+              }
+          }
+          if (!m_GPUAnimation)
+          {
+              // Los compute shaders de animación y culling escriben siempre el formato completo
+              if (ImGui::BeginCombo("Formato de instancia", GetInstanceFormatName(m_InstanceFormat)))
+              {
+                  for (Uint8 Format = 0; Format < INSTANCE_FORMAT_COUNT; ++Format)
+                  {
+                      if (m_CubePSOs[Format][DefaultCubePSPermutation] && ImGui::Selectable(GetInstanceFormatName(static_cast<INSTANCE_FORMAT>(Format)), Format == m_InstanceFormat))
+                          m_InstanceFormat = static_cast<INSTANCE_FORMAT>(Format);
+                  }
+                  ImGui::EndCombo();
+              }
+          }
+          ImGui::Checkbox("Rejilla de móviles", &m_GridMode);
+          if (m_GridMode)
+              ImGui::SliderInt("Tamaño de rejilla", &m_GridSize, 1, MaxGridSize);
+          else if (!m_GPUAnimation)
+              ImGui::Text("Nodos recalculados: %u de %u", m_NumNodesUpdated, m_MobileRig.GetGraph().GetNumNodes());
+          if (m_GridMode || m_ParallelRecording)
+          {
+              int NumThreads = m_NumThreads;
+              if (ImGui::SliderInt("Hilos", &NumThreads, 1, static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))))
+                  CreateThreadPool(static_cast<Uint32>(NumThreads));
+          }
+          if (!m_GPUAnimation)
+          {
+              ImGui::Text("Generación de instancias: %.3f ms", m_InstanceGenTimeMs);
+              const Uint32 NumUploaded = m_pCurrInstanceBuffer == m_CulledInstanceBuffer ? m_ViewNumInstances[0] + m_ViewNumInstances[1] + m_ViewNumInstances[2] + m_ShadowNumInstances : m_NumInstances;
+              ImGui::Text("Datos de instancia subidos: %.1f KB", static_cast<float>(NumUploaded * GetInstanceStride(m_CurrInstanceFormat)) / 1024.f);
+          }
+          if (m_SerialRecordTimeMs > 0)
+              ImGui::Text("Grabación en serie: %.3f ms", m_SerialRecordTimeMs);
+          if (m_ParallelRecording && m_RecordJobTimeMs > 0)
+          {
+              // Tiempo de pared por número de hilos y aceleración respecto a un hilo
+              ImGui::Text("Grabación en paralelo (suma de trabajos %.3f ms):", m_RecordJobTimeMs);
+              const float SingleThreadMs = m_RecordTimeMsByThreads.size() > 1 ? m_RecordTimeMsByThreads[1] : 0.f;
+              for (size_t NumThreads = 1; NumThreads < m_RecordTimeMsByThreads.size(); ++NumThreads)
+              {
+                  const float TimeMs = m_RecordTimeMsByThreads[NumThreads];
+                  if (TimeMs <= 0)
+                      continue;
+                  if (SingleThreadMs > 0)
+                      ImGui::Text("  %u hilos: %.3f ms (x%.2f)", static_cast<Uint32>(NumThreads), TimeMs, SingleThreadMs / TimeMs);
+                  else
+                      ImGui::Text("  %u hilos: %.3f ms", static_cast<Uint32>(NumThreads), TimeMs);
+              }
+          }
+          ImGui::Text("Constantes por frame: %u bloques, %u bytes (1 map)", m_FrameConstants.GetFrameAllocations(), m_FrameConstants.GetFrameBytes());
+
+          // Conjunto de instrucciones de los kernels de composición de matrices
+          const BATCH_TRANSFORM_ISA ActiveISA = GetBatchTransformISA();
+          if (ImGui::BeginCombo("Kernel de matrices", GetBatchTransformISAName(ActiveISA)))
+          {
+              for (Uint8 ISA = 0; ISA < BATCH_TRANSFORM_ISA_COUNT; ++ISA)
+              {
+                  const auto ISAType = static_cast<BATCH_TRANSFORM_ISA>(ISA);
+                  if (!IsBatchTransformISASupported(ISAType))
+                      continue;
+                  if (ImGui::Selectable(GetBatchTransformISAName(ISAType), ISAType == ActiveISA))
+                      SetBatchTransformISA(ISAType);
+              }
+              ImGui::EndCombo();
+          }
+
+          // Arranque: con la caché caliente no se compila ningún shader
+          if (m_StartupStats.StateCacheOn)
+          {
+              ImGui::Text("Inicio: %.1f ms (caché %s, %u en caché, %u compilados)", m_StartupStats.InitTimeMs,
+                          m_StartupStats.StateCacheWarm ? "caliente" : "fría", m_StartupStats.NumCacheHits, m_StartupStats.NumCacheMisses);
+          }
+          else
+          {
+              ImGui::Text("Inicio: %.1f ms (sin caché de estados)", m_StartupStats.InitTimeMs);
+          }
+          // La tarea más larga limita lo que se puede ganar con más hilos
+          ImGui::Text("Escena lista: %.1f ms (tareas: %.1f ms la más larga, %.1f ms en total)", m_StartupStats.SceneReadyTimeMs,
+                      m_StartupStats.LongestTaskMs, m_StartupStats.TotalTaskMs);
+          if (m_MaterialTexturesReady)
+              ImGui::Text("Texturas del móvil: %.1f ms", m_StartupStats.TexturesReadyMs);
+          else
+              ImGui::Text("Texturas del móvil: cargando %u/%u tareas", m_TextureGraph.GetNumFinished(), m_TextureGraph.GetNumTasks());
+          if (m_MaterialTexturesSRV)
+          {
+              const TextureDesc& MaterialDesc = m_MaterialTexturesSRV->GetTexture()->GetDesc();
+              ImGui::Text("Materiales: %s, %u KB", GetTextureFormatAttribs(MaterialDesc.Format).Name,
+                          static_cast<Uint32>(GetTextureMemorySize(MaterialDesc) >> 10));
+          }
+
+#if TUTORIAL04_CPU_PROFILER
+          // Zonas del perfil del CPU de todos los hilos, para abrir en chrome://tracing o Perfetto
+          static int NumTraceEvents = -2;
+          if (ImGui::Button("Exportar traza del CPU"))
+              NumTraceEvents = CPUProfiler::ExportChromeTrace("tutorial04_cpu_trace.json");
+          if (NumTraceEvents >= 0)
+              ImGui::Text("%d eventos en tutorial04_cpu_trace.json", NumTraceEvents);
+          else if (NumTraceEvents == -1)
+              ImGui::Text("No se pudo escribir tutorial04_cpu_trace.json");
+#endif
+      }
+      ImGui::End();
+    
+    ImGui::SliderFloat("Texture Blend Factor", &blendFactor, 0.0f, 1.0f);
+    if (ImGui::Begin("Ventana 1: Paneo y Zoom", nullptr))
+    {
+        ImGui::Text("Arrastre con el ratón para paneo");
+        ImGui::Text("Use la rueda del ratón para zoom");
+        
+        // Controladores de paneo
+        ImGui::SliderFloat("Pan X", &CameraWindow1.PanOffset.x, -10.0f, 10.0f);
+        ImGui::SliderFloat("Pan Y", &CameraWindow1.PanOffset.y, -10.0f, 10.0f);
+        
+        // Controlador de zoom
+        ImGui::SliderFloat("Zoom", &CameraWindow1.Zoom, 0.1f, 5.0f);
+        
+        if (ImGui::Button("Reset Camera"))
+        {
+            CameraWindow1.PanOffset = float2(0.0f, 0.0f);
+            CameraWindow1.Zoom = 1.0f;
+        }
+    }
+    ImGui::End();
     
     // Ventana 2: Control Orbital
     ImGui::SetNextWindowPos(ImVec2(320, 10), ImGuiCond_FirstUseEver);
@@ -458,432 +1340,1340 @@ void Tutorial04_Instancing::UpdateUI()
         ImGui::SliderFloat("Zoom", &CameraWindow3.ViewZoom, 0.01f, 0.5f, "%.3f");
     }
     ImGui::End();
+
+    // Perfil del GPU: medias móviles por pasada, leídas con unos frames de retraso
+    ImGui::SetNextWindowPos(ImVec2(940, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(460, 240), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Perfil del GPU", nullptr))
+    {
+        if (!m_GPUProfiler.IsSupported())
+        {
+            ImGui::TextDisabled("El dispositivo no admite consultas de timestamp");
+        }
+        else
+        {
+            const bool Stats = m_GPUProfiler.HasPipelineStatistics();
+            if (!Stats)
+                ImGui::TextDisabled("Sin consultas de estadísticas del pipeline");
+            if (Stats)
+                ImGui::Text("%-22s %9s %10s %10s %11s", "Pasada", "ms", "Vértices", "Primitivas", "Píxeles");
+            else
+                ImGui::Text("%-22s %9s", "Pasada", "ms");
+            ImGui::Separator();
+
+            // Solo las pasadas del modo de render actual
+            for (Uint32 Pass = 0; Pass < GPU_PROFILE_PASS_COUNT; ++Pass)
+            {
+                if (!m_GPUProfiler.IsActive(Pass))
+                    continue;
+                const GPUPassProfiler::PassStats& Avg = m_GPUProfiler.GetAverage(Pass);
+                if (Stats)
+                    ImGui::Text("%-22s %9.3f %10.0f %10.0f %11.0f", GetGPUProfilePassName(Pass), Avg.TimeMs, Avg.Vertices, Avg.Primitives, Avg.PSInvocations);
+                else
+                    ImGui::Text("%-22s %9.3f", GetGPUProfilePassName(Pass), Avg.TimeMs);
+            }
+        }
+    }
+    ImGui::End();
 }
 
-void Tutorial04_Instancing::PopulateInstanceBuffer()
+const char* Tutorial04_Instancing::GetGPUProfilePassName(Uint32 Pass)
 {
-    std::vector<InstanceDataType> InstanceDataArray(MaxInstances);
-    int instId = 0;
-
-    // Ángulos de rotación para diferentes partes
-    static float mainRotation = 0.0f;          // Rotación principal del móvil
-    static float firstTierRotation = 0.0f;     // Rotación del primer nivel
-    static float secondTierRotation = 0.0f;    // Rotación del segundo nivel
-
-    // Actualizar ángulos con velocidades diferenciadas
-    mainRotation += 0.003f;                    // Rotación base más lenta
-    firstTierRotation += 0.005f;               // Primer nivel gira un poco más rápido
-    secondTierRotation += 0.007f;              // Segundo nivel gira más rápido aún
-
-    // Base principal (placa superior)
-    float4x4 baseMatrix = float4x4::Scale(1.6f, 0.1f, 1.6f) * float4x4::Translation(0.0f, 4.8f, 0.0f);
-    InstanceDataArray[instId].Transform = baseMatrix;
-    InstanceDataArray[instId].TexSelector = 0.0f;  // Mezcla 1-2
-    instId++;
-
-    // Matrices de rotación para los diferentes niveles
-    float4x4 mainRotMatrix = float4x4::RotationY(mainRotation);
-    float4x4 firstLevelMatrix = mainRotMatrix * float4x4::RotationY(firstTierRotation);
-    float4x4 secondLevelMatrix = firstLevelMatrix * float4x4::RotationY(secondTierRotation);
-
-    // === PRIMER NIVEL ===
-    // Palo central vertical
-    float4x4 centerPoleMatrix = float4x4::Scale(0.1f, 1.0f, 0.1f) * float4x4::Translation(0.0f, 3.65f, 0.0f);
-    InstanceDataArray[instId].Transform = centerPoleMatrix;
-    InstanceDataArray[instId].TexSelector = 1.0f;  // Mezcla 1-3
-    instId++;
-
-    // Brazos horizontales del primer nivel
-    float4x4 horizontalArm1 = float4x4::Scale(3.6f, 0.1f, 0.1f) *
-                             float4x4::Translation(0.0f, 2.6f, 0.0f) *
-                             firstLevelMatrix;
-    float4x4 horizontalArm2 = float4x4::Scale(0.1f, 0.1f, 3.6f) *
-                             float4x4::Translation(0.0f, 2.6f, 0.0f) *
-                             firstLevelMatrix;
-    
-    InstanceDataArray[instId].Transform = horizontalArm1;
-    InstanceDataArray[instId].TexSelector = 1.0f;  // Mezcla 1-3
-    instId++;
-    
-    InstanceDataArray[instId].Transform = horizontalArm2;
-    InstanceDataArray[instId].TexSelector = 1.0f;  // Mezcla 1-3
-    instId++;
-
-    // Cubos del primer nivel
-    float4x4 cubePositions[] = {
-        float4x4::Translation(3.0f, 2.0f, 0.0f),
-        float4x4::Translation(-3.0f, 2.0f, 0.0f),
-        float4x4::Translation(0.0f, 2.0f, 3.0f),
-        float4x4::Translation(0.0f, 2.0f, -3.0f)
+    static const char* const Names[] =
+    {
+        "Animación (compute)",
+        "Culling (compute)",
+        "Mapa de sombras",
+        "Suelo, vista 1",
+        "Suelo, vista 2",
+        "Suelo, vista 3",
+        "Móvil, vista 1",
+        "Móvil, vista 2",
+        "Móvil, vista 3",
+        "Suelo, pasada única",
+        "Móvil, pasada única",
+        "Vistas en paralelo",
+        "Composición de vistas",
     };
+    static_assert(_countof(Names) == GPU_PROFILE_PASS_COUNT, "Falta el nombre de alguna pasada");
+    static_assert(NumViews == 3, "Los nombres de las pasadas suponen tres vistas");
+    return Pass < GPU_PROFILE_PASS_COUNT ? Names[Pass] : "";
+}
 
-    // Alternamos entre diferentes mezclas para los cubos
-    float cubeSelectors[] = {0.0f, 1.0f, 2.0f, 0.0f};
+void Tutorial04_Instancing::CreateThreadPool(Uint32 NumThreads)
+{
+    // Las texturas del móvil pueden seguir decodificándose en el pool actual
+    m_TextureGraph.Wait();
 
-    for (int i = 0; i < static_cast<int>(sizeof(cubePositions)/sizeof(cubePositions[0])); i++) {
-        float4x4 cubeMatrix = float4x4::Scale(0.6f, 0.6f, 0.6f) * cubePositions[i] * firstLevelMatrix;
-        InstanceDataArray[instId].Transform = cubeMatrix;
-        InstanceDataArray[instId].TexSelector = cubeSelectors[i % 4];
-        instId++;
-    }
+    // El hilo principal también ejecuta bloques en ParallelFor()
+    m_pThreadPool.reset();
+    m_NumThreads  = static_cast<int>(std::max(NumThreads, 1u));
+    m_pThreadPool.reset(new WorkStealingThreadPool{static_cast<Uint32>(m_NumThreads - 1)});
+}
 
-    // === SEGUNDO NIVEL ===
-    // Palos verticales conectores
-    float4x4 verticalConnectors[] = {
-        float4x4::Scale(0.1f, 0.85f, 0.1f) * float4x4::Translation(0.0f, 0.85f, 3.0f),
-        float4x4::Scale(0.1f, 0.85f, 0.1f) * float4x4::Translation(0.0f, 0.85f, -3.0f),
-        float4x4::Scale(0.1f, 0.85f, 0.1f) * float4x4::Translation(3.0f, 0.85f, 0.0f),
-        float4x4::Scale(0.1f, 0.85f, 0.1f) * float4x4::Translation(-3.0f, 0.85f, 0.0f)
-    };
+// Un tick de la simulación. Las velocidades están en rad/s (0.003, 0.005 y 0.007 rad por frame
+// a 60 fps), así que no dependen de la frecuencia de los ticks.
+void Tutorial04_Instancing::TickSimulation(SimState& State, double TickDuration)
+{
+    const float Dt = static_cast<float>(TickDuration);
+    State.Anim.MainRotation += 0.18f * Dt;       // Rotación base más lenta
+    State.Anim.FirstTierRotation += 0.30f * Dt;  // Primer nivel gira un poco más rápido
+    State.Anim.SecondTierRotation += 0.42f * Dt; // Segundo nivel gira más rápido aún
+    State.SceneTime += TickDuration;
+}
+
+// Avanza la simulación con el tiempo real del frame y fija el estado que se dibuja: la
+// interpolación entre los dos últimos ticks o, si las instancias se reutilizan entre ticks, el
+// último tick, para que solo cambie cuando hay uno nuevo
+void Tutorial04_Instancing::UpdateSimulation(double ElapsedTime)
+{
+    m_SimTicksLastFrame = m_SimClock.Advance(ElapsedTime);
+    for (Uint32 i = 0; i < m_SimTicksLastFrame; ++i)
+    {
+        m_SimPrev = m_SimCurr;
+        TickSimulation(m_SimCurr, m_SimClock.GetTickDuration());
+    }
 
-    for (int i = 0; i < static_cast<int>(sizeof(verticalConnectors)/sizeof(verticalConnectors[0])); i++) {
-        InstanceDataArray[instId].Transform = verticalConnectors[i] * firstLevelMatrix;
-        InstanceDataArray[instId].TexSelector = 1.0f;  // Mezcla 1-3
-        instId++;
+    if (m_ReuseInstancesBetweenTicks)
+    {
+        m_MobileAnim = m_SimCurr.Anim;
+        m_SceneTime  = m_SimCurr.SceneTime;
+        return;
     }
 
-    // Brazos horizontales del segundo nivel
-    float4x4 secondLevelArms[] = {
-        float4x4::Scale(2.0f, 0.1f, 0.1f) * float4x4::Translation(0.0f, 0.2f, 3.0f),
-        float4x4::Scale(2.0f, 0.1f, 0.1f) * float4x4::Translation(0.0f, 0.2f, -3.0f),
-        float4x4::Scale(0.1f, 0.1f, 2.0f) * float4x4::Translation(3.0f, 0.2f, 0.0f),
-        float4x4::Scale(0.1f, 0.1f, 2.0f) * float4x4::Translation(-3.0f, 0.2f, 0.0f)
-    };
+    const float Alpha = m_SimClock.GetAlpha();
+    m_MobileAnim.MainRotation       = lerp(m_SimPrev.Anim.MainRotation, m_SimCurr.Anim.MainRotation, Alpha);
+    m_MobileAnim.FirstTierRotation  = lerp(m_SimPrev.Anim.FirstTierRotation, m_SimCurr.Anim.FirstTierRotation, Alpha);
+    m_MobileAnim.SecondTierRotation = lerp(m_SimPrev.Anim.SecondTierRotation, m_SimCurr.Anim.SecondTierRotation, Alpha);
+    m_SceneTime                     = m_SimPrev.SceneTime + (m_SimCurr.SceneTime - m_SimPrev.SceneTime) * Alpha;
+}
 
-    for (int i = 0; i < static_cast<int>(sizeof(secondLevelArms)/sizeof(secondLevelArms[0])); i++) {
-        InstanceDataArray[instId].Transform = secondLevelArms[i] * secondLevelMatrix;
-        InstanceDataArray[instId].TexSelector = 1.0f;  // Mezcla 1-3
-        instId++;
-    }
-
-    // Cubos del segundo nivel
-    float4x4 secondTierPositions[] = {
-        float4x4::Translation(1.0f, -0.4f, 3.0f),
-        float4x4::Translation(-1.0f, -0.4f, 3.0f),
-        float4x4::Translation(1.0f, -0.4f, -3.0f),
-        float4x4::Translation(-1.0f, -0.4f, -3.0f),
-        float4x4::Translation(3.0f, -0.4f, 1.0f),
-        float4x4::Translation(3.0f, -0.4f, -1.0f),
-        float4x4::Translation(-3.0f, -0.4f, 1.0f),
-        float4x4::Translation(-3.0f, -0.4f, -1.0f)
-    };
+// Devuelve true si las instancias del frame anterior sirven para este: solo con
+// m_ReuseInstancesBetweenTicks y si no ha cambiado nada de lo que las genera
+bool Tutorial04_Instancing::ReuseInstances(INSTANCE_GEN_PATH Path)
+{
+    InstanceGenState State;
+    State.Anim     = m_MobileAnim;
+    State.GridSize = Path == INSTANCE_GEN_PATH_GPU ? GetGPUGridSize() : (m_GridMode ? static_cast<Uint32>(m_GridSize) : 0u); // 0: solo el móvil
+    State.Format   = Path == INSTANCE_GEN_PATH_GPU ? INSTANCE_FORMAT_FULL : m_InstanceFormat;
+    State.Path     = Path;
+
+    const bool Reuse = m_ReuseInstancesBetweenTicks && m_InstanceGenStateValid && State == m_InstanceGenState;
+
+    m_InstanceGenState      = State;
+    m_InstanceGenStateValid = m_ReuseInstancesBetweenTicks;
+    if (Reuse)
+        ++m_NumReusedInstanceFrames;
+    else
+        ++m_NumGeneratedInstanceFrames;
+    return Reuse;
+}
+
+void Tutorial04_Instancing::SetSimulation(Uint32 TickRate, bool ReuseInstancesBetweenTicks)
+{
+    m_SimClock.SetTickRate(TickRate);
+    m_ReuseInstancesBetweenTicks = ReuseInstancesBetweenTicks;
+}
 
-    for (int i = 0; i < static_cast<int>(sizeof(secondTierPositions)/sizeof(secondTierPositions[0])); i++) {
-        float4x4 cubeMatrix = float4x4::Scale(0.6f, 0.6f, 0.6f) * secondTierPositions[i] * secondLevelMatrix;
-        InstanceDataArray[instId].Transform = cubeMatrix;
-        // Alternamos las mezclas para los cubos del segundo nivel
-        InstanceDataArray[instId].TexSelector = i % 3;  // Alternamos entre 0, 1 y 2
-        instId++;
+void Tutorial04_Instancing::SetOnDemandRendering(bool OnDemand)
+{
+    m_OnDemandRendering = OnDemand;
+    if (OnDemand)
+    {
+        m_MultiView = false;
+        // La caché puede ser de un frame antiguo
+        for (Uint32 View = 0; View < NumViews; ++View)
+            m_ViewCacheValid[View] = false;
     }
+}
 
-    // Actualizar el buffer
-    Uint32 DataSize = static_cast<Uint32>(sizeof(InstanceDataType) * instId);
-    m_pImmediateContext->UpdateBuffer(m_InstanceBuffer, 0, DataSize, InstanceDataArray.data(),
-                                  RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+// Con culling en CPU las instancias se generan en memoria del sistema y solo se suben las
+// visibles. La pasada única dibuja la misma lista de instancias en todas las vistas.
+bool Tutorial04_Instancing::UseCPUCullingPath() const
+{
+    return !(m_GPUAnimation && m_pMobileAnimPSO) && m_CPUCulling && !m_MultiView;
 }
 
-void Tutorial04_Instancing::Update(double CurrTime, double ElapsedTime)
+void Tutorial04_Instancing::PopulateInstanceBuffer()
 {
-    SampleBase::Update(CurrTime, ElapsedTime);
-    
-    // Actualizar constante del pixel shader para la mezcla de texturas y propiedades de iluminación
+    CPU_PROFILE_ZONE("PopulateInstanceBuffer");
+    Timer GenTimer;
+
+    m_MobileGrid.SetGridSize(static_cast<Uint32>(m_GridSize));
+    const Uint32 NumInstances = m_GridMode ? m_MobileGrid.GetNumInstances() : NumMobileParts;
+    VERIFY_EXPR(NumInstances <= static_cast<Uint32>(MaxInstances));
+
+    // Las instancias ya se generaron en GenerateCulledInstances()
+    if (UseCPUCullingPath())
     {
-        MapHelper<float> PSConstants(m_pImmediateContext, m_PSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-        PSConstants[0] = blendFactor;
-        
-        // Resto de las propiedades de iluminación
-        float4* pLightDir = reinterpret_cast<float4*>(&PSConstants[1]);
-        *pLightDir = float4(normalize(lightDir), 0.0f);
-        
-        float4* pLightColor = reinterpret_cast<float4*>(&PSConstants[5]);
-        *pLightColor = lightColor;
-        
-        float4* pAmbientColor = reinterpret_cast<float4*>(&PSConstants[9]);
-        *pAmbientColor = ambientColor;
-        
-        // Para el cálculo de iluminación, necesitamos la posición de la cámara
-        float3 cameraPos = float3(0.0f, 0.0f, 0.0f);
-        switch(m_ActiveWindow)
+        PopulateCulledInstanceBuffer();
+    }
+    else if (m_ReuseInstancesBetweenTicks)
+    {
+        // Los buffers dinámicos y el anillo no conservan su contenido entre frames, así que las
+        // instancias se suben a un buffer en memoria del GPU y solo se actualiza en los ticks
+        if (!ReuseInstances(INSTANCE_GEN_PATH_RETAINED))
         {
-            case 0: // Ventana 1
-                cameraPos = float3(CameraWindow1.PanOffset.x, CameraWindow1.PanOffset.y, 20.0f / CameraWindow1.Zoom);
-                break;
-            case 1: // Ventana 2
+            if (!m_RetainedInstanceBuffer)
             {
-                // Calcular dirección usando trigonometría directamente
-                float3 dir;
-                dir.x = -sin(CameraWindow2.OrbitAngleY) * cos(CameraWindow2.OrbitAngleX);
-                dir.y = -sin(CameraWindow2.OrbitAngleX);
-                dir.z = -cos(CameraWindow2.OrbitAngleY) * cos(CameraWindow2.OrbitAngleX);
-                dir = normalize(dir);
-                cameraPos = -dir * CameraWindow2.OrbitDistance;
+                BufferDesc BuffDesc;
+                BuffDesc.Name      = "Retained instance buffer";
+                BuffDesc.Usage     = USAGE_DEFAULT;
+                BuffDesc.BindFlags = BIND_VERTEX_BUFFER;
+                BuffDesc.Size      = sizeof(InstanceDataType) * MaxInstances;
+                m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_RetainedInstanceBuffer);
             }
-                break;
-            case 2: // Ventana 3
-                cameraPos = CameraWindow3.Position;
-                break;
-            default:
-                cameraPos = float3(0.0f, 0.0f, 20.0f);
+
+            m_RetainedInstanceData.resize(size_t{NumInstances} * GetInstanceStride(m_InstanceFormat));
+            m_NumInstances = WriteInstances(m_RetainedInstanceData.data(), NumInstances);
+            m_pImmediateContext->UpdateBuffer(m_RetainedInstanceBuffer, 0, static_cast<Uint64>(m_RetainedInstanceData.size()),
+                                              m_RetainedInstanceData.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
         }
-        
-        float4* pCameraPos = reinterpret_cast<float4*>(&PSConstants[13]);
-        *pCameraPos = float4(cameraPos, 1.0f);
-        
-        // Propiedades especulares
-        float* pSpecularPower = reinterpret_cast<float*>(&PSConstants[17]);
-        *pSpecularPower = specularPower;
-        
-        float* pSpecularIntensity = reinterpret_cast<float*>(&PSConstants[18]);
-        *pSpecularIntensity = specularIntensity;
-        
-        // Matriz de view-projection de la luz para sombras
-        float4x4* pLightViewProj = reinterpret_cast<float4x4*>(&PSConstants[19]);
-        *pLightViewProj = m_LightViewProjMatrix;
+        else
+        {
+            m_NumNodesUpdated = 0;
+        }
+        m_pCurrInstanceBuffer = m_RetainedInstanceBuffer;
+        m_CurrInstanceFormat  = m_InstanceFormat;
+
+        // Todas las vistas dibujan el buffer completo
+        for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+        {
+            InstanceRange Range;
+            GetMaterialRange(Material, Range.First, Range.Count);
+            for (Uint32 View = 0; View < NumViews; ++View)
+                m_MaterialRanges[View][Material] = Range;
+        }
+        m_InstancesSortedByMaterial = true;
     }
-    
-    // Actualizar también los atributos de luz para el suelo
+    else
     {
-        MapHelper<float4> LightAttribs(m_pImmediateContext, m_LightAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
-        LightAttribs[0] = float4(normalize(lightDir), 0.0f);
-        LightAttribs[1] = lightColor;
-        LightAttribs[2] = ambientColor;
-        
-        // Posición de la cámara
-        float3 cameraPos = float3(0.0f, 0.0f, 0.0f);
-        if (m_ActiveWindow >= 0 && m_ActiveWindow < 3)
+        ReuseInstances(INSTANCE_GEN_PATH_RETAINED); // Solo cuenta el frame
+
+        IBuffer*  pBuffer  = nullptr;
+        MAP_FLAGS MapFlags = MAP_FLAG_DISCARD;
+        if (m_InstanceFence)
         {
-            switch(m_ActiveWindow)
+            // El slot de este frame sólo se reutiliza si el GPU ya terminó el frame que lo usó.
+            // En caso contrario no esperamos: este frame usa el buffer dinámico.
+            const Uint32 Slot = static_cast<Uint32>(m_FrameId % NumInstanceFramesInFlight);
+            if (m_InstanceFence->GetCompletedValue() >= m_InstanceRingFenceValue[Slot])
             {
-                case 0: cameraPos = float3(CameraWindow1.PanOffset.x, CameraWindow1.PanOffset.y, 20.0f / CameraWindow1.Zoom); break;
-                case 1:
-                {
-                    float3 dir = float3(0.0f, 0.0f, -1.0f);
-                    float4x4 rotMat = float4x4::RotationX(CameraWindow2.OrbitAngleX) * float4x4::RotationY(CameraWindow2.OrbitAngleY);
-                    float4 dir4 = rotMat * float4(dir, 0.0f);
-                    dir = normalize(float3(dir4.x, dir4.y, dir4.z));
-                    cameraPos = -dir * CameraWindow2.OrbitDistance;
-                }
-                break;
-                case 2: cameraPos = CameraWindow3.Position; break;
+                pBuffer  = m_InstanceRing[Slot];
+                MapFlags = MAP_FLAG_NO_OVERWRITE;
+                // Valor que se señalizará al final de este frame en Render()
+                m_InstanceRingFenceValue[Slot] = m_FrameId + 1;
             }
         }
-        else
+
+        if (pBuffer == nullptr)
         {
-            cameraPos = float3(0.0f, 0.0f, 20.0f);
+            ReserveDynamicInstanceBuffer(m_pDevice, m_InstanceBuffer, m_InstanceBufferCapacity, NumInstances);
+            pBuffer = m_InstanceBuffer;
         }
-        
-        LightAttribs[3] = float4(cameraPos, 1.0f);
-        
-        // Propiedades especulares
-        float* pSpecularPower = reinterpret_cast<float*>(&LightAttribs[4]);
-        *pSpecularPower = specularPower;
-        
-        float* pSpecularIntensity = reinterpret_cast<float*>(pSpecularPower + 1);
-        *pSpecularIntensity = specularIntensity;
-        
-        // Matriz de view-projection de la luz para sombras
-        float4x4* pLightViewProj = reinterpret_cast<float4x4*>(&LightAttribs[5]);
-        *pLightViewProj = m_LightViewProjMatrix;
+
+        {
+            CPU_PROFILE_ZONE("Map: instancias");
+            MapHelper<Uint8> MappedData(m_pImmediateContext, pBuffer, MAP_WRITE, MapFlags);
+            m_NumInstances = WriteInstances(MappedData, NumInstances);
+        }
+        m_pCurrInstanceBuffer = pBuffer;
+        m_CurrInstanceFormat  = m_InstanceFormat;
+
+        // Todas las vistas dibujan el buffer completo
+        for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+        {
+            InstanceRange Range;
+            GetMaterialRange(Material, Range.First, Range.Count);
+            for (Uint32 View = 0; View < NumViews; ++View)
+                m_MaterialRanges[View][Material] = Range;
+        }
+        m_InstancesSortedByMaterial = true;
     }
-    
-    UpdateUI();
-    
-    CalculateLightViewProj();
 
-    // Get pretransform matrix that rotates the scene according the surface orientation
-    auto SrfPreTransform = GetSurfacePretransformMatrix(float3{0, 0, 1});
+    m_InstanceGenTimeMs = static_cast<float>(GenTimer.GetElapsedTime() * 1000.0);
+    if (UseCPUCullingPath())
+        m_InstanceGenTimeMs += m_CulledGenTimeMs;
+}
 
-    // Get projection matrix adjusted to the current screen orientation
-    auto Proj = GetAdjustedProjectionMatrix(PI_F / 4.0f, 0.1f, 100.f);
+// Genera las instancias en memoria del sistema y reajusta la BVH. Se llama al principio de
+// Render(), antes de ajustar la luz a la raíz de la BVH; si no ha habido un tick se reutilizan
+// las instancias y la BVH del frame anterior.
+void Tutorial04_Instancing::GenerateCulledInstances()
+{
+    CPU_PROFILE_ZONE("GenerateCulledInstances");
+    Timer GenTimer;
 
-    // Se usa ViewWindow1 como matriz de vista predeterminada
-    m_ViewProjMatrix = ViewWindow1 * SrfPreTransform * Proj;
+    m_MobileGrid.SetGridSize(static_cast<Uint32>(m_GridSize));
+    const Uint32 NumInstances = m_GridMode ? m_MobileGrid.GetNumInstances() : NumMobileParts;
+    VERIFY_EXPR(NumInstances <= static_cast<Uint32>(MaxInstances));
 
-    // Global rotation matrix
-    m_RotationMatrix = float4x4::RotationY(static_cast<float>(CurrTime) * 0.1f) *
-                            float4x4::RotationX(-static_cast<float>(CurrTime) * 0.05f);
-    
-    // Actualizar la matriz de transformación del suelo
+    // La memoria mapeada para escritura no debe leerse desde el CPU, y la BVH necesita leer
+    // las transformaciones
+    if (!ReuseInstances(INSTANCE_GEN_PATH_CPU_CULLING))
     {
-        MapHelper<float4x4> FloorTransform(m_pImmediateContext, m_FloorTransform, MAP_WRITE, MAP_FLAG_DISCARD);
-        FloorTransform[0] = float4x4::Identity(); // Matriz de modelo
-        FloorTransform[1] = m_ViewProjMatrix;     // Matriz de vista-proyección
+        m_CPUInstances.resize(NumInstances);
+        m_NumInstances = m_GridMode ? WriteGridInstances(m_CPUInstances.data()) : WriteMobileInstances(m_CPUInstances.data());
+        if (m_InstanceBVH.Update(m_CPUInstances.data(), m_NumInstances))
+            m_PickedInstance = InstanceBVH::InvalidIndex; // Los índices ya no corresponden
+    }
+    else
+    {
+        m_NumNodesUpdated = 0;
     }
-}
 
-void Tutorial04_Instancing::CalculateLightViewProj()
-{
-    // Calcular una matriz de vista-proyección para la luz simplificada
-    
-    // Normalizar la dirección de la luz
-    float3 lightDir = normalize(float3(m_LightDirection.x, m_LightDirection.y, m_LightDirection.z));
-    float3 lightPos = -lightDir * 30.0f; // Posición de la luz a 30 unidades en dirección opuesta
-    
-    // Crear manualmente una matriz de vista basada en la posición de la luz
-    float4x4 lightView = float4x4::Translation(-lightPos.x, -lightPos.y, -lightPos.z);
-    
-    // Construir manualmente una matriz de proyección ortográfica
-    // Parámetros para una caja de vista ortográfica
-    float size = 20.0f;
-    float near = 0.1f;
-    float far = 100.0f;
-    
-    // Construir la matriz de proyección ortográfica manualmente
-    float4x4 lightProj;
-    lightProj._11 = 1.0f / size;
-    lightProj._12 = 0.0f;
-    lightProj._13 = 0.0f;
-    lightProj._14 = 0.0f;
-    
-    lightProj._21 = 0.0f;
-    lightProj._22 = 1.0f / size;
-    lightProj._23 = 0.0f;
-    lightProj._24 = 0.0f;
-    
-    lightProj._31 = 0.0f;
-    lightProj._32 = 0.0f;
-    lightProj._33 = 2.0f / (far - near);
-    lightProj._34 = 0.0f;
-    
-    lightProj._41 = 0.0f;
-    lightProj._42 = 0.0f;
-    lightProj._43 = -(far + near) / (far - near);
-    lightProj._44 = 1.0f;
-    
-    // Combinar vista y proyección
-    m_LightViewProjMatrix = lightView * lightProj;
+    m_CulledGenTimeMs = static_cast<float>(GenTimer.GetElapsedTime() * 1000.0);
 }
 
-void Tutorial04_Instancing::CreateLightingBuffers()
+// Sube sólo las instancias visibles de cada vista (y las que proyectan sombra), una vista tras
+// otra, a un buffer dinámico
+void Tutorial04_Instancing::PopulateCulledInstanceBuffer()
 {
-    // Crear buffer para atributos de luz
-    BufferDesc BuffDesc;
-    BuffDesc.Name = "Light attributes buffer";
-    BuffDesc.Size = sizeof(float4) * 4 + sizeof(float) * 2; // LightDir, LightColor, AmbientColor, CameraPos, SpecularPower, SpecularIntensity
-    BuffDesc.Usage = USAGE_DYNAMIC;
-    BuffDesc.BindFlags = BIND_UNIFORM_BUFFER;
-    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightAttribs);
+    CPU_PROFILE_ZONE("PopulateCulledInstanceBuffer");
 
-    // Crear buffer para transformación del suelo
-    BuffDesc.Name = "Floor transform buffer";
-    BuffDesc.Size = sizeof(float4x4) * 2; // Model, ViewProj
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_FloorTransform);
-}
+    const bool IsGL         = m_pDevice->GetDeviceInfo().IsGLDevice();
+    Uint32     TotalVisible = 0;
+    for (Uint32 View = 0; View < NumViews; ++View)
+    {
+        // Las constantes se suben sin trasponer, por lo que el shader aplica la traspuesta de ViewProj
+        ViewFrustum Frustum;
+        ExtractViewFrustumPlanesFromMatrix(m_ViewProjs[View].Transpose(), Frustum, IsGL);
+
+        m_ViewVisibleInstances[View].clear();
+        m_InstanceBVH.QueryFrustum(Frustum, m_ViewVisibleInstances[View]);
+        SortVisibleInstancesByMaterial(View);
+        m_ViewFirstInstance[View] = TotalVisible;
+        m_ViewNumInstances[View]  = static_cast<Uint32>(m_ViewVisibleInstances[View].size());
+        for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+            m_MaterialRanges[View][Material].First += TotalVisible;
+        TotalVisible += m_ViewNumInstances[View];
+    }
 
-void Tutorial04_Instancing::CreateShadowMap()
-{
-    // Crear textura para el mapa de sombras simplificado
-    TextureDesc ShadowMapDesc;
-    ShadowMapDesc.Name = "Shadow map";
-    ShadowMapDesc.Type = RESOURCE_DIM_TEX_2D;
-    ShadowMapDesc.Width = 1024;
-    ShadowMapDesc.Height = 1024;
-    ShadowMapDesc.Format = TEX_FORMAT_D32_FLOAT;
-    ShadowMapDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_DEPTH_STENCIL;
-    ShadowMapDesc.MipLevels = 1;
+    // Si el mapa de sombras se actualiza este frame, sus instancias (las que corta el volumen de
+    // la luz) van en un segmento más a continuación de las vistas
+    m_ShadowCasterInstances.clear();
+    if (m_ShadowUpdatePending)
+    {
+        // La matriz de la luz ya está construida para vectores fila
+        ViewFrustum Frustum;
+        ExtractViewFrustumPlanesFromMatrix(m_LightViewProjMatrix, Frustum, IsGL);
+        m_InstanceBVH.QueryFrustum(Frustum, m_ShadowCasterInstances);
+    }
+    m_ShadowFirstInstance = TotalVisible;
+    m_ShadowNumInstances  = static_cast<Uint32>(m_ShadowCasterInstances.size());
+    TotalVisible += m_ShadowNumInstances;
 
-    m_pDevice->CreateTexture(ShadowMapDesc, nullptr, &m_ShadowMap);
-    m_ShadowMapDSV = m_ShadowMap->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
-    m_ShadowMapSRV = m_ShadowMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    ReserveDynamicInstanceBuffer(m_pDevice, m_CulledInstanceBuffer, m_CulledInstanceBufferCapacity, TotalVisible);
+    {
+        CPU_PROFILE_ZONE("Map: instancias visibles");
+        MapHelper<Uint8> MappedData(m_pImmediateContext, m_CulledInstanceBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+        Uint8*           pDst   = MappedData;
+        const Uint32     Stride = GetInstanceStride(m_InstanceFormat);
+        for (Uint32 View = 0; View < NumViews; ++View)
+        {
+            for (Uint32 Idx : m_ViewVisibleInstances[View])
+            {
+                EncodeInstances(m_InstanceFormat, &m_CPUInstances[Idx], 1, pDst);
+                pDst += Stride;
+            }
+        }
+        for (Uint32 Idx : m_ShadowCasterInstances)
+        {
+            EncodeInstances(m_InstanceFormat, &m_CPUInstances[Idx], 1, pDst);
+            pDst += Stride;
+        }
+    }
+    m_pCurrInstanceBuffer       = m_CulledInstanceBuffer;
+    m_CurrInstanceFormat        = m_InstanceFormat;
+    m_InstancesSortedByMaterial = true;
 }
 
-void Tutorial04_Instancing::CreateShadowMapPSO()
+// Rango de instancias del material Material en el buffer completo que generan
+// WriteMobileInstances() y WriteGridInstances()
+void Tutorial04_Instancing::GetMaterialRange(Uint32 Material, Uint32& FirstInstance, Uint32& NumInstances) const
 {
-    // Liberar referencias existentes para evitar fugas de memoria
-    m_pShadowMapPSO.Release();
-    m_ShadowMapSRB.Release();
-    
-    // Crear PSO simplificado para renderizar objetos al mapa de sombras
-    GraphicsPipelineStateCreateInfo PSOCreateInfo;
-    PipelineStateDesc&              PSODesc = PSOCreateInfo.PSODesc;
+    if (m_GridMode)
+    {
+        m_MobileGrid.GetMaterialRange(Material, 0, m_MobileGrid.GetNumMobiles(), FirstInstance, NumInstances);
+    }
+    else
+    {
+        const MobileMaterialOrder& Order = GetMobileMaterialOrder();
+        FirstInstance                    = Order.FirstPart[Material];
+        NumInstances                     = Order.GetNumParts(Material);
+    }
+}
 
-    PSODesc.Name = "Shadow map PSO";
-    PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+// Agrupa por material las instancias visibles de la vista, conservando el orden de la BVH dentro
+// de cada material, y calcula los rangos de cada material relativos al segmento de la vista.
+// El material de una instancia se deduce de su índice porque el buffer completo está ordenado
+// por materiales.
+void Tutorial04_Instancing::SortVisibleInstancesByMaterial(Uint32 View)
+{
+    std::vector<Uint32>& Visible = m_ViewVisibleInstances[View];
 
-    // Configurar el render target y depth buffer
-    GraphicsPipelineDesc& GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
-    GraphicsPipeline.NumRenderTargets = 0; // No render target, solo depth buffer
-    GraphicsPipeline.DSVFormat = TEX_FORMAT_D32_FLOAT;
-    GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_BACK;
-    GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
-    GraphicsPipeline.DepthStencilDesc.DepthWriteEnable = True;
-    
-    ShaderCreateInfo ShaderCI;
-    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
-    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    Uint32 MaterialEnd[NumMobileMaterials] = {};
+    for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+    {
+        Uint32 First = 0, Count = 0;
+        GetMaterialRange(Material, First, Count);
+        MaterialEnd[Material] = First + Count;
+    }
+    auto GetMaterial = [&MaterialEnd](Uint32 Idx) {
+        Uint32 Material = 0;
+        while (Material + 1 < NumMobileMaterials && Idx >= MaterialEnd[Material])
+            ++Material;
+        return Material;
+    };
 
-    // Crear factory para cargar los shaders
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+    Uint32 Counts[NumMobileMaterials] = {};
+    for (Uint32 Idx : Visible)
+        ++Counts[GetMaterial(Idx)];
 
-    // Crear vertex shader
-    RefCntAutoPtr<IShader> pVS;
+    Uint32 Offsets[NumMobileMaterials] = {};
+    for (Uint32 Material = 0, Offset = 0; Material < NumMobileMaterials; ++Material)
     {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Shadow VS";
-        ShaderCI.FilePath = "shadowmap.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        m_MaterialRanges[View][Material] = InstanceRange{Offset, Counts[Material]};
+        Offsets[Material]                = Offset;
+        Offset += Counts[Material];
     }
 
-    // Para OpenGL y otros backends, necesitamos un pixel shader, aunque sea vacío
-    RefCntAutoPtr<IShader> pPS;
+    m_VisibleScratch.resize(Visible.size());
+    for (Uint32 Idx : Visible)
+        m_VisibleScratch[Offsets[GetMaterial(Idx)]++] = Idx;
+    Visible.swap(m_VisibleScratch);
+}
+
+// Lanza un rayo desde el píxel (x, y) de la ventana windowIdx y devuelve la instancia más cercana
+Uint32 Tutorial04_Instancing::PickInstance(int x, int y, int windowIdx) const
+{
+    if (m_InstanceBVH.GetNumInstances() == 0)
+        return InstanceBVH::InvalidIndex;
+
+    // Coordenadas normalizadas dentro del viewport de la ventana
+    const auto& SCDesc         = GetTargetDesc();
+    const float ViewportWidth  = static_cast<float>(SCDesc.Width / 3);
+    const float ViewportHeight = static_cast<float>(SCDesc.Height);
+    const float NdcX           = (static_cast<float>(x) - ViewportWidth * static_cast<float>(windowIdx)) / ViewportWidth * 2.f - 1.f;
+    const float NdcY           = 1.f - static_cast<float>(y) / ViewportHeight * 2.f;
+
+    // Deshacer la proyección con la misma matriz que aplica el shader. Las profundidades 0 y 1
+    // están dentro del rango de recorte tanto en Direct3D/Vulkan como en OpenGL.
+    const float4x4 InvViewProj = m_ViewProjs[windowIdx].Transpose().Inverse();
+    const float4   Near        = float4{NdcX, NdcY, 0, 1} * InvViewProj;
+    const float4   Far         = float4{NdcX, NdcY, 1, 1} * InvViewProj;
+    const float3   Origin      = float3{Near.x, Near.y, Near.z} / Near.w;
+    const float3   Target      = float3{Far.x, Far.y, Far.z} / Far.w;
+
+    return m_InstanceBVH.CastRay(Origin, normalize(Target - Origin));
+}
+
+// Escribe las NumInstances instancias del frame en pDst (memoria mapeada) con el formato
+// m_InstanceFormat. El formato completo se escribe directamente; los compactos se generan en
+// m_CPUInstances y se codifican al copiarlos.
+Uint32 Tutorial04_Instancing::WriteInstances(void* pDst, Uint32 NumInstances)
+{
+    if (m_InstanceFormat == INSTANCE_FORMAT_FULL)
     {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Shadow PS";
-        ShaderCI.FilePath = "shadowmap.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        InstanceDataType* pInstances = static_cast<InstanceDataType*>(pDst);
+        return m_GridMode ? WriteGridInstances(pInstances) : WriteMobileInstances(pInstances);
     }
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
+    m_CPUInstances.resize(NumInstances);
+    if (m_GridMode)
+        return WriteGridInstances(m_CPUInstances.data(), pDst);
 
-    // Definir el layout de entrada (mismo que para el cubo instanciado)
-    LayoutElement LayoutElems[] =
-    {
-        // Per-vertex data - first buffer slot
-        LayoutElement{0, 0, 3, VT_FLOAT32, False},
-        LayoutElement{1, 0, 2, VT_FLOAT32, False},
-            
-        // Per-instance data - second buffer slot
-        LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        LayoutElement{4, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        LayoutElement{5, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
-        LayoutElement{6, 1, 1, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
-    };
-    
-    GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
-    GraphicsPipeline.InputLayout.NumElements = _countof(LayoutElems);
+    const Uint32 NumWritten = WriteMobileInstances(m_CPUInstances.data());
+    EncodeInstances(m_InstanceFormat, m_CPUInstances.data(), NumWritten, pDst);
+    return NumWritten;
+}
 
-    // Crear buffer de constantes
-    m_VSConstants.Release();
-    CreateUniformBuffer(m_pDevice, sizeof(float4x4) * 2, "Shadow VS constants", &m_VSConstants);
+// Escribe las transformaciones de las piezas del móvil directamente en InstanceDataArray
+// (memoria mapeada) y devuelve el número de instancias escritas
+Uint32 Tutorial04_Instancing::WriteMobileInstances(InstanceDataType* InstanceDataArray)
+{
+    m_NumNodesUpdated = m_MobileRig.Update(m_MobileAnim);
 
-    // Definir variables estáticas
-    PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
-    
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pShadowMapPSO);
-    
-    if (m_pShadowMapPSO)
+    // Las piezas se escriben agrupadas por material (ver GetMaterialRange())
+    m_MobileRig.WriteInstances(InstanceDataArray);
+    return NumMobileParts;
+}
+
+// Genera la rejilla de móviles repartiendo bloques de móviles entre los hilos del pool.
+// Cada bloque escribe un rango disjunto del buffer mapeado. Si pEncodedDst no es nulo, cada
+// bloque se codifica además en pEncodedDst con el formato m_InstanceFormat mientras sigue en caché.
+Uint32 Tutorial04_Instancing::WriteGridInstances(InstanceDataType* InstanceDataArray, void* pEncodedDst)
+{
+    if (pEncodedDst == nullptr)
     {
-        m_pShadowMapPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
-        m_pShadowMapPSO->CreateShaderResourceBinding(&m_ShadowMapSRB, true);
+        m_MobileGrid.WriteInstancesParallel(*m_pThreadPool, m_MobileAnim, InstanceDataArray);
+        return m_MobileGrid.GetNumInstances();
     }
+
+    const Uint32 Stride = GetInstanceStride(m_InstanceFormat);
+    m_MobileGrid.WriteInstancesParallel(*m_pThreadPool, m_MobileAnim, InstanceDataArray,
+                                        [&](Uint32 FirstMobile, Uint32 NumMobiles) {
+                                            // Las instancias del bloque ocupan un rango por material
+                                            for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+                                            {
+                                                Uint32 FirstInstance = 0, NumInstances = 0;
+                                                m_MobileGrid.GetMaterialRange(Material, FirstMobile, NumMobiles, FirstInstance, NumInstances);
+                                                EncodeInstances(m_InstanceFormat, InstanceDataArray + FirstInstance, NumInstances,
+                                                                static_cast<Uint8*>(pEncodedDst) + size_t{FirstInstance} * Stride);
+                                            }
+                                        });
+    return m_MobileGrid.GetNumInstances();
 }
 
-void Tutorial04_Instancing::CreateFloor()
+void Tutorial04_Instancing::CreateMobileAnimationResources()
 {
-    // Crear los vértices del suelo (un plano XZ grande)
-    struct FloorVertex
-    {
-        float3 Pos;
-        float2 UV;
-    };
+    m_pMobileAnimPSO.Release();
+    m_MobileAnimSRB.Release();
+    m_MobilePartsBuffer.Release();
+    m_GPUInstanceBuffer.Release();
+
+    if (!m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+    {
+        m_GPUAnimation = false;
+        return;
+    }
+
+    // Disposición estática de las piezas: se sube una única vez
+    struct MobilePartGPU
+    {
+        float4x4 Local;
+        float4   Params; // x: nivel, y: selector de textura
+    };
+    MobilePartGPU PartData[NumMobileParts];
+    for (Uint32 i = 0; i < NumMobileParts; ++i)
+    {
+        PartData[i].Local  = MobileParts[i].GetLocalTransform();
+        PartData[i].Params = float4{static_cast<float>(MobileParts[i].Level), MobileParts[i].TexSelector, 0, 0};
+    }
+
+    BufferDesc PartsBuffDesc;
+    PartsBuffDesc.Name              = "Mobile parts buffer";
+    PartsBuffDesc.Usage             = USAGE_IMMUTABLE;
+    PartsBuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+    PartsBuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    PartsBuffDesc.ElementByteStride = sizeof(MobilePartGPU);
+    PartsBuffDesc.Size              = sizeof(PartData);
+
+    BufferData PartsData;
+    PartsData.pData    = PartData;
+    PartsData.DataSize = sizeof(PartData);
+    m_pDevice->CreateBuffer(PartsBuffDesc, &PartsData, &m_MobilePartsBuffer);
+
+    // Buffer de instancias escrito por el compute shader y leído como vertex buffer.
+    // Usamos un buffer con formato R32_FLOAT (RWBuffer<float>) porque los buffers estructurados
+    // no pueden enlazarse como vertex buffer en todos los backends.
+    BufferDesc InstBuffDesc;
+    InstBuffDesc.Name              = "GPU instance data buffer";
+    InstBuffDesc.Usage             = USAGE_DEFAULT;
+    InstBuffDesc.BindFlags         = BIND_VERTEX_BUFFER | BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+    InstBuffDesc.Mode              = BUFFER_MODE_FORMATTED;
+    InstBuffDesc.ElementByteStride = sizeof(float);
+    InstBuffDesc.Size              = sizeof(InstanceDataType) * MaxInstances;
+    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_GPUInstanceBuffer);
+
+    RefCntAutoPtr<IBufferView> pInstanceUAV;
+    if (m_GPUInstanceBuffer)
+    {
+        BufferViewDesc UAVDesc;
+        UAVDesc.ViewType             = BUFFER_VIEW_UNORDERED_ACCESS;
+        UAVDesc.Format.ValueType     = VT_FLOAT32;
+        UAVDesc.Format.NumComponents = 1;
+        m_GPUInstanceBuffer->CreateView(UAVDesc, &pInstanceUAV);
+    }
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pCS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.Desc.Name = "Mobile animation CS";
+        ShaderCI.FilePath = "mobile_anim.csh";
+        CreateShaderWithCache(ShaderCI, &pCS);
+    }
+
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Mobile animation PSO";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+    // Las constantes se escriben en el buffer de constantes del frame
+    ShaderResourceVariableDesc Vars[] =
+    {
+        {SHADER_TYPE_COMPUTE, "AnimConstants", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+    PSOCreateInfo.pCS = pCS;
+    CreateComputePSOWithCache(PSOCreateInfo, &m_pMobileAnimPSO);
+
+    if (m_pMobileAnimPSO && m_MobilePartsBuffer && pInstanceUAV)
+    {
+        m_pMobileAnimPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_MobileParts")->Set(m_MobilePartsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        m_pMobileAnimPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_InstanceData")->Set(pInstanceUAV);
+        m_pMobileAnimPSO->CreateShaderResourceBinding(&m_MobileAnimSRB, true);
+        m_MobileAnimSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "AnimConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(MobileAnimConstants));
+    }
+    else
+    {
+        m_pMobileAnimPSO.Release();
+        m_GPUAnimation = false;
+    }
+}
+
+void Tutorial04_Instancing::AnimateInstancesOnGPU()
+{
+    // El único tráfico CPU->GPU por frame son los ángulos y los parámetros de la rejilla,
+    // escritos en WriteFrameConstants()
+    const Uint32 NumInstances = GetNumGPUInstances();
+
+    // m_GPUInstanceBuffer conserva las instancias del último dispatch
+    if (!ReuseInstances(INSTANCE_GEN_PATH_GPU))
+    {
+        m_MobileAnimSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "AnimConstants")->SetBufferOffset(m_FrameCBOffsets.MobileAnim);
+        m_pImmediateContext->SetPipelineState(m_pMobileAnimPSO);
+        m_pImmediateContext->CommitShaderResources(m_MobileAnimSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DispatchComputeAttribs DispatchAttrs;
+        DispatchAttrs.ThreadGroupCountX = (NumInstances + 63) / 64;
+        m_pImmediateContext->DispatchCompute(DispatchAttrs);
+    }
+
+    // SetVertexBuffers() con RESOURCE_STATE_TRANSITION_MODE_TRANSITION pasa el buffer del
+    // estado UAV al de vertex buffer antes de dibujar
+    m_pCurrInstanceBuffer       = m_GPUInstanceBuffer;
+    m_CurrInstanceFormat        = INSTANCE_FORMAT_FULL;
+    m_InstancesSortedByMaterial = false; // El compute shader escribe las piezas en el orden de MobileParts
+    m_NumInstances              = NumInstances;
+}
+
+void Tutorial04_Instancing::CreateCullingResources()
+{
+    m_pCullPSO.Release();
+    m_CullSRB.Release();
+    m_VisibleInstanceBuffer.Release();
+    m_DrawArgsBuffer.Release();
+
+    // El culling lee el buffer que escribe la animación en el GPU
+    if (!m_pMobileAnimPSO || !m_GPUInstanceBuffer)
+        return;
+
+    // Un segmento de MaxInstances instancias por vista
+    BufferDesc VisibleBuffDesc;
+    VisibleBuffDesc.Name              = "Visible instances buffer";
+    VisibleBuffDesc.Usage             = USAGE_DEFAULT;
+    VisibleBuffDesc.BindFlags         = BIND_VERTEX_BUFFER | BIND_UNORDERED_ACCESS;
+    VisibleBuffDesc.Mode              = BUFFER_MODE_FORMATTED;
+    VisibleBuffDesc.ElementByteStride = sizeof(float);
+    VisibleBuffDesc.Size              = sizeof(InstanceDataType) * MaxInstances * NumViews;
+    m_pDevice->CreateBuffer(VisibleBuffDesc, nullptr, &m_VisibleInstanceBuffer);
+
+    // Cinco enteros por vista: NumIndices, NumInstances, FirstIndex, BaseVertex, FirstInstance
+    BufferDesc ArgsBuffDesc;
+    ArgsBuffDesc.Name              = "Culling draw args buffer";
+    ArgsBuffDesc.Usage             = USAGE_DEFAULT;
+    ArgsBuffDesc.BindFlags         = BIND_INDIRECT_DRAW_ARGS | BIND_UNORDERED_ACCESS;
+    ArgsBuffDesc.Mode              = BUFFER_MODE_FORMATTED;
+    ArgsBuffDesc.ElementByteStride = sizeof(Uint32);
+    ArgsBuffDesc.Size              = sizeof(Uint32) * 5 * NumViews;
+    m_pDevice->CreateBuffer(ArgsBuffDesc, nullptr, &m_DrawArgsBuffer);
+
+    if (!m_VisibleInstanceBuffer || !m_DrawArgsBuffer)
+        return;
+
+    RefCntAutoPtr<IBufferView> pInstanceSRV;
+    RefCntAutoPtr<IBufferView> pVisibleUAV;
+    RefCntAutoPtr<IBufferView> pDrawArgsUAV;
+    {
+        BufferViewDesc ViewDesc;
+        ViewDesc.ViewType             = BUFFER_VIEW_SHADER_RESOURCE;
+        ViewDesc.Format.ValueType     = VT_FLOAT32;
+        ViewDesc.Format.NumComponents = 1;
+        m_GPUInstanceBuffer->CreateView(ViewDesc, &pInstanceSRV);
+
+        ViewDesc.ViewType = BUFFER_VIEW_UNORDERED_ACCESS;
+        m_VisibleInstanceBuffer->CreateView(ViewDesc, &pVisibleUAV);
+
+        ViewDesc.Format.ValueType = VT_UINT32;
+        m_DrawArgsBuffer->CreateView(ViewDesc, &pDrawArgsUAV);
+    }
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pCS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.Desc.Name = "Instance culling CS";
+        ShaderCI.FilePath = "instance_cull.csh";
+        CreateShaderWithCache(ShaderCI, &pCS);
+    }
+
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Instance culling PSO";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+    ShaderResourceVariableDesc Vars[] =
+    {
+        {SHADER_TYPE_COMPUTE, "CullConstants", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+    PSOCreateInfo.pCS = pCS;
+    CreateComputePSOWithCache(PSOCreateInfo, &m_pCullPSO);
+
+    if (m_pCullPSO && pInstanceSRV && pVisibleUAV && pDrawArgsUAV)
+    {
+        m_pCullPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_InstanceData")->Set(pInstanceSRV);
+        m_pCullPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_VisibleInstances")->Set(pVisibleUAV);
+        m_pCullPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_DrawArgs")->Set(pDrawArgsUAV);
+        m_pCullPSO->CreateShaderResourceBinding(&m_CullSRB, true);
+        m_CullSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "CullConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(CullConstants));
+    }
+    else
+    {
+        m_pCullPSO.Release();
+    }
+}
+
+void Tutorial04_Instancing::CullInstancesOnGPU()
+{
+    // Reiniciar el contador de instancias de cada vista; el resto de argumentos no cambia
+    Uint32 DrawArgs[5 * NumViews] = {};
+    for (Uint32 View = 0; View < NumViews; ++View)
+        DrawArgs[View * 5] = 36; // NumIndices del cubo
+    m_pImmediateContext->UpdateBuffer(m_DrawArgsBuffer, 0, sizeof(DrawArgs), DrawArgs, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // Las matrices de las vistas se escriben en WriteFrameConstants()
+    m_CullSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "CullConstants")->SetBufferOffset(m_FrameCBOffsets.Cull);
+    m_pImmediateContext->SetPipelineState(m_pCullPSO);
+    m_pImmediateContext->CommitShaderResources(m_CullSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    DispatchComputeAttribs DispatchAttrs;
+    DispatchAttrs.ThreadGroupCountX = (m_NumInstances + 63) / 64;
+    m_pImmediateContext->DispatchCompute(DispatchAttrs);
+}
+
+void Tutorial04_Instancing::Update(double CurrTime, double ElapsedTime)
+{
+    CPU_PROFILE_ZONE("Update");
+
+    SampleBase::Update(CurrTime, ElapsedTime);
+
+    // Los recursos creados en el pool se terminan de preparar en este hilo
+    if (!m_SceneReady && m_InitGraph.IsFinished())
+        FinishAsyncInit();
+    if (!m_MaterialTexturesReady && m_TextureGraph.IsFinished())
+        FinishMaterialTextures();
+    
+    // Constantes del pixel shader para la mezcla de texturas y propiedades de iluminación.
+    // Se copian al buffer de constantes del frame en WriteFrameConstants()
+    {
+        CubePSConstants& PSConstants = m_PSConstantsData;
+        PSConstants.BlendFactor  = blendFactor;
+        PSConstants.LightColor   = lightColor;
+        PSConstants.AmbientColor = ambientColor;
+        
+        // Propiedades especulares
+        PSConstants.SpecularPower     = specularPower;
+        PSConstants.SpecularIntensity = specularIntensity;
+    }
+    
+    // Sin ventana no hay interfaz y las cámaras se quedan en su posición inicial
+    if (IsOffscreen())
+        UpdateCameraMatrices();
+    else
+        UpdateUI();
+
+    // La luz que edita la interfaz es la misma que proyecta las sombras. Su matriz se ajusta en
+    // Render(), cuando ya se conocen las instancias del frame (UpdateLight()).
+    if (length(lightDir) > 1e-3f)
+        m_LightDirection = normalize(lightDir);
+
+    // Se usa ViewWindow1 como matriz de vista predeterminada
+    m_ViewProjMatrix = ViewWindow1 * GetProjectionMatrix();
+
+    // Global rotation matrix. El tiempo de la escena es el de la simulación a paso fijo y se
+    // detiene con la animación, de modo que el mapa de sombras deja de actualizarse
+    UpdateSimulation(m_AnimateScene ? ElapsedTime : 0.0);
+    m_RotationMatrix = float4x4::RotationY(static_cast<float>(m_SceneTime) * 0.1f) *
+                            float4x4::RotationX(-static_cast<float>(m_SceneTime) * 0.05f);
+}
+
+// Radio horizontal y altura mínima y máxima de un móvil respecto a su centro. La rotación global
+// gira cada cubo sobre sí mismo antes de escalarlo, así que una pieza se extiende hasta
+// sqrt(3) * Scale en cada eje alrededor de su centro. Los pivotes giran alrededor de Y, así que
+// en horizontal la esquina de esa caja puede apuntar en cualquier dirección.
+static void GetMobileBounds(float& Radius, float& MinY, float& MaxY)
+{
+    Radius = 0;
+    MinY   = +FLT_MAX;
+    MaxY   = -FLT_MAX;
+    for (const MobilePart& Part : MobileParts)
+    {
+        const float3 Extent = Part.Scale * 1.7320508f;
+        Radius              = std::max(Radius, length(float2{Part.Offset.x, Part.Offset.z}) + length(float2{Extent.x, Extent.z}));
+        MinY                = std::min(MinY, Part.Offset.y - Extent.y);
+        MaxY                = std::max(MaxY, Part.Offset.y + Extent.y);
+    }
+}
+
+// Cotas en espacio de mundo de las instancias que proyectan sombra. Con culling en CPU son las
+// de la raíz de la BVH, ya reajustada con las instancias de este frame; en otro caso, las del
+// móvil animado en cualquier posición. Se redondean hacia fuera a una rejilla de media unidad para que los pequeños
+// movimientos de la animación no cambien la proyección de la luz.
+BoundBox Tutorial04_Instancing::GetShadowCasterBounds() const
+{
+    BoundBox Bounds;
+    if (UseCPUCullingPath() && m_InstanceBVH.GetNumNodes() > 0)
+    {
+        Bounds = m_InstanceBVH.GetBounds();
+    }
+    else
+    {
+        float MobileRadius = 0, MobileMinY = 0, MobileMaxY = 0;
+        GetMobileBounds(MobileRadius, MobileMinY, MobileMaxY);
+        const float HalfExtent = 0.5f * static_cast<float>(GetGPUGridSize() - 1) * MobileGrid::MobileSpacing + MobileRadius;
+        Bounds.Min             = float3{-HalfExtent, MobileMinY, -HalfExtent};
+        Bounds.Max             = float3{+HalfExtent, MobileMaxY, +HalfExtent};
+    }
+
+    constexpr float Step = 0.5f;
+    for (int i = 0; i < 3; ++i)
+    {
+        Bounds.Min[i] = std::floor(Bounds.Min[i] / Step) * Step;
+        Bounds.Max[i] = std::ceil(Bounds.Max[i] / Step) * Step;
+    }
+    return Bounds;
+}
+
+// Ajusta la matriz de la luz a las instancias de este frame y la copia a las constantes
+void Tutorial04_Instancing::UpdateLight()
+{
+    CalculateLightViewProj();
+
+    // Las matrices de la luz se construyen para vectores fila; el shader aplica la traspuesta
+    CubePSConstants& PSConstants = m_PSConstantsData;
+    PSConstants.LightDir         = float4(m_LightDirection, 0.0f);
+    PSConstants.LightViewProj    = m_LightViewProjMatrix.Transpose();
+    PSConstants.ShadowParams     = float4{1.0f / static_cast<float>(ShadowMapSize), 0.001f, static_cast<float>(GetShadowMode()), 1e-5f};
+}
+
+void Tutorial04_Instancing::CalculateLightViewProj()
+{
+    CPU_PROFILE_ZONE("CalculateLightViewProj");
+
+    const BoundBox Bounds = GetShadowCasterBounds();
+    if (m_LightFitValid && m_LightFitDirection == m_LightDirection &&
+        m_LightFitBounds.Min == Bounds.Min && m_LightFitBounds.Max == Bounds.Max)
+        return;
+
+    // Base ortonormal de la luz: el eje Z apunta en la dirección en la que viaja la luz
+    const float3   LightDir  = m_LightDirection;
+    const float3   RefUp     = std::abs(LightDir.y) < 0.99f ? float3{0, 1, 0} : float3{0, 0, 1};
+    const float3   Right     = normalize(cross(RefUp, LightDir));
+    const float3   Up        = cross(LightDir, Right);
+    const float4x4 LightView = float4x4::ViewFromBasis(Right, Up, LightDir);
+
+    // Las esquinas de la caja de las instancias en el espacio de la luz dan el rectángulo de la
+    // proyección: las sombras sobre el suelo caen dentro de él, porque proyectar sobre el suelo a
+    // lo largo de la luz no cambia X e Y. En Z se extiende hasta donde esas esquinas tocan el
+    // suelo (y = -5), que es el receptor más lejano.
+    constexpr float FloorY = -5.0f;
+    float3          Min{+FLT_MAX, +FLT_MAX, +FLT_MAX};
+    float3          Max{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (Uint32 i = 0; i < 8; ++i)
+    {
+        const float3 Corner{
+            (i & 1) ? Bounds.Max.x : Bounds.Min.x,
+            (i & 2) ? Bounds.Max.y : Bounds.Min.y,
+            (i & 4) ? Bounds.Max.z : Bounds.Min.z,
+        };
+        const float4 LightSpace = float4{Corner, 1.0f} * LightView;
+        Min                     = (min)(Min, float3{LightSpace.x, LightSpace.y, LightSpace.z});
+        Max                     = (max)(Max, float3{LightSpace.x, LightSpace.y, LightSpace.z});
+
+        // Distancia a lo largo de la luz hasta el suelo; la luz rasante o desde abajo no lo alcanza
+        if (LightDir.y < -1e-3f)
+            Max.z = std::max(Max.z, LightSpace.z + (FloorY - Corner.y) / LightDir.y);
+    }
+
+    // Proyección cuadrada con el origen alineado a texels enteros del espacio de la luz: mientras
+    // no cambie el tamaño de la caja, un desplazamiento de las cotas mueve la proyección un
+    // número entero de texels y los bordes de las sombras no parpadean
+    const float Extent    = std::max(std::max(Max.x - Min.x, Max.y - Min.y), 1.0f);
+    const float TexelSize = Extent / static_cast<float>(ShadowMapSize - 1);
+    const float Left      = std::floor(Min.x / TexelSize) * TexelSize;
+    const float Bottom    = std::floor(Min.y / TexelSize) * TexelSize;
+    const float Size      = TexelSize * static_cast<float>(ShadowMapSize);
+
+    const bool IsGL = m_pDevice->GetDeviceInfo().IsGLDevice();
+    m_LightViewProjMatrix = LightView * float4x4::OrthoOffCenter(Left, Left + Size, Bottom, Bottom + Size, Min.z, Max.z, IsGL);
+
+    m_LightFitDirection = m_LightDirection;
+    m_LightFitBounds    = Bounds;
+    m_LightFitValid     = true;
+    ++m_LightFitUpdates;
+}
+
+void Tutorial04_Instancing::CreateShadowMap()
+{
+    // Mapa de sombras que leen los pixel shaders y capa estática con la que se inicializa en
+    // cada actualización, para no volver a rasterizar el suelo
+    TextureDesc ShadowMapDesc;
+    ShadowMapDesc.Name = "Shadow map";
+    ShadowMapDesc.Type = RESOURCE_DIM_TEX_2D;
+    ShadowMapDesc.Width = ShadowMapSize;
+    ShadowMapDesc.Height = ShadowMapSize;
+    ShadowMapDesc.Format = TEX_FORMAT_D32_FLOAT;
+    ShadowMapDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_DEPTH_STENCIL;
+    ShadowMapDesc.MipLevels = 1;
+
+    m_pDevice->CreateTexture(ShadowMapDesc, nullptr, &m_ShadowMap);
+    m_ShadowMapDSV = m_ShadowMap->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+    m_ShadowMapSRV = m_ShadowMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+    ShadowMapDesc.Name = "Static shadow map";
+    ShadowMapDesc.BindFlags = BIND_DEPTH_STENCIL;
+    m_pDevice->CreateTexture(ShadowMapDesc, nullptr, &m_StaticShadowMap);
+    m_StaticShadowMapDSV = m_StaticShadowMap->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+
+    // Momentos del VSM con todos sus mips y el resultado intermedio del filtro separable. Los
+    // escriben los compute shaders, se leen con filtrado trilineal y los mips se generan como
+    // render target, así que sin todo ello solo queda el PCF. Los PSO declaran la textura
+    // aunque no se use, y entonces basta con una de un solo mip.
+    const TextureFormatInfoExt& MomentsFmtInfo = m_pDevice->GetTextureFormatInfoExt(TEX_FORMAT_RG32_FLOAT);
+    constexpr BIND_FLAGS        VSMBindFlags   = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET | BIND_UNORDERED_ACCESS;
+
+    const bool HasVSM = m_pDevice->GetDeviceInfo().Features.ComputeShaders &&
+        MomentsFmtInfo.Filterable && (MomentsFmtInfo.BindFlags & VSMBindFlags) == VSMBindFlags;
+
+    TextureDesc MomentsDesc;
+    MomentsDesc.Name      = "Shadow moments";
+    MomentsDesc.Type      = RESOURCE_DIM_TEX_2D;
+    MomentsDesc.Width     = ShadowMapSize;
+    MomentsDesc.Height    = ShadowMapSize;
+    MomentsDesc.Format    = TEX_FORMAT_RG32_FLOAT;
+    MomentsDesc.MipLevels = HasVSM ? 0 : 1; // Cadena completa
+    MomentsDesc.BindFlags = HasVSM ? VSMBindFlags : BIND_SHADER_RESOURCE;
+    MomentsDesc.MiscFlags = HasVSM ? MISC_TEXTURE_FLAG_GENERATE_MIPS : MISC_TEXTURE_FLAG_NONE;
+    m_pDevice->CreateTexture(MomentsDesc, nullptr, &m_ShadowMoments);
+    m_ShadowMomentsSRV = m_ShadowMoments->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+    m_ShadowMomentsTemp.Release();
+    if (HasVSM)
+    {
+        MomentsDesc.Name      = "Shadow moments (horizontal blur)";
+        MomentsDesc.MipLevels = 1;
+        MomentsDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+        MomentsDesc.MiscFlags = MISC_TEXTURE_FLAG_NONE;
+        m_pDevice->CreateTexture(MomentsDesc, nullptr, &m_ShadowMomentsTemp);
+    }
+
+    // Hasta la primera actualización el mapa no tiene sombras. Los contextos diferidos no hacen
+    // transiciones, así que los mapas se dejan desde el principio en el estado en el que se leen.
+    m_pImmediateContext->ClearDepthStencil(m_ShadowMapDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    StateTransitionDesc Barriers[] =
+    {
+        {m_ShadowMap, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {m_ShadowMoments, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE}
+    };
+    m_pImmediateContext->TransitionResourceStates(_countof(Barriers), Barriers);
+
+    m_ShadowMapValid    = false;
+    m_StaticShadowValid = false;
+}
+
+void Tutorial04_Instancing::CreateShadowMapPSO()
+{
+    // Liberar referencias existentes para evitar fugas de memoria
+    for (auto& pPSO : m_ShadowMapPSOs)
+        pPSO.Release();
+    m_ShadowMapSRB.Release();
+    m_pShadowFloorPSO.Release();
+    m_ShadowFloorSRB.Release();
+    
+    // PSO de solo profundidad para renderizar los objetos al mapa de sombras
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PipelineStateDesc&              PSODesc = PSOCreateInfo.PSODesc;
+
+    PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    // Configurar el render target y depth buffer
+    GraphicsPipelineDesc& GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
+    GraphicsPipeline.NumRenderTargets = 0; // No render target, solo depth buffer
+    GraphicsPipeline.DSVFormat = TEX_FORMAT_D32_FLOAT;
+    GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_BACK;
+    GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
+    GraphicsPipeline.DepthStencilDesc.DepthWriteEnable = True;
+
+    // Sesgo proporcional a la pendiente para evitar el acné en las caras oblicuas a la luz;
+    // el shader solo aplica un sesgo constante pequeño
+    GraphicsPipeline.RasterizerDesc.DepthBias = 16;
+    GraphicsPipeline.RasterizerDesc.SlopeScaledDepthBias = 2.0f;
+    
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    // Para OpenGL y otros backends, necesitamos un pixel shader, aunque sea vacío
+    RefCntAutoPtr<IShader> pPS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.Desc.Name = "Shadow PS";
+        ShaderCI.FilePath = "shadowmap.psh";
+        CreateShaderWithCache(ShaderCI, &pPS);
+    }
+    PSOCreateInfo.pPS = pPS;
+
+    // Las constantes se enlazan con offsets en el buffer de constantes del frame
+    PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+    // Un PSO por formato de instancia, con el mismo layout de entrada que el cubo instanciado
+    static const char* const PSONames[] = {"Shadow map PSO", "Shadow map PSO (affine instances)", "Shadow map PSO (quaternion instances)"};
+    static_assert(_countof(PSONames) == INSTANCE_FORMAT_COUNT, "Falta el nombre de algún formato");
+    for (Uint8 Format = 0; Format < INSTANCE_FORMAT_COUNT; ++Format)
+    {
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("INSTANCE_FORMAT", static_cast<int>(Format));
+
+        // Crear vertex shader
+        RefCntAutoPtr<IShader> pVS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+            ShaderCI.EntryPoint = "main";
+            ShaderCI.Desc.Name = "Shadow VS";
+            ShaderCI.FilePath = "shadowmap.vsh";
+            ShaderCI.Macros = Macros;
+            CreateShaderWithCache(ShaderCI, &pVS);
+        }
+        PSOCreateInfo.pVS = pVS;
+
+        LayoutElement LayoutElems[7];
+        GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
+        GraphicsPipeline.InputLayout.NumElements = GetCubeLayoutElements(static_cast<INSTANCE_FORMAT>(Format), 1, LayoutElems);
+
+        PSODesc.Name = PSONames[Format];
+        CreateGraphicsPSOWithCache(PSOCreateInfo, &m_ShadowMapPSOs[Format]);
+    }
+
+    // Todos los formatos usan los mismos recursos: el SRB sirve para todos
+    if (m_ShadowMapPSOs[INSTANCE_FORMAT_FULL])
+    {
+        m_ShadowMapPSOs[INSTANCE_FORMAT_FULL]->CreateShaderResourceBinding(&m_ShadowMapSRB, true);
+        m_ShadowMapSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(ShadowVSConstants));
+    }
+
+    // Suelo para la capa estática: el vertex shader del suelo con la vista-proyección de la luz
+    {
+        ShaderCI.Macros = {};
+        RefCntAutoPtr<IShader> pVS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+            ShaderCI.EntryPoint = "main";
+            ShaderCI.Desc.Name = "Shadow floor VS";
+            ShaderCI.FilePath = "floor.vsh";
+            CreateShaderWithCache(ShaderCI, &pVS);
+        }
+        PSOCreateInfo.pVS = pVS;
+
+        LayoutElement FloorLayoutElems[] =
+        {
+            LayoutElement{0, 0, 3, VT_FLOAT32, False}, // Posición
+            LayoutElement{1, 0, 2, VT_FLOAT32, False}  // Coordenadas de textura
+        };
+        GraphicsPipeline.InputLayout.LayoutElements = FloorLayoutElems;
+        GraphicsPipeline.InputLayout.NumElements = _countof(FloorLayoutElems);
+
+        PSODesc.Name = "Shadow map floor PSO";
+        CreateGraphicsPSOWithCache(PSOCreateInfo, &m_pShadowFloorPSO);
+    }
+
+    if (m_pShadowFloorPSO)
+    {
+        m_pShadowFloorPSO->CreateShaderResourceBinding(&m_ShadowFloorSRB, true);
+        m_ShadowFloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(FloorVSConstants));
+    }
+}
+
+void Tutorial04_Instancing::CreateVSMResources()
+{
+    for (Uint32 Pass = 0; Pass < 2; ++Pass)
+    {
+        m_pVSMBlurPSOs[Pass].Release();
+        m_VSMBlurSRBs[Pass].Release();
+    }
+    if (!m_ShadowMomentsTemp)
+    {
+        m_ShadowFilter = SHADOW_MODE_PCF;
+        return;
+    }
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    // Pasada 0: profundidad -> momentos filtrados en horizontal; pasada 1: filtro vertical
+    ITextureView* pInputs[]  = {m_ShadowMapSRV, m_ShadowMomentsTemp->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)};
+    ITextureView* pOutputs[] = {m_ShadowMomentsTemp->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), m_ShadowMoments->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS)};
+    static const char* const PSONames[] = {"VSM horizontal blur PSO", "VSM vertical blur PSO"};
+    for (Uint32 Pass = 0; Pass < 2; ++Pass)
+    {
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("VSM_BLUR_PASS", static_cast<int>(Pass));
+
+        RefCntAutoPtr<IShader> pCS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+            ShaderCI.EntryPoint = "main";
+            ShaderCI.Desc.Name = "VSM blur CS";
+            ShaderCI.FilePath = "vsm_blur.csh";
+            ShaderCI.Macros = Macros;
+            CreateShaderWithCache(ShaderCI, &pCS);
+        }
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name = PSONames[Pass];
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+        ShaderResourceVariableDesc Vars[] =
+        {
+            {SHADER_TYPE_COMPUTE, "VSMBlurConstants", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+        };
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+        PSOCreateInfo.pCS = pCS;
+        CreateComputePSOWithCache(PSOCreateInfo, &m_pVSMBlurPSOs[Pass]);
+        if (!m_pVSMBlurPSOs[Pass])
+            continue;
+
+        m_pVSMBlurPSOs[Pass]->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_Input")->Set(pInputs[Pass]);
+        m_pVSMBlurPSOs[Pass]->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_Output")->Set(pOutputs[Pass]);
+        m_pVSMBlurPSOs[Pass]->CreateShaderResourceBinding(&m_VSMBlurSRBs[Pass], true);
+        m_VSMBlurSRBs[Pass]->GetVariableByName(SHADER_TYPE_COMPUTE, "VSMBlurConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(VSMBlurConstants));
+    }
+
+    if (!m_VSMBlurSRBs[0] || !m_VSMBlurSRBs[1])
+    {
+        for (Uint32 Pass = 0; Pass < 2; ++Pass)
+        {
+            m_pVSMBlurPSOs[Pass].Release();
+            m_VSMBlurSRBs[Pass].Release();
+        }
+        m_ShadowFilter = SHADOW_MODE_PCF;
+    }
+}
+
+// Convierte el mapa de sombras recién renderizado en momentos filtrados con dos pasadas de
+// compute y genera sus mips. El coste del filtro se paga una vez por actualización del mapa.
+void Tutorial04_Instancing::FilterShadowMoments()
+{
+    IDeviceContext* pCtx = m_pImmediateContext;
+
+    DispatchComputeAttribs DispatchAttrs;
+    DispatchAttrs.ThreadGroupCountX = (ShadowMapSize + 7) / 8;
+    DispatchAttrs.ThreadGroupCountY = (ShadowMapSize + 7) / 8;
+    for (Uint32 Pass = 0; Pass < 2; ++Pass)
+    {
+        m_VSMBlurSRBs[Pass]->GetVariableByName(SHADER_TYPE_COMPUTE, "VSMBlurConstants")->SetBufferOffset(m_FrameCBOffsets.VSMBlur);
+        pCtx->SetPipelineState(m_pVSMBlurPSOs[Pass]);
+        pCtx->CommitShaderResources(m_VSMBlurSRBs[Pass], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->DispatchCompute(DispatchAttrs);
+    }
+
+    pCtx->GenerateMips(m_ShadowMomentsSRV);
+
+    StateTransitionDesc Barrier{m_ShadowMoments, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
+// Decide si el mapa de sombras debe volver a renderizarse este frame. Se llama después de ajustar
+// la luz y antes de subir las instancias, que con culling en CPU añaden entonces el segmento de
+// la luz.
+void Tutorial04_Instancing::UpdateShadowCasterState()
+{
+    ShadowCasterState State;
+    State.LightViewProj = m_LightViewProjMatrix;
+    State.Rotation      = m_RotationMatrix;
+    State.Anim          = m_MobileAnim;
+    State.GridSize      = GetGPUGridSize();
+
+    m_ShadowUpdatePending = m_ShadowsEnabled && m_ShadowMapSRB && m_pShadowFloorPSO &&
+        (!m_ShadowMapValid || !(State == m_ShadowCasters));
+    if (!m_ShadowUpdatePending)
+        return;
+
+    // La capa estática solo depende de la luz
+    if (!(m_StaticShadowLightViewProj == m_LightViewProjMatrix))
+        m_StaticShadowValid = false;
+    m_ShadowCasters = State;
+}
+
+// Media móvil exponencial de un tiempo en ms; el primer valor la inicializa
+static void AccumulateTiming(float& AvgMs, float ValueMs)
+{
+    AvgMs = AvgMs > 0 ? AvgMs * 0.95f + ValueMs * 0.05f : ValueMs;
+}
+
+// Las consultas de duración dan su resultado varios frames después y en el orden en que se
+// empezaron: cada medida guarda el modo de sombra con el que empezó para atribuirle el tiempo,
+// aunque el modo haya cambiado mientras tanto
+void Tutorial04_Instancing::BeginTimedPass(DurationQueryHelper& Query, std::deque<SHADOW_MODE>& Modes, IDeviceContext* pCtx)
+{
+    Query.Begin(pCtx);
+    Modes.push_back(GetShadowMode());
+}
+
+bool Tutorial04_Instancing::EndTimedPass(DurationQueryHelper& Query, std::deque<SHADOW_MODE>& Modes, IDeviceContext* pCtx, double& Duration, SHADOW_MODE& Mode)
+{
+    if (!Query.End(pCtx, Duration) || Modes.empty())
+        return false;
+
+    Mode = Modes.front();
+    Modes.pop_front();
+    return true;
+}
+
+// Renderiza el mapa de sombras una vez para las tres vistas en el contexto inmediato: copia la
+// capa estática y dibuja encima las instancias del móvil con el buffer de instancias del frame.
+// Con grabación en paralelo, RecordViewsInParallel() graba las instancias en un contexto
+// diferido entre BeginShadowMapUpdate() y EndShadowMapUpdate().
+void Tutorial04_Instancing::RenderShadowMap()
+{
+    CPU_PROFILE_ZONE("RenderShadowMap");
+
+    BeginShadowMapUpdate();
+    m_ShadowMapSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(m_FrameCBOffsets.ShadowVS);
+    RecordShadowCasters(m_pImmediateContext, m_ShadowMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    EndShadowMapUpdate();
+}
+
+// Actualiza la capa estática si hace falta y la copia al mapa dinámico (contexto inmediato)
+void Tutorial04_Instancing::BeginShadowMapUpdate()
+{
+    IDeviceContext* pCtx = m_pImmediateContext;
+    if (m_ShadowUpdateQuery)
+        BeginTimedPass(*m_ShadowUpdateQuery, m_ShadowUpdateQueryModes, pCtx);
+
+    if (!m_StaticShadowValid)
+    {
+        pCtx->SetRenderTargets(0, nullptr, m_StaticShadowMapDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->SetViewports(1, nullptr, 0, 0);
+        pCtx->ClearDepthStencil(m_StaticShadowMapDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        m_ShadowFloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(m_FrameCBOffsets.ShadowFloorVS);
+        const Uint64 offsets[] = {0};
+        IBuffer*     pBuffs[]  = {m_FloorVertexBuffer};
+        pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+        pCtx->SetIndexBuffer(m_FloorIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->SetPipelineState(m_pShadowFloorPSO);
+        pCtx->CommitShaderResources(m_ShadowFloorSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DrawIndexedAttribs DrawAttrs;
+        DrawAttrs.IndexType  = VT_UINT32;
+        DrawAttrs.NumIndices = 6;
+        DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
+        pCtx->DrawIndexed(DrawAttrs);
+
+        m_StaticShadowLightViewProj = m_LightViewProjMatrix;
+        m_StaticShadowValid         = true;
+        ++m_StaticShadowUpdates;
+    }
+
+    // La copia sustituye al clear del mapa dinámico
+    CopyTextureAttribs CopyAttribs{m_StaticShadowMap, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, m_ShadowMap, RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+    pCtx->CopyTexture(CopyAttribs);
+}
+
+// Dibuja las instancias que proyectan sombra sobre el mapa dinámico. Las constantes de la luz
+// ya están enlazadas en pSRB.
+void Tutorial04_Instancing::RecordShadowCasters(IDeviceContext* pCtx, IShaderResourceBinding* pSRB, RESOURCE_STATE_TRANSITION_MODE TransitionMode)
+{
+    pCtx->SetRenderTargets(0, nullptr, m_ShadowMapDSV, TransitionMode);
+    pCtx->SetViewports(1, nullptr, 0, 0);
+
+    // Instancias que proyectan sombra: con culling en CPU, el segmento de la luz del buffer
+    // compacto; en otro caso, el buffer de instancias completo del frame (con culling en GPU,
+    // el que escribe el compute shader de animación, no las listas visibles de cada vista)
+    IBuffer*              pInstanceBuffer = m_pCurrInstanceBuffer;
+    const INSTANCE_FORMAT Format          = m_CurrInstanceFormat;
+    Uint32                FirstInstance   = 0;
+    Uint32                NumInstances    = m_NumInstances;
+    if (m_CulledInstanceBuffer && m_pCurrInstanceBuffer == m_CulledInstanceBuffer)
+    {
+        FirstInstance = m_ShadowFirstInstance;
+        NumInstances  = m_ShadowNumInstances;
+    }
+
+    if (pInstanceBuffer != nullptr && NumInstances > 0 && m_ShadowMapPSOs[Format])
+    {
+        const Uint64 offsets[] = {0, Uint64{GetInstanceStride(Format)} * FirstInstance};
+        IBuffer*     pBuffs[]  = {m_CubeVertexBuffer, pInstanceBuffer};
+        pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, TransitionMode, SET_VERTEX_BUFFERS_FLAG_RESET);
+        pCtx->SetIndexBuffer(m_CubeIndexBuffer, 0, TransitionMode);
+        pCtx->SetPipelineState(m_ShadowMapPSOs[Format]);
+        pCtx->CommitShaderResources(pSRB, TransitionMode);
+
+        DrawIndexedAttribs DrawAttrs;
+        DrawAttrs.IndexType    = VT_UINT32;
+        DrawAttrs.NumIndices   = 36;
+        DrawAttrs.NumInstances = NumInstances;
+        DrawAttrs.Flags        = DRAW_FLAG_VERIFY_ALL;
+        pCtx->DrawIndexed(DrawAttrs);
+    }
+}
+
+// Deja el mapa listo para las vistas y filtra los momentos de VSM (contexto inmediato)
+void Tutorial04_Instancing::EndShadowMapUpdate()
+{
+    IDeviceContext* pCtx = m_pImmediateContext;
+
+    // Las pasadas de las vistas pueden grabarse en contextos diferidos, que no hacen transiciones:
+    // la transición desde DEPTH_WRITE se hace aquí, en el contexto inmediato
+    StateTransitionDesc Barrier{m_ShadowMap, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+
+    if (GetShadowMode() == SHADOW_MODE_VSM)
+        FilterShadowMoments();
+
+    double      Duration = 0;
+    SHADOW_MODE Mode     = SHADOW_MODE_NONE;
+    if (m_ShadowUpdateQuery && EndTimedPass(*m_ShadowUpdateQuery, m_ShadowUpdateQueryModes, pCtx, Duration, Mode))
+        AccumulateTiming(m_ShadowUpdateTimeMs[Mode], static_cast<float>(Duration * 1000.0));
+
+    m_ShadowMapValid = true;
+    ++m_ShadowMapUpdates;
+}
+
+void Tutorial04_Instancing::CreateFloor()
+{
+    // Crear los vértices del suelo (un plano XZ grande)
+    struct FloorVertex
+    {
+        float3 Pos;
+        float2 UV;
+    };
 
     // Definir los vértices del suelo
     FloorVertex FloorVertices[] = {
@@ -948,29 +2738,291 @@ void Tutorial04_Instancing::CreateFloorTexture()
             Data[y * TexWidth + x] = color;
         }
     }
-    
-    // Crear descriptor de textura
-    TextureDesc TexDesc;
-    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
-    TexDesc.Width     = TexWidth;
-    TexDesc.Height    = TexHeight;
-    TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
-    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
-    TexDesc.Name      = "Floor texture";
-    
-    // Datos de la textura
-    TextureSubResData Level0Data;
-    Level0Data.pData  = Data.data();
-    Level0Data.Stride = TexWidth * 4;
-    
-    TextureData TexData;
-    TexData.NumSubresources = 1;
-    TexData.pSubResources   = &Level0Data;
-    
-    // Crear la textura
-    RefCntAutoPtr<ITexture> pFloorTexture;
-    m_pDevice->CreateTexture(TexDesc, &TexData, &pFloorTexture);
-    m_FloorTextureSRV = pFloorTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    
+    // Crear descriptor de textura
+    TextureDesc TexDesc;
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = TexWidth;
+    TexDesc.Height    = TexHeight;
+    TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+    TexDesc.Name      = "Floor texture";
+    
+    // Datos de la textura
+    TextureSubResData Level0Data;
+    Level0Data.pData  = Data.data();
+    Level0Data.Stride = TexWidth * 4;
+    
+    TextureData TexData;
+    TexData.NumSubresources = 1;
+    TexData.pSubResources   = &Level0Data;
+    
+    // Crear la textura
+    RefCntAutoPtr<ITexture> pFloorTexture;
+    m_pDevice->CreateTexture(TexDesc, &TexData, &pFloorTexture);
+    m_FloorTextureSRV = pFloorTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+}
+
+// Crea el Texture2DArray sRGB con mipmaps de las cuatro texturas del móvil. Mientras las texturas
+// se decodifican en el pool, la escena se dibuja con todas las capas en gris;
+// FillMaterialTextureArray() las rellena cuando terminan las tareas de m_TextureGraph.
+void Tutorial04_Instancing::CreateMaterialTextureArray()
+{
+    m_MaterialTexturesCompressed = LoadCompressedMaterialTextures();
+    if (m_MaterialTexturesCompressed)
+        return;
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Mobile material texture array";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D_ARRAY;
+    TexDesc.Width     = MaterialLayerSize;
+    TexDesc.Height    = MaterialLayerSize;
+    TexDesc.ArraySize = NumMaterialTextures;
+    TexDesc.MipLevels = 0; // Cadena de mips completa
+    TexDesc.Format    = MaterialTextureFormat;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+    TexDesc.MiscFlags = MISC_TEXTURE_FLAG_GENERATE_MIPS;
+
+    RefCntAutoPtr<ITexture> pTexArray;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &pTexArray);
+    if (!pTexArray)
+        return;
+
+    TextureViewDesc RTVDesc;
+    RTVDesc.ViewType        = TEXTURE_VIEW_RENDER_TARGET;
+    RTVDesc.TextureDim      = RESOURCE_DIM_TEX_2D_ARRAY;
+    RTVDesc.MostDetailedMip = 0;
+    RTVDesc.NumMipLevels    = 1;
+    RTVDesc.FirstArraySlice = 0;
+    RTVDesc.NumArraySlices  = NumMaterialTextures;
+    RefCntAutoPtr<ITextureView> pArrayRTV;
+    pTexArray->CreateView(RTVDesc, &pArrayRTV);
+
+    const float Grey[] = {0.5f, 0.5f, 0.5f, 1.0f};
+    m_pImmediateContext->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
+    m_pImmediateContext->ClearRenderTarget(pArrayRTV, Grey, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    m_MaterialTexturesSRV = pTexArray->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_pImmediateContext->GenerateMips(m_MaterialTexturesSRV);
+
+    StateTransitionDesc Barrier{pTexArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+}
+
+// Carga el array de materiales ya comprimido. Sin el fichero, o si el dispositivo no admite
+// texturas BC, se usan las imágenes originales.
+bool Tutorial04_Instancing::LoadCompressedMaterialTextures()
+{
+    if (!m_pDevice->GetDeviceInfo().Features.TextureCompressionBC)
+        return false;
+
+    // CreateTextureFromFile() informa de un error si el fichero no existe, y no lo es
+    std::FILE* pFile = std::fopen(CompressedMaterialTexturesFile, "rb");
+    if (pFile == nullptr)
+        return false;
+    std::fclose(pFile);
+
+    TextureLoadInfo LoadInfo;
+    LoadInfo.Name = "Mobile material texture array (BC)";
+    RefCntAutoPtr<ITexture> pTexArray;
+    CreateTextureFromFile(CompressedMaterialTexturesFile, LoadInfo, m_pDevice, &pTexArray);
+    if (!pTexArray)
+        return false;
+
+    const TextureDesc& Desc = pTexArray->GetDesc();
+    if (Desc.Type != RESOURCE_DIM_TEX_2D_ARRAY || Desc.ArraySize != NumMaterialTextures || !IsSRGBFormat(Desc.Format))
+    {
+        LOG_WARNING_MESSAGE("'", CompressedMaterialTexturesFile, "' no es un array sRGB de ", NumMaterialTextures, " capas; se usan las texturas originales");
+        return false;
+    }
+
+    m_MaterialTexturesSRV = pTexArray->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+    StateTransitionDesc Barrier{pTexArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+    return true;
+}
+
+// PSO que dibuja una textura escalada en una capa del array de materiales con un triángulo a
+// pantalla completa. Las texturas de origen tienen tamaños distintos, así que no se pueden copiar.
+void Tutorial04_Instancing::CreateTextureBlitPSO()
+{
+    m_pTextureBlitPSO.Release();
+    m_TextureBlitSRB.Release();
+
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Texture blit PSO";
+
+    GraphicsPipelineDesc& GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
+
+    GraphicsPipeline.NumRenderTargets             = 1;
+    GraphicsPipeline.RTVFormats[0]                = MaterialTextureFormat;
+    GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
+    GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    ShaderCI.EntryPoint                      = "main";
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pVS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+        ShaderCI.Desc.Name       = "Texture blit VS";
+        ShaderCI.FilePath        = "texture_blit.vsh";
+        CreateShaderWithCache(ShaderCI, &pVS);
+    }
+    RefCntAutoPtr<IShader> pPS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+        ShaderCI.Desc.Name       = "Texture blit PS";
+        ShaderCI.FilePath        = "texture_blit.psh";
+        CreateShaderWithCache(ShaderCI, &pPS);
+    }
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+
+    // La textura de origen cambia entre dibujados, así que la variable es dinámica
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+    SamplerDesc SamLinearClampDesc;
+    SamLinearClampDesc.MinFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MagFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.MipFilter = FILTER_TYPE_LINEAR;
+    SamLinearClampDesc.AddressU  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressV  = TEXTURE_ADDRESS_CLAMP;
+    SamLinearClampDesc.AddressW  = TEXTURE_ADDRESS_CLAMP;
+
+    ImmutableSamplerDesc ImtblSamplers[] =
+    {
+        {SHADER_TYPE_PIXEL, "g_Source", SamLinearClampDesc}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+    CreateGraphicsPSOWithCache(PSOCreateInfo, &m_pTextureBlitPSO);
+    if (m_pTextureBlitPSO)
+        m_pTextureBlitPSO->CreateShaderResourceBinding(&m_TextureBlitSRB, true);
+}
+
+// PSO que copia la imagen guardada de una vista a su viewport del destino (renderizado bajo
+// demanda). Las vistas tienen el mismo tamaño que su viewport, así que se muestrea sin filtrar.
+void Tutorial04_Instancing::CreateViewCompositePSO()
+{
+    m_pViewCompositePSO.Release();
+    for (auto& pSRB : m_ViewCompositeSRBs)
+        pSRB.Release();
+
+    const SwapChainDesc& TargetDesc = GetTargetDesc();
+
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "View composite PSO";
+
+    GraphicsPipelineDesc& GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
+
+    GraphicsPipeline.NumRenderTargets             = 1;
+    GraphicsPipeline.RTVFormats[0]                = TargetDesc.ColorBufferFormat;
+    GraphicsPipeline.DSVFormat                    = TargetDesc.DepthBufferFormat;
+    GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
+    GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    ShaderCI.EntryPoint                      = "main";
+
+    ShaderMacroHelper Macros;
+    Macros.AddShaderMacro("FLIP_UV", m_pDevice->GetDeviceInfo().IsGLDevice());
+    ShaderCI.Macros = Macros;
+
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pVS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+        ShaderCI.Desc.Name       = "View composite VS";
+        ShaderCI.FilePath        = "texture_blit.vsh";
+        CreateShaderWithCache(ShaderCI, &pVS);
+    }
+    RefCntAutoPtr<IShader> pPS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+        ShaderCI.Desc.Name       = "View composite PS";
+        ShaderCI.FilePath        = "texture_blit.psh";
+        CreateShaderWithCache(ShaderCI, &pPS);
+    }
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+
+    // Un SRB por vista; la textura solo cambia cuando se recrea la vista
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+    SamplerDesc SamPointClampDesc;
+    SamPointClampDesc.MinFilter = FILTER_TYPE_POINT;
+    SamPointClampDesc.MagFilter = FILTER_TYPE_POINT;
+    SamPointClampDesc.MipFilter = FILTER_TYPE_POINT;
+    SamPointClampDesc.AddressU  = TEXTURE_ADDRESS_CLAMP;
+    SamPointClampDesc.AddressV  = TEXTURE_ADDRESS_CLAMP;
+    SamPointClampDesc.AddressW  = TEXTURE_ADDRESS_CLAMP;
+
+    ImmutableSamplerDesc ImtblSamplers[] =
+    {
+        {SHADER_TYPE_PIXEL, "g_Source", SamPointClampDesc}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+    CreateGraphicsPSOWithCache(PSOCreateInfo, &m_pViewCompositePSO);
+}
+
+// Copia al array de materiales las texturas decodificadas en el pool y regenera sus mips. Usa el
+// contexto inmediato, así que se llama desde el hilo principal en FinishMaterialTextures().
+void Tutorial04_Instancing::FillMaterialTextureArray()
+{
+    if (m_MaterialTexturesSRV && m_TextureBlitSRB)
+    {
+        ITexture*                pTexArray  = m_MaterialTexturesSRV->GetTexture();
+        IShaderResourceVariable* pSourceVar = m_TextureBlitSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Source");
+
+        m_pImmediateContext->SetPipelineState(m_pTextureBlitPSO);
+        for (Uint32 Layer = 0; Layer < NumMaterialTextures; ++Layer)
+        {
+            // Si la textura no se pudo cargar, la capa se queda en gris
+            if (!m_MaterialSources[Layer])
+                continue;
+
+            TextureViewDesc RTVDesc;
+            RTVDesc.ViewType        = TEXTURE_VIEW_RENDER_TARGET;
+            RTVDesc.TextureDim      = RESOURCE_DIM_TEX_2D_ARRAY;
+            RTVDesc.MostDetailedMip = 0;
+            RTVDesc.NumMipLevels    = 1;
+            RTVDesc.FirstArraySlice = Layer;
+            RTVDesc.NumArraySlices  = 1;
+            RefCntAutoPtr<ITextureView> pLayerRTV;
+            pTexArray->CreateView(RTVDesc, &pLayerRTV);
+
+            ITextureView* pRTVs[] = {pLayerRTV};
+            m_pImmediateContext->SetRenderTargets(1, pRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            pSourceVar->Set(m_MaterialSources[Layer]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+            m_pImmediateContext->CommitShaderResources(m_TextureBlitSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_pImmediateContext->Draw(DrawAttribs{3, DRAW_FLAG_VERIFY_ALL});
+        }
+        m_pImmediateContext->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
+        m_pImmediateContext->GenerateMips(m_MaterialTexturesSRV);
+
+        StateTransitionDesc Barrier{pTexArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+    }
+
+    // Las fuentes y el PSO de copia solo se necesitan una vez
+    for (RefCntAutoPtr<ITexture>& pSource : m_MaterialSources)
+        pSource.Release();
+    m_TextureBlitSRB.Release();
+    m_pTextureBlitPSO.Release();
 }
 
 void Tutorial04_Instancing::CreateFloorPSO()
@@ -987,8 +3039,8 @@ void Tutorial04_Instancing::CreateFloorPSO()
 
     GraphicsPipelineDesc& GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
     GraphicsPipeline.NumRenderTargets = 1;
-    GraphicsPipeline.RTVFormats[0] = m_pSwapChain->GetDesc().ColorBufferFormat;
-    GraphicsPipeline.DSVFormat = m_pSwapChain->GetDesc().DepthBufferFormat;
+    GraphicsPipeline.RTVFormats[0] = GetTargetDesc().ColorBufferFormat;
+    GraphicsPipeline.DSVFormat = GetTargetDesc().DepthBufferFormat;
     GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_BACK;
     GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
@@ -997,9 +3049,7 @@ void Tutorial04_Instancing::CreateFloorPSO()
     ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
     ShaderCI.Desc.UseCombinedTextureSamplers = true;
 
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
 
     // Crear vertex shader
     RefCntAutoPtr<IShader> pVS;
@@ -1008,7 +3058,7 @@ void Tutorial04_Instancing::CreateFloorPSO()
         ShaderCI.EntryPoint = "main";
         ShaderCI.Desc.Name = "Floor VS";
         ShaderCI.FilePath = "floor.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        CreateShaderWithCache(ShaderCI, &pVS);
     }
 
     // Crear pixel shader
@@ -1018,7 +3068,7 @@ void Tutorial04_Instancing::CreateFloorPSO()
         ShaderCI.EntryPoint = "main";
         ShaderCI.Desc.Name = "Floor PS";
         ShaderCI.FilePath = "floor.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        CreateShaderWithCache(ShaderCI, &pPS);
     }
 
     PSOCreateInfo.pVS = pVS;
@@ -1034,175 +3084,868 @@ void Tutorial04_Instancing::CreateFloorPSO()
     GraphicsPipeline.InputLayout.LayoutElements = FloorLayoutElems;
     GraphicsPipeline.InputLayout.NumElements = _countof(FloorLayoutElems);
 
-    // Definir variables de recursos muy simplificadas
+    // Las constantes de la vista y las de iluminación se enlazan con offsets en el buffer del frame
     ShaderResourceVariableDesc Vars[] =
     {
-        {SHADER_TYPE_PIXEL, "g_FloorTexture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+        {SHADER_TYPE_VERTEX, "Constants", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC},
+        {SHADER_TYPE_PIXEL, "PSConstants", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC},
+        {SHADER_TYPE_PIXEL, "g_ShadowMap", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "g_ShadowMoments", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
     };
     
     PSODesc.ResourceLayout.Variables = Vars;
     PSODesc.ResourceLayout.NumVariables = _countof(Vars);
     
-    // Definir samplers
-    SamplerDesc SamplerDesc;
-    SamplerDesc.MinFilter = FILTER_TYPE_LINEAR;
-    SamplerDesc.MagFilter = FILTER_TYPE_LINEAR;
-    SamplerDesc.MipFilter = FILTER_TYPE_LINEAR;
-    SamplerDesc.AddressU = TEXTURE_ADDRESS_WRAP;
-    SamplerDesc.AddressV = TEXTURE_ADDRESS_WRAP;
-    SamplerDesc.AddressW = TEXTURE_ADDRESS_WRAP;
-    
+    // Sampler de comparación para el PCF del mapa de sombras y trilineal para los momentos del VSM
     ImmutableSamplerDesc ImmutableSamplers[] = {
-        {SHADER_TYPE_PIXEL, "g_Texture_sampler", SamplerDesc}
+        {SHADER_TYPE_PIXEL, "g_ShadowMap", GetShadowMapSamplerDesc()},
+        {SHADER_TYPE_PIXEL, "g_ShadowMoments", GetShadowMomentsSamplerDesc()}
     };
     
     PSODesc.ResourceLayout.ImmutableSamplers = ImmutableSamplers;
     PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImmutableSamplers);
     
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pFloorPSO);
+    CreateGraphicsPSOWithCache(PSOCreateInfo, &m_pFloorPSO);
     
     if (m_pFloorPSO)
     {
-        m_pFloorPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_FloorTransform);
         m_pFloorPSO->CreateShaderResourceBinding(&m_FloorSRB, true);
         
         if (m_FloorSRB)
         {
-            // Asignar solo la textura del suelo, sin referencia al mapa de sombras
- //           m_FloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_FloorTexture")->Set(m_FloorTextureSRV);
+            // El offset dentro del buffer de constantes del frame se fija en cada vista
+            m_FloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(FloorVSConstants));
+            m_FloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferRange(m_FrameConstants.GetBuffer(), 0, sizeof(CubePSConstants));
+            m_FloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMap")->Set(m_ShadowMapSRV);
+            m_FloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMoments")->Set(m_ShadowMomentsSRV);
         }
     }
 }
 
 // Render a frame
-void Tutorial04_Instancing::Render()
+void Tutorial04_Instancing::WriteCubeVSConstants(CubeVSConstants& Constants, Uint32 ViewIdx) const
 {
-    PopulateInstanceBuffer();
-    
-    // No renderizamos el mapa de sombras para simplificar el proceso
-    
-    // ======= PASO 1: Renderizar la escena directamente =======
-    
-    auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
-    auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
+    Constants.ViewProj  = m_ViewProjs[ViewIdx];
+    Constants.Rotation  = m_RotationMatrix;
+    Constants.LightDir  = m_PSConstantsData.LightDir;
+    Constants.CameraPos = m_ViewCameraPos[ViewIdx];
+}
 
-    // Clear the back buffer
-    float4 ClearColor = {0.350f, 0.350f, 0.350f, 1.0f};
-    if (m_ConvertPSOutputToGamma)
+void Tutorial04_Instancing::WriteFloorVSConstants(FloorVSConstants& Constants, Uint32 ViewIdx) const
+{
+    Constants.Model    = float4x4::Identity();
+    Constants.ViewProj = m_ViewProjs[ViewIdx];
+}
+
+// Devuelve false si alguna estructura no cabe en el buffer de constantes del frame
+bool Tutorial04_Instancing::WriteFrameConstants()
+{
+    CPU_PROFILE_ZONE("WriteFrameConstants");
+
+    TransientConstantAllocator& Alloc = m_FrameConstants;
+
+    CubePSConstants* pPSConstants = Alloc.Allocate<CubePSConstants>(m_FrameCBOffsets.CubePS);
+    if (pPSConstants == nullptr)
+        return false;
+    *pPSConstants = m_PSConstantsData;
+
+    for (Uint32 View = 0; View < NumViews; ++View)
     {
-        ClearColor = LinearToSRGB(ClearColor);
+        CubeVSConstants*  pCubeVS  = Alloc.Allocate<CubeVSConstants>(m_FrameCBOffsets.CubeVS[View]);
+        FloorVSConstants* pFloorVS = Alloc.Allocate<FloorVSConstants>(m_FrameCBOffsets.FloorVS[View]);
+        if (pCubeVS == nullptr || pFloorVS == nullptr)
+            return false;
+        WriteCubeVSConstants(*pCubeVS, View);
+        WriteFloorVSConstants(*pFloorVS, View);
     }
-    m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    // Get pretransform matrix that rotates the scene according the surface orientation
-    auto SrfPreTransform = GetSurfacePretransformMatrix(float3{0, 0, 1});
+    // Pasada de sombras: la vista-proyección de la luz sustituye a la de la cámara
+    ShadowVSConstants* pShadowVS      = Alloc.Allocate<ShadowVSConstants>(m_FrameCBOffsets.ShadowVS);
+    FloorVSConstants*  pShadowFloorVS = Alloc.Allocate<FloorVSConstants>(m_FrameCBOffsets.ShadowFloorVS);
+    VSMBlurConstants*  pVSMBlur       = Alloc.Allocate<VSMBlurConstants>(m_FrameCBOffsets.VSMBlur);
+    if (pShadowVS == nullptr || pShadowFloorVS == nullptr || pVSMBlur == nullptr)
+        return false;
 
-    // Get projection matrix adjusted to the current screen orientation
-    auto Proj = GetAdjustedProjectionMatrix(PI_F / 4.0f, 0.1f, 100.f);
+    pShadowVS->LightViewProj = m_PSConstantsData.LightViewProj;
+    pShadowVS->Rotation      = m_RotationMatrix;
 
-    // Configuramos los viewports para las tres ventanas
-    // Dividimos la pantalla en 3 partes horizontales
-    const auto& SCDesc = m_pSwapChain->GetDesc();
-    
-    Viewport Viewports[3];
-    // Ventana 1: Parte izquierda
-    Viewports[0].TopLeftX = 0;
-    Viewports[0].TopLeftY = 0;
-    Viewports[0].Width = SCDesc.Width / 3;
-    Viewports[0].Height = SCDesc.Height;
-    Viewports[0].MinDepth = 0;
-    Viewports[0].MaxDepth = 1;
-    
-    // Ventana 2: Parte central
-    Viewports[1].TopLeftX = SCDesc.Width / 3;
-    Viewports[1].TopLeftY = 0;
-    Viewports[1].Width = SCDesc.Width / 3;
-    Viewports[1].Height = SCDesc.Height;
-    Viewports[1].MinDepth = 0;
-    Viewports[1].MaxDepth = 1;
-    
-    // Ventana 3: Parte derecha
-    Viewports[2].TopLeftX = 2 * SCDesc.Width / 3;
-    Viewports[2].TopLeftY = 0;
-    Viewports[2].Width = SCDesc.Width / 3;
-    Viewports[2].Height = SCDesc.Height;
-    Viewports[2].MinDepth = 0;
-    Viewports[2].MaxDepth = 1;
-    
-    // Renderizamos la escena tres veces, una vez para cada viewport con su propia cámara
-    for (int viewIdx = 0; viewIdx < 3; viewIdx++)
+    pShadowFloorVS->Model    = float4x4::Identity();
+    pShadowFloorVS->ViewProj = m_PSConstantsData.LightViewProj;
+
+    pVSMBlur->BlurParams = int4{m_VSMBlurRadius, static_cast<int>(ShadowMapSize), 0, 0};
+
+    MultiViewConstants* pMultiView = Alloc.Allocate<MultiViewConstants>(m_FrameCBOffsets.MultiView);
+    if (pMultiView == nullptr)
+        return false;
+    for (Uint32 View = 0; View < NumViews; ++View)
     {
-        // Establecer el viewport actual
-        m_pImmediateContext->SetViewports(1, &Viewports[viewIdx], SCDesc.Width, SCDesc.Height);
-        
-        // Seleccionar la matriz de vista correspondiente a este viewport
-        float4x4 CurrentView;
-        switch(viewIdx)
+        pMultiView->ViewProj[View]  = m_ViewProjs[View];
+        pMultiView->CameraPos[View] = m_ViewCameraPos[View];
+    }
+    pMultiView->Rotation = m_RotationMatrix;
+
+    const Uint32 GridSize     = GetGPUGridSize();
+    const Uint32 NumInstances = GetNumGPUInstances();
+
+    MobileAnimConstants* pAnim = Alloc.Allocate<MobileAnimConstants>(m_FrameCBOffsets.MobileAnim);
+    CullConstants*       pCull = Alloc.Allocate<CullConstants>(m_FrameCBOffsets.Cull);
+    if (pAnim == nullptr || pCull == nullptr)
+        return false;
+
+    pAnim->Rotations  = float4{m_MobileAnim.MainRotation, m_MobileAnim.FirstTierRotation, m_MobileAnim.SecondTierRotation, MobileGrid::MobileSpacing};
+    pAnim->GridParams = uint4{GridSize, NumMobileParts, NumInstances, 0};
+
+    for (Uint32 View = 0; View < NumViews; ++View)
+        pCull->ViewProj[View] = m_ViewProjs[View];
+    pCull->CullParams = uint4{NumInstances, static_cast<Uint32>(MaxInstances), 0, 0};
+    return true;
+}
+
+void Tutorial04_Instancing::CreateRecordingResources()
+{
+    if (m_pDeferredContexts.size() < NumRecordJobs || !m_CubePSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation] || !m_pFloorPSO)
+    {
+        m_ParallelRecording = false;
+        return;
+    }
+
+    for (Uint32 JobIdx = 0; JobIdx < NumRecordJobs; ++JobIdx)
+    {
+        RecordJob& Job = m_RecordJobs[JobIdx];
+        // Como mucho dos bloques de constantes por trabajo
+        Job.Constants.Initialize(m_pDevice, 1 << 10, "Record job constants CB");
+
+        if (GetRecordPass(JobIdx) == RECORD_PASS_FLOOR)
         {
-            case 0: CurrentView = ViewWindow1; break; // Paneo y zoom
-            case 1: CurrentView = ViewWindow2; break; // Control orbital
-            case 2: CurrentView = ViewWindow3; break; // Cámara libre
+            m_pFloorPSO->CreateShaderResourceBinding(&Job.pSRB, true);
+            Job.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferRange(Job.Constants.GetBuffer(), 0, sizeof(FloorVSConstants));
+            Job.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferRange(Job.Constants.GetBuffer(), 0, sizeof(CubePSConstants));
+            Job.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMap")->Set(m_ShadowMapSRV);
+            Job.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadowMoments")->Set(m_ShadowMomentsSRV);
+            m_pImmediateContext->TransitionShaderResources(m_pFloorPSO, Job.pSRB);
         }
-        
-        // Calcular la matriz view-projection para este viewport
-        float4x4 ViewProj = CurrentView * SrfPreTransform * Proj;
-        
-        // Actualizar los constantes del shader
+        else
         {
-            MapHelper<float4x4> CBConstants(m_pImmediateContext, m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-            CBConstants[0] = ViewProj;
-            CBConstants[1] = m_RotationMatrix;
+            Job.pSRB = CreateCubeSRB(m_CubePSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation], Job.Constants.GetBuffer(), "Constants", sizeof(CubeVSConstants));
+            m_pImmediateContext->TransitionShaderResources(m_CubePSOs[INSTANCE_FORMAT_FULL][DefaultCubePSPermutation], Job.pSRB);
         }
-        
-        // Actualizar la matriz de transformación del suelo para esta vista
+    }
+
+    // Pasada de sombras: el SRB sirve para todos los formatos de instancia, como m_ShadowMapSRB
+    if (m_pDeferredContexts.size() > NumRecordJobs && m_ShadowMapPSOs[INSTANCE_FORMAT_FULL])
+    {
+        RecordJob& Job = m_ShadowRecordJob;
+        Job.Constants.Initialize(m_pDevice, 1 << 8, "Shadow record job constants CB");
+        m_ShadowMapPSOs[INSTANCE_FORMAT_FULL]->CreateShaderResourceBinding(&Job.pSRB, true);
+        Job.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferRange(Job.Constants.GetBuffer(), 0, sizeof(ShadowVSConstants));
+    }
+
+    // Los contextos diferidos no pueden hacer transiciones: la geometría estática se deja
+    // desde ahora en el estado en el que se usa
+    StateTransitionDesc Barriers[] =
+    {
+        {m_CubeVertexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {m_CubeIndexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {m_FloorVertexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {m_FloorIndexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE}
+    };
+    m_pImmediateContext->TransitionResourceStates(_countof(Barriers), Barriers);
+}
+
+bool Tutorial04_Instancing::CanRecordInParallel() const
+{
+    // Los buffers dinámicos se mapean por contexto: un contexto diferido no ve los datos que
+    // el inmediato ha escrito en m_InstanceBuffer o en el buffer de instancias del culling en CPU
+    return m_RecordJobs[0].pSRB != nullptr &&
+        m_pCurrInstanceBuffer != nullptr &&
+        m_pCurrInstanceBuffer->GetDesc().Usage != USAGE_DYNAMIC;
+}
+
+void Tutorial04_Instancing::RecordFloorPass(IDeviceContext* pCtx, IShaderResourceBinding* pSRB, RESOURCE_STATE_TRANSITION_MODE TransitionMode)
+{
+    // Configurar los buffers de vértices e índices para el suelo
+    const Uint64 offsets[] = {0};
+    IBuffer*     pBuffs[]  = {m_FloorVertexBuffer};
+    pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, TransitionMode, SET_VERTEX_BUFFERS_FLAG_RESET);
+    pCtx->SetIndexBuffer(m_FloorIndexBuffer, 0, TransitionMode);
+
+    // Configurar el pipeline state y recursos del shader
+    pCtx->SetPipelineState(m_pFloorPSO);
+    pCtx->CommitShaderResources(pSRB, TransitionMode);
+
+    // Dibujar el suelo
+    DrawIndexedAttribs DrawAttrs;
+    DrawAttrs.IndexType  = VT_UINT32;
+    DrawAttrs.NumIndices = 6; // Dos triángulos (6 índices)
+    DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
+    pCtx->DrawIndexed(DrawAttrs);
+}
+
+void Tutorial04_Instancing::RecordMobilePass(IDeviceContext*                pCtx,
+                                             IShaderResourceBinding*        pSRB,
+                                             Uint32                         ViewIdx,
+                                             bool                           UseGPUCulling,
+                                             bool                           UseCPUCulling,
+                                             RESOURCE_STATE_TRANSITION_MODE TransitionMode)
+{
+    pCtx->SetIndexBuffer(m_CubeIndexBuffer, 0, TransitionMode);
+
+    DrawIndexedAttribs DrawAttrs;
+    DrawAttrs.IndexType  = VT_UINT32;
+    DrawAttrs.NumIndices = 36;
+    DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
+
+    // El coste por permutación sólo se mide en la vista principal y en el contexto inmediato:
+    // las consultas no se pueden repartir entre contextos diferidos
+    const bool MeasurePermutations = m_MeasurePermutations && ViewIdx == 0 && pCtx == m_pImmediateContext;
+    const bool Specular            = m_PSConstantsData.SpecularIntensity > 0;
+
+    // Dibuja NumInstances instancias a partir del byte InstanceOffset del buffer de instancias
+    // con la permutación Permutation
+    auto DrawInstances = [&](IBuffer* pInstanceBuffer, Uint64 InstanceOffset, Uint32 NumInstances, IPipelineState* pPSO, Uint32 Permutation) {
+        const Uint64 offsets[] = {0, InstanceOffset};
+        IBuffer*     pBuffs[]  = {m_CubeVertexBuffer, pInstanceBuffer};
+        pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, TransitionMode, SET_VERTEX_BUFFERS_FLAG_RESET);
+        pCtx->SetPipelineState(pPSO);
+        pCtx->CommitShaderResources(pSRB, TransitionMode);
+
+        DurationQueryHelper* pQuery = MeasurePermutations ? m_PermutationQueries[Permutation].get() : nullptr;
+        if (pQuery != nullptr)
+            pQuery->Begin(pCtx);
+
+        if (UseGPUCulling)
+        {
+            // El número de instancias lo ha escrito el compute shader de culling
+            DrawIndexedIndirectAttribs IndirectAttrs;
+            IndirectAttrs.IndexType                        = VT_UINT32;
+            IndirectAttrs.pAttribsBuffer                   = m_DrawArgsBuffer;
+            IndirectAttrs.DrawArgsOffset                   = sizeof(Uint32) * 5 * ViewIdx;
+            IndirectAttrs.Flags                            = DRAW_FLAG_VERIFY_ALL;
+            IndirectAttrs.AttribsBufferStateTransitionMode = TransitionMode;
+            pCtx->DrawIndexedIndirect(IndirectAttrs);
+        }
+        else
+        {
+            DrawAttrs.NumInstances = NumInstances;
+            pCtx->DrawIndexed(DrawAttrs);
+        }
+
+        double Duration = 0;
+        if (pQuery != nullptr && pQuery->End(pCtx, Duration))
+            AccumulateTiming(m_PermutationTimeMs[Permutation], static_cast<float>(Duration * 1000.0));
+    };
+
+    if (UseGPUCulling)
+    {
+        // Segmento compacto de esta vista escrito por el compute shader, sin ordenar
+        const Uint32 Permutation = GetCubePSPermutation(TEX_BLEND_MODE_PER_INSTANCE, Specular);
+        DrawInstances(m_VisibleInstanceBuffer, Uint64{sizeof(InstanceDataType)} * MaxInstances * ViewIdx, 0,
+                      m_CubePSOs[INSTANCE_FORMAT_FULL][Permutation], Permutation);
+        return;
+    }
+
+    const Uint64 Stride = GetInstanceStride(m_CurrInstanceFormat);
+    if (m_MaterialSortedDraws && m_InstancesSortedByMaterial)
+    {
+        // Un draw por material con la permutación de su modo de mezcla, sin ramas en el shader
+        for (Uint32 Material = 0; Material < NumMobileMaterials; ++Material)
+        {
+            const InstanceRange& Range       = m_MaterialRanges[ViewIdx][Material];
+            const Uint32         Permutation = GetCubePSPermutation(Material, Specular);
+            if (Range.Count > 0)
+                DrawInstances(m_pCurrInstanceBuffer, Stride * Range.First, Range.Count, m_CubePSOs[m_CurrInstanceFormat][Permutation], Permutation);
+        }
+    }
+    else
+    {
+        // Con culling, el buffer de instancias es el segmento compacto de esta vista
+        const Uint32 FirstInstance = UseCPUCulling ? m_ViewFirstInstance[ViewIdx] : 0;
+        const Uint32 NumInstances  = UseCPUCulling ? m_ViewNumInstances[ViewIdx] : m_NumInstances;
+        const Uint32 Permutation   = GetCubePSPermutation(TEX_BLEND_MODE_PER_INSTANCE, Specular);
+        if (NumInstances > 0)
+            DrawInstances(m_pCurrInstanceBuffer, Stride * FirstInstance, NumInstances, m_CubePSOs[m_CurrInstanceFormat][Permutation], Permutation);
+    }
+}
+
+void Tutorial04_Instancing::RecordViewsInParallel(const Viewport* Viewports, bool UseGPUCulling, bool UseCPUCulling, bool RecordShadow)
+{
+    CPU_PROFILE_ZONE("RecordViewsInParallel");
+
+    // En los contextos diferidos no se permiten transiciones de estado: los buffers que las
+    // pasadas de compute dejan en otro estado se preparan desde el contexto inmediato. Con
+    // culling en GPU la pasada de sombras lee el buffer completo y las vistas, el compacto.
+    {
+        StateTransitionDesc Barriers[3];
+        Uint32              NumBarriers = 0;
+
+        Barriers[NumBarriers++] = {UseGPUCulling ? m_VisibleInstanceBuffer.RawPtr() : m_pCurrInstanceBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        if (UseGPUCulling)
+        {
+            Barriers[NumBarriers++] = {m_DrawArgsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE};
+            if (RecordShadow)
+                Barriers[NumBarriers++] = {m_pCurrInstanceBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        }
+        m_pImmediateContext->TransitionResourceStates(NumBarriers, Barriers);
+    }
+
+    // La capa estática y la copia al mapa dinámico se hacen antes en el contexto inmediato, que
+    // deja el mapa en DEPTH_WRITE para el trabajo de sombras. Mientras se graba, el mapa no está
+    // aún en el estado en que lo leerán las vistas: EndShadowMapUpdate() lo pasa a
+    // SHADER_RESOURCE en el contexto inmediato entre la lista de sombras y las de las vistas, así
+    // que las vistas se graban sin transiciones ni comprobaciones de estado.
+    RESOURCE_STATE_TRANSITION_MODE ViewTransitionMode = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+    if (RecordShadow)
+    {
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_SHADOW_MAP);
+        BeginShadowMapUpdate();
+        StateTransitionDesc Barrier{m_ShadowMap, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_DEPTH_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+        ViewTransitionMode = RESOURCE_STATE_TRANSITION_MODE_NONE;
+    }
+
+    ITextureView* pRTV   = GetTargetRTV();
+    ITextureView* pDSV   = GetTargetDSV();
+    const auto&   SCDesc = GetTargetDesc();
+
+    // Los trabajos van vista por vista: los de las vistas activas son los primeros. El de
+    // sombras va el último.
+    const Uint32 NumJobs = m_NumActiveViews * RECORD_PASS_COUNT;
+
+    Timer RecordTimer;
+    m_pThreadPool->ParallelFor(NumJobs + (RecordShadow ? 1 : 0), 1, [&](Uint32 Begin, Uint32 End) {
+        for (Uint32 JobIdx = Begin; JobIdx < End; ++JobIdx)
+        {
+            CPU_PROFILE_ZONE("Trabajo de grabación");
+            Timer JobTimer;
+
+            if (JobIdx == NumJobs)
+            {
+                RecordJob&      Job  = m_ShadowRecordJob;
+                IDeviceContext* pCtx = m_pDeferredContexts[NumRecordJobs];
+                pCtx->Begin(0);
+
+                Uint32 ShadowVSOffset = 0;
+                Job.Constants.BeginFrame(pCtx);
+                ShadowVSConstants* pShadowVS = Job.Constants.Allocate<ShadowVSConstants>(ShadowVSOffset);
+                if (pShadowVS != nullptr)
+                {
+                    pShadowVS->LightViewProj = m_PSConstantsData.LightViewProj;
+                    pShadowVS->Rotation      = m_RotationMatrix;
+                }
+                Job.Constants.EndFrame();
+
+                // Sin constantes la lista queda vacía y el mapa conserva solo la capa estática
+                if (pShadowVS != nullptr)
+                {
+                    Job.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(ShadowVSOffset);
+                    RecordShadowCasters(pCtx, Job.pSRB, RESOURCE_STATE_TRANSITION_MODE_NONE);
+                }
+
+                pCtx->FinishCommandList(&Job.pCmdList);
+                Job.RecordTimeMs = static_cast<float>(JobTimer.GetElapsedTime() * 1000.0);
+                continue;
+            }
+
+            RecordJob&      Job     = m_RecordJobs[JobIdx];
+            IDeviceContext* pCtx    = m_pDeferredContexts[JobIdx];
+            const Uint32    ViewIdx = GetRecordView(JobIdx);
+
+            pCtx->Begin(0);
+            pCtx->SetRenderTargets(1, &pRTV, pDSV, ViewTransitionMode);
+            pCtx->SetViewports(1, &Viewports[ViewIdx], SCDesc.Width, SCDesc.Height);
+
+            // Los buffers dinámicos se mapean por contexto, así que cada trabajo escribe sus
+            // constantes en su propio buffer con un único map en su contexto diferido
+            Job.Constants.BeginFrame(pCtx);
+            if (GetRecordPass(JobIdx) == RECORD_PASS_FLOOR)
+            {
+                // Si las constantes no caben, la lista de la pasada queda vacía
+                Uint32            FloorVSOffset = 0;
+                Uint32            FloorPSOffset = 0;
+                FloorVSConstants* pFloorVS      = Job.Constants.Allocate<FloorVSConstants>(FloorVSOffset);
+                CubePSConstants*  pFloorPS      = Job.Constants.Allocate<CubePSConstants>(FloorPSOffset);
+                if (pFloorVS != nullptr && pFloorPS != nullptr)
+                {
+                    WriteFloorVSConstants(*pFloorVS, ViewIdx);
+                    *pFloorPS = m_PSConstantsData;
+                }
+                Job.Constants.EndFrame();
+
+                if (pFloorVS != nullptr && pFloorPS != nullptr)
+                {
+                    Job.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(FloorVSOffset);
+                    Job.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(FloorPSOffset);
+                    RecordFloorPass(pCtx, Job.pSRB, ViewTransitionMode);
+                }
+            }
+            else
+            {
+                Uint32           CubeVSOffset = 0;
+                Uint32           CubePSOffset = 0;
+                CubeVSConstants* pCubeVS      = Job.Constants.Allocate<CubeVSConstants>(CubeVSOffset);
+                CubePSConstants* pCubePS      = Job.Constants.Allocate<CubePSConstants>(CubePSOffset);
+                if (pCubeVS != nullptr && pCubePS != nullptr)
+                {
+                    WriteCubeVSConstants(*pCubeVS, ViewIdx);
+                    *pCubePS = m_PSConstantsData;
+                }
+                Job.Constants.EndFrame();
+
+                if (pCubeVS != nullptr && pCubePS != nullptr)
+                {
+                    Job.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(CubeVSOffset);
+                    Job.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(CubePSOffset);
+                    RecordMobilePass(pCtx, Job.pSRB, ViewIdx, UseGPUCulling, UseCPUCulling, ViewTransitionMode);
+                }
+            }
+
+            pCtx->FinishCommandList(&Job.pCmdList);
+            Job.RecordTimeMs = static_cast<float>(JobTimer.GetElapsedTime() * 1000.0);
+        }
+    });
+    const float RecordTimeMs = static_cast<float>(RecordTimer.GetElapsedTime() * 1000.0);
+
+    // Las sombras se ejecutan y el mapa pasa a SHADER_RESOURCE antes que cualquier vista, que lo lee
+    float JobTimeMs = 0;
+    if (RecordShadow)
+    {
+        ICommandList* pShadowCmdList = m_ShadowRecordJob.pCmdList;
+        m_pImmediateContext->ExecuteCommandLists(1, &pShadowCmdList);
+        m_ShadowRecordJob.pCmdList.Release();
+        m_pDeferredContexts[NumRecordJobs]->FinishFrame();
+        JobTimeMs += m_ShadowRecordJob.RecordTimeMs;
+
+        EndShadowMapUpdate();
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_SHADOW_MAP);
+    }
+
+    for (Uint32 JobIdx = 0; JobIdx < NumJobs; ++JobIdx)
+        JobTimeMs += m_RecordJobs[JobIdx].RecordTimeMs;
+
+    // Medias por número de hilos para comparar la aceleración
+    if (m_RecordTimeMsByThreads.size() <= static_cast<size_t>(m_NumThreads))
+        m_RecordTimeMsByThreads.resize(m_NumThreads + 1);
+    AccumulateTiming(m_RecordTimeMsByThreads[m_NumThreads], RecordTimeMs);
+    AccumulateTiming(m_RecordJobTimeMs, JobTimeMs);
+}
+
+// Envía las listas de las vistas grabadas en RecordViewsInParallel()
+void Tutorial04_Instancing::ExecuteRecordedViews()
+{
+    // Las listas se envían en el orden de los trabajos: vista por vista, el suelo antes que el móvil
+    const Uint32  NumJobs                  = m_NumActiveViews * RECORD_PASS_COUNT;
+    ICommandList* pCmdLists[NumRecordJobs] = {};
+    for (Uint32 JobIdx = 0; JobIdx < NumJobs; ++JobIdx)
+        pCmdLists[JobIdx] = m_RecordJobs[JobIdx].pCmdList;
+    m_pImmediateContext->ExecuteCommandLists(NumJobs, pCmdLists);
+
+    for (Uint32 JobIdx = 0; JobIdx < NumJobs; ++JobIdx)
+    {
+        m_RecordJobs[JobIdx].pCmdList.Release();
+        m_pDeferredContexts[JobIdx]->FinishFrame();
+    }
+
+    // Tras ejecutar las listas el contexto inmediato no tiene render targets; la UI los necesita
+    ITextureView* pRTV = GetTargetRTV();
+    m_pImmediateContext->SetRenderTargets(1, &pRTV, GetTargetDSV(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+// Renderiza el suelo y el móvil de una vista en el render target que esté enlazado
+void Tutorial04_Instancing::RenderView(Uint32 ViewIdx, const Viewport& VP, Uint32 RTWidth, Uint32 RTHeight, bool UseGPUCulling, bool UseCPUCulling)
+{
+    static const char* const ViewZoneNames[] = {"Render: vista 1", "Render: vista 2", "Render: vista 3"};
+    static_assert(_countof(ViewZoneNames) == NumViews, "Falta el nombre de la zona de alguna vista");
+    CPU_PROFILE_ZONE(ViewZoneNames[ViewIdx]);
+
+    // Establecer el viewport actual
+    m_pImmediateContext->SetViewports(1, &VP, RTWidth, RTHeight);
+
+    // Las constantes de esta vista ya están en el buffer del frame; solo cambia el offset
+    m_FloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(m_FrameCBOffsets.FloorVS[ViewIdx]);
+    m_FloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(m_FrameCBOffsets.CubePS);
+    m_SRB->GetVariableByName(SHADER_TYPE_VERTEX, "Constants")->SetBufferOffset(m_FrameCBOffsets.CubeVS[ViewIdx]);
+    m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(m_FrameCBOffsets.CubePS);
+
+    // Renderizar primero el suelo y luego el móvil
+    m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_FLOOR_VIEW0 + ViewIdx);
+    RecordFloorPass(m_pImmediateContext, m_FloorSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_FLOOR_VIEW0 + ViewIdx);
+
+    m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_MOBILE_VIEW0 + ViewIdx);
+    RecordMobilePass(m_pImmediateContext, m_SRB, ViewIdx, UseGPUCulling, UseCPUCulling, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_MOBILE_VIEW0 + ViewIdx);
+}
+
+// Compara el estado del que depende la imagen de cada vista con el de su último render y
+// (re)crea sus texturas si cambia su tamaño. Devuelve un bit por vista que hay que renderizar.
+// Se llama antes de generar las instancias, así que solo usa entradas: la matriz de la luz y el
+// mapa de sombras se derivan de la dirección de la luz, las instancias y el modo de sombra.
+Uint32 Tutorial04_Instancing::UpdateViewCache(Uint32 ViewWidth, Uint32 ViewHeight)
+{
+    const SwapChainDesc& TargetDesc = GetTargetDesc();
+
+    const bool   GPUAnimation = m_GPUAnimation && m_pMobileAnimPSO;
+    const Uint32 CullingMode  = (GPUAnimation && m_GPUCulling && !m_MultiView && m_pCullPSO ? 1u : 0u) | (UseCPUCullingPath() ? 2u : 0u);
+
+    // UpdateLight() todavía no ha escrito la luz de este frame; el modo de sombra tiene su campo
+    CubePSConstants PSConstants = m_PSConstantsData;
+    PSConstants.LightDir        = float4(m_LightDirection, 0.0f);
+    PSConstants.LightViewProj   = float4x4::Identity();
+    PSConstants.ShadowParams    = float4{};
+
+    Uint32 DirtyViews = 0;
+    for (Uint32 View = 0; View < m_NumActiveViews; ++View)
+    {
+        if (!m_ViewColor[View] || m_ViewColor[View]->GetDesc().Width != ViewWidth || m_ViewColor[View]->GetDesc().Height != ViewHeight)
+        {
+            m_ViewColor[View].Release();
+            m_ViewDepth[View].Release();
+            m_ViewCompositeSRBs[View].Release();
+
+            TextureDesc TexDesc;
+            TexDesc.Name              = "View cache color";
+            TexDesc.Type              = RESOURCE_DIM_TEX_2D;
+            TexDesc.Width             = ViewWidth;
+            TexDesc.Height            = ViewHeight;
+            TexDesc.Format            = TargetDesc.ColorBufferFormat;
+            TexDesc.BindFlags         = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+            TexDesc.ClearValue.Format = TexDesc.Format;
+            m_pDevice->CreateTexture(TexDesc, nullptr, &m_ViewColor[View]);
+
+            TexDesc.Name                          = "View cache depth";
+            TexDesc.Format                        = TargetDesc.DepthBufferFormat;
+            TexDesc.BindFlags                     = BIND_DEPTH_STENCIL;
+            TexDesc.ClearValue.Format             = TexDesc.Format;
+            TexDesc.ClearValue.DepthStencil.Depth = 1;
+            m_pDevice->CreateTexture(TexDesc, nullptr, &m_ViewDepth[View]);
+
+            m_ViewCacheValid[View] = false;
+        }
+
+        ViewCacheKey Key;
+        Key.ViewProj            = m_ViewProjs[View];
+        Key.CameraPos           = m_ViewCameraPos[View];
+        Key.Rotation            = m_RotationMatrix;
+        Key.PSConstants         = PSConstants;
+        Key.Anim                = m_MobileAnim;
+        Key.GridSize            = m_GridMode ? static_cast<Uint32>(m_GridSize) : 0;
+        Key.InstanceFormat      = m_InstanceFormat;
+        Key.ShadowMode          = GetShadowMode();
+        Key.VSMBlurRadius       = static_cast<Uint32>(m_VSMBlurRadius);
+        Key.CullingMode         = CullingMode;
+        Key.MaterialSortedDraws = m_MaterialSortedDraws ? 1 : 0;
+        Key.GPUAnimation        = m_GPUAnimation ? 1 : 0;
+        Key.MaterialsReady      = m_MaterialTexturesReady ? 1 : 0;
+        Key.Width               = ViewWidth;
+        Key.Height              = ViewHeight;
+        if (m_ViewCacheValid[View] && Key == m_ViewCacheKeys[View])
+            continue;
+
+        m_ViewCacheKeys[View]  = Key;
+        m_ViewCacheValid[View] = m_ViewColor[View] && m_ViewDepth[View];
+        DirtyViews |= 1u << View;
+    }
+    return DirtyViews;
+}
+
+// Renderiza en su textura cada vista marcada en DirtyViews
+void Tutorial04_Instancing::RenderCachedViews(Uint32 DirtyViews, Uint32 ViewWidth, Uint32 ViewHeight, bool UseGPUCulling, bool UseCPUCulling)
+{
+    const float4 ClearColor = GetClearColor();
+    for (Uint32 View = 0; View < m_NumActiveViews; ++View)
+    {
+        if ((DirtyViews & (1u << View)) == 0 || !m_ViewColor[View] || !m_ViewDepth[View])
+            continue;
+
+        ITextureView* pRTV = m_ViewColor[View]->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+        ITextureView* pDSV = m_ViewDepth[View]->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        Viewport VP;
+        VP.Width  = static_cast<float>(ViewWidth);
+        VP.Height = static_cast<float>(ViewHeight);
+        RenderView(View, VP, ViewWidth, ViewHeight, UseGPUCulling, UseCPUCulling);
+        ++m_ViewRenders[View];
+    }
+}
+
+// Copia la imagen guardada de cada vista a su viewport del destino
+void Tutorial04_Instancing::CompositeCachedViews(const Viewport* Viewports)
+{
+    ITextureView* pRTV = GetTargetRTV();
+    m_pImmediateContext->SetRenderTargets(1, &pRTV, GetTargetDSV(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    if (!m_pViewCompositePSO)
+        return;
+
+    const SwapChainDesc& TargetDesc = GetTargetDesc();
+    m_pImmediateContext->SetPipelineState(m_pViewCompositePSO);
+    for (Uint32 View = 0; View < m_NumActiveViews; ++View)
+    {
+        if (!m_ViewColor[View])
+            continue;
+
+        if (!m_ViewCompositeSRBs[View])
+        {
+            m_pViewCompositePSO->CreateShaderResourceBinding(&m_ViewCompositeSRBs[View], true);
+            m_ViewCompositeSRBs[View]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Source")->Set(m_ViewColor[View]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        }
+
+        m_pImmediateContext->SetViewports(1, &Viewports[View], TargetDesc.Width, TargetDesc.Height);
+        m_pImmediateContext->CommitShaderResources(m_ViewCompositeSRBs[View], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->Draw(DrawAttribs{3, DRAW_FLAG_VERIFY_ALL});
+    }
+}
+
+float4 Tutorial04_Instancing::GetClearColor() const
+{
+    const float4 ClearColor = {0.350f, 0.350f, 0.350f, 1.0f};
+    return m_ConvertPSOutputToGamma ? LinearToSRGB(ClearColor) : ClearColor;
+}
+
+void Tutorial04_Instancing::Render()
+{
+    CPU_PROFILE_ZONE("Render");
+
+    const float4x4 Proj = GetProjectionMatrix();
+
+    // Matrices view-projection de cada ventana; el culling las necesita antes de generar las instancias
+    m_ViewProjs[0] = ViewWindow1 * Proj; // Paneo y zoom
+    m_ViewProjs[1] = ViewWindow2 * Proj; // Control orbital
+    m_ViewProjs[2] = ViewWindow3 * Proj; // Cámara libre
+
+    // El especular de cada vista se calcula desde su propia cámara
+    m_ViewCameraPos[0] = float4{GetPanZoomCameraPosition(CameraWindow1), 1.0f};
+    m_ViewCameraPos[1] = float4{GetOrbitCameraPosition(CameraWindow2), 1.0f};
+    m_ViewCameraPos[2] = float4{GetFreeCameraPosition(CameraWindow3), 1.0f};
+
+    // Mientras se crean los PSO solo se limpia el destino, sobre el que se dibuja la interfaz
+    if (!m_SceneReady)
+    {
+        ITextureView* pRTV = GetTargetRTV();
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, GetTargetDSV(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearRenderTarget(pRTV, GetClearColor().Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        return;
+    }
+
+    // Configuramos los viewports de las ventanas: dividimos la pantalla en partes horizontales
+    // iguales, de izquierda a derecha (paneo y zoom, control orbital y cámara libre). Con menos
+    // vistas activas (solo en el benchmark) cada una ocupa una parte mayor.
+    const auto& SCDesc = GetTargetDesc();
+    
+    Viewport Viewports[NumViews];
+    for (Uint32 viewIdx = 0; viewIdx < m_NumActiveViews; ++viewIdx)
+    {
+        Viewports[viewIdx].TopLeftX = static_cast<float>(viewIdx * SCDesc.Width / m_NumActiveViews);
+        Viewports[viewIdx].TopLeftY = 0;
+        Viewports[viewIdx].Width    = static_cast<float>(SCDesc.Width / m_NumActiveViews);
+        Viewports[viewIdx].Height   = static_cast<float>(SCDesc.Height);
+        Viewports[viewIdx].MinDepth = 0;
+        Viewports[viewIdx].MaxDepth = 1;
+    }
+
+    // Bajo demanda solo se renderizan las vistas cuya imagen guardada ya no es válida. Si no ha
+    // cambiado ninguna, no se generan ni se suben las instancias, no se mapean las constantes y
+    // solo se compone la imagen guardada de cada vista.
+    const Uint32 ViewWidth  = SCDesc.Width / m_NumActiveViews;
+    Uint32       DirtyViews = 0;
+    if (m_OnDemandRendering)
+    {
+        ++m_OnDemandFrames;
+        DirtyViews = UpdateViewCache(ViewWidth, SCDesc.Height);
+        if (DirtyViews == 0)
+        {
+            m_GPUProfiler.BeginFrame();
+            m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_VIEW_COMPOSITE);
+            CompositeCachedViews(Viewports);
+            m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_VIEW_COMPOSITE);
+            return;
+        }
+    }
+
+    // Con culling en CPU la luz se ajusta a la raíz de la BVH: las instancias se generan y la BVH
+    // se reajusta antes, para que la proyección no corte las instancias que se han movido
+    if (UseCPUCullingPath())
+        GenerateCulledInstances();
+    UpdateLight();
+    UpdateShadowCasterState();
+
+    // Todas las constantes del frame con un único map; cada pasada solo cambia su offset. La
+    // zona cubre el buffer mapeado entero: el map, las escrituras y el unmap.
+    bool ConstantsWritten = false;
+    {
+        CPU_PROFILE_ZONE("Map: constantes del frame");
+        m_FrameConstants.BeginFrame(m_pImmediateContext);
+        ConstantsWritten = WriteFrameConstants();
+        m_FrameConstants.EndFrame();
+    }
+    // Sin todas las constantes ninguna pasada puede dibujar: solo se limpia el destino
+    if (!ConstantsWritten)
+    {
+        LOG_ERROR_MESSAGE("Las constantes del frame no caben en su buffer (", m_FrameConstants.GetCapacity(), " bytes)");
+        // Las vistas marcadas en DirtyViews no se van a renderizar
+        for (Uint32 View = 0; View < NumViews; ++View)
         {
-            MapHelper<float4x4> FloorTransform(m_pImmediateContext, m_FloorTransform, MAP_WRITE, MAP_FLAG_DISCARD);
-            FloorTransform[0] = float4x4::Identity(); // Matriz de modelo
-            FloorTransform[1] = ViewProj;             // Matriz de vista-proyección
+            if (DirtyViews & (1u << View))
+                m_ViewCacheValid[View] = false;
         }
+        ITextureView* pRTV = GetTargetRTV();
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, GetTargetDSV(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearRenderTarget(pRTV, GetClearColor().Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        return;
+    }
+
+    m_GPUProfiler.BeginFrame();
+
+    if (m_GPUAnimation && m_pMobileAnimPSO)
+    {
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_ANIMATION);
+        AnimateInstancesOnGPU();
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_ANIMATION);
+    }
+    else
+        PopulateInstanceBuffer();
+    
+    // Cada pasada de cada vista se graba en su propio contexto diferido, y las instancias del
+    // mapa de sombras se graban a la vez en otro
+    const bool ParallelViews = !m_OnDemandRendering && !m_MultiView && m_ParallelRecording && CanRecordInParallel();
+    const bool ShadowJob     = ParallelViews && m_ShadowUpdatePending && m_ShadowRecordJob.pSRB;
+
+    // ======= PASO 1: Mapa de sombras, una vez para las tres vistas y solo si ha cambiado =======
+    ++m_ShadowFrames;
+    if (m_ShadowUpdatePending && !ShadowJob)
+    {
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_SHADOW_MAP);
+        RenderShadowMap();
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_SHADOW_MAP);
+    }
+    
+    // ======= PASO 2: Renderizar la escena =======
+    
+    auto* pRTV = GetTargetRTV();
+    auto* pDSV = GetTargetDSV();
+    m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // Clear the back buffer
+    m_pImmediateContext->ClearRenderTarget(pRTV, GetClearColor().Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // Con culling (en el GPU o en el CPU) cada vista dibuja solo sus instancias visibles
+    const bool UseGPUCulling = m_GPUCulling && !m_MultiView && m_pCullPSO && m_pCurrInstanceBuffer == m_GPUInstanceBuffer;
+    const bool UseCPUCulling = m_CulledInstanceBuffer && m_pCurrInstanceBuffer == m_CulledInstanceBuffer;
+
+    if (UseGPUCulling)
+    {
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_CULLING);
+        CullInstancesOnGPU();
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_CULLING);
+    }
+
+    // Con grabación en paralelo las listas (y las sombras, si toca actualizarlas) se graban y
+    // se ejecutan las de sombras antes de empezar a medir las vistas
+    if (ParallelViews)
+        RecordViewsInParallel(Viewports, UseGPUCulling, UseCPUCulling, ShadowJob);
+
+    // El coste de las vistas se mide por modo de sombra para comparar PCF y VSM
+    if (m_ViewPassesQuery)
+        BeginTimedPass(*m_ViewPassesQuery, m_ViewPassesQueryModes, m_pImmediateContext);
+    
+    if (m_OnDemandRendering)
+    {
+        RenderCachedViews(DirtyViews, ViewWidth, SCDesc.Height, UseGPUCulling, UseCPUCulling);
+
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_VIEW_COMPOSITE);
+        CompositeCachedViews(Viewports);
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_VIEW_COMPOSITE);
+    }
+    else if (m_MultiView)
+    {
+        // Todas las vistas en una pasada: un único bloque de constantes y un cambio de PSO y un
+        // draw por objeto (por material en el móvil), independientemente del número de vistas
+        m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_VERTEX, "MultiViewConstants")->SetBufferOffset(m_FrameCBOffsets.MultiView);
+        m_MultiViewFloorSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(m_FrameCBOffsets.CubePS);
+        m_MultiViewSRB->GetVariableByName(SHADER_TYPE_VERTEX, "MultiViewConstants")->SetBufferOffset(m_FrameCBOffsets.MultiView);
+        m_MultiViewSRB->GetVariableByName(SHADER_TYPE_PIXEL, "PSConstants")->SetBufferOffset(m_FrameCBOffsets.CubePS);
+        m_pImmediateContext->SetViewports(NumViews, Viewports, SCDesc.Width, SCDesc.Height);
 
-        // Renderizar primero el suelo
         {
-            // Configurar los buffers de vértices e índices para el suelo
+            CPU_PROFILE_ZONE("Render: suelo, pasada única");
+            m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_MULTIVIEW_FLOOR);
             const Uint64 offsets[] = {0};
             IBuffer*     pBuffs[]  = {m_FloorVertexBuffer};
             m_pImmediateContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
             m_pImmediateContext->SetIndexBuffer(m_FloorIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-            
-            // Configurar el pipeline state y recursos del shader
-            m_pImmediateContext->SetPipelineState(m_pFloorPSO);
-            m_pImmediateContext->CommitShaderResources(m_FloorSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-            
-            // Dibujar el suelo
+            m_pImmediateContext->SetPipelineState(m_pMultiViewFloorPSO);
+            m_pImmediateContext->CommitShaderResources(m_MultiViewFloorSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
             DrawIndexedAttribs DrawAttrs;
-            DrawAttrs.IndexType = VT_UINT32;
-            DrawAttrs.NumIndices = 6; // Dos triángulos (6 índices)
-            DrawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
+            DrawAttrs.IndexType    = VT_UINT32;
+            DrawAttrs.NumIndices   = 6;
+            DrawAttrs.NumInstances = NumViews; // Una copia del suelo por vista
+            DrawAttrs.Flags        = DRAW_FLAG_VERIFY_ALL;
             m_pImmediateContext->DrawIndexed(DrawAttrs);
+            m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_MULTIVIEW_FLOOR);
         }
 
-        // Luego renderizar el móvil
         {
-            // Configurar los buffers de vértices e índices para el móvil
-            const Uint64 offsets[] = {0, 0};
-            IBuffer*     pBuffs[]  = {m_CubeVertexBuffer, m_InstanceBuffer};
-            m_pImmediateContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+            CPU_PROFILE_ZONE("Render: móvil, pasada única");
+            m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_MULTIVIEW_MOBILE);
             m_pImmediateContext->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-            
-            // Configurar el pipeline state y recursos del shader
-            m_pImmediateContext->SetPipelineState(m_pPSO);
-            m_pImmediateContext->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-            
-            // Dibujar las instancias del móvil
-            DrawIndexedAttribs DrawAttrs;
-            DrawAttrs.IndexType = VT_UINT32;
-            DrawAttrs.NumIndices = 36;
-            DrawAttrs.NumInstances = 24; // Número de instancias del móvil
-            DrawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
-            m_pImmediateContext->DrawIndexed(DrawAttrs);
+
+            // Un draw por material si las instancias están ordenadas; si no, uno solo
+            const bool          Specular    = m_PSConstantsData.SpecularIntensity > 0;
+            const bool          ByMaterial  = m_MaterialSortedDraws && m_InstancesSortedByMaterial;
+            const Uint32        NumDraws    = ByMaterial ? NumMobileMaterials : 1;
+            const InstanceRange AllInstances{0, m_NumInstances};
+            for (Uint32 Draw = 0; Draw < NumDraws; ++Draw)
+            {
+                const InstanceRange& Range = ByMaterial ? m_MaterialRanges[0][Draw] : AllInstances;
+                if (Range.Count == 0)
+                    continue;
+
+                const Uint64 offsets[] = {0, Uint64{GetInstanceStride(m_CurrInstanceFormat)} * Range.First};
+                IBuffer*     pBuffs[]  = {m_CubeVertexBuffer, m_pCurrInstanceBuffer};
+                m_pImmediateContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+                m_pImmediateContext->SetPipelineState(m_MultiViewPSOs[m_CurrInstanceFormat][GetCubePSPermutation(ByMaterial ? Draw : TEX_BLEND_MODE_PER_INSTANCE, Specular)]);
+                m_pImmediateContext->CommitShaderResources(m_MultiViewSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+                DrawIndexedAttribs DrawAttrs;
+                DrawAttrs.IndexType    = VT_UINT32;
+                DrawAttrs.NumIndices   = 36;
+                DrawAttrs.NumInstances = Range.Count * NumViews; // Cada instancia se replica en todas las vistas
+                DrawAttrs.Flags        = DRAW_FLAG_VERIFY_ALL;
+                m_pImmediateContext->DrawIndexed(DrawAttrs);
+            }
+            m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_MULTIVIEW_MOBILE);
         }
     }
+    else if (ParallelViews)
+    {
+        // Las consultas no se pueden grabar en los contextos diferidos: se mide la ejecución de
+        // todas las listas en el contexto inmediato
+        m_GPUProfiler.BeginPass(m_pImmediateContext, GPU_PROFILE_PASS_PARALLEL_VIEWS);
+        ExecuteRecordedViews();
+        m_GPUProfiler.EndPass(m_pImmediateContext, GPU_PROFILE_PASS_PARALLEL_VIEWS);
+    }
+    else
+    {
+        // Sin la pasada única, renderizamos la escena tres veces, una vez para cada viewport con su propia cámara
+        Timer RecordTimer;
+        for (Uint32 viewIdx = 0; viewIdx < m_NumActiveViews; viewIdx++)
+            RenderView(viewIdx, Viewports[viewIdx], SCDesc.Width, SCDesc.Height, UseGPUCulling, UseCPUCulling);
+        AccumulateTiming(m_SerialRecordTimeMs, static_cast<float>(RecordTimer.GetElapsedTime() * 1000.0));
+    }
+
+    double      ViewPassesDuration = 0;
+    SHADOW_MODE ViewPassesMode     = SHADOW_MODE_NONE;
+    if (m_ViewPassesQuery && EndTimedPass(*m_ViewPassesQuery, m_ViewPassesQueryModes, m_pImmediateContext, ViewPassesDuration, ViewPassesMode))
+        AccumulateTiming(m_ViewPassesTimeMs[ViewPassesMode], static_cast<float>(ViewPassesDuration * 1000.0));
+
+    // Señalizar el fin del frame para liberar el slot del anillo de instancias
+    ++m_FrameId;
+    if (m_InstanceFence)
+        m_pImmediateContext->EnqueueSignal(m_InstanceFence, m_FrameId);
 }
 
 } // namespace Diligent
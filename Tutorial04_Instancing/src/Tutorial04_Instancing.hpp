@@ -27,10 +27,29 @@
 
 #pragma once
 
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "SampleBase.hpp"
+#include "RenderStateCache.h"
 #include "BasicMath.hpp"
+#include "MobileLayout.hpp"
+#include "MobileRig.hpp"
+#include "CameraMath.hpp"
+#include "InstanceData.hpp"
+#include "MobileGrid.hpp"
+#include "ThreadPool.hpp"
+#include "DurationQueryHelper.hpp"
+#include "InstanceBVH.hpp"
+#include "TransientConstantAllocator.hpp"
+#include "FrameConstants.hpp"
+#include "GPUPassProfiler.hpp"
+#include "InitTaskGraph.hpp"
+#include "SimClock.hpp"
+#include "Timer.hpp"
 
 namespace Diligent
 {
@@ -38,6 +57,9 @@ namespace Diligent
 class Tutorial04_Instancing final : public SampleBase
 {
 public:
+    ~Tutorial04_Instancing();
+
+    virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
 
     virtual void Render() override final;
@@ -46,56 +68,194 @@ public:
 
     virtual const Char* GetSampleName() const override final { return "Tutorial04: Instancing"; }
 
+    // Modo sin ventana del benchmark (HeadlessBenchmark.cpp): sin swap chain la escena se
+    // renderiza en un render target propio de Width x Height y no hay interfaz. Se llama antes
+    // de Initialize().
+    void SetOffscreenTarget(Uint32 Width, Uint32 Height);
+    // GridSize x GridSize móviles (1: solo el móvil) dibujados en las primeras NumActiveViews vistas
+    void SetBenchmarkScene(Uint32 GridSize, Uint32 NumActiveViews);
+    Uint32 GetNumInstances() const { return m_NumInstances; }
+    Uint32 GetNumActiveViews() const { return m_NumActiveViews; }
+
+    // Ticks por segundo de la simulación y si las instancias se reutilizan en los frames sin
+    // tick nuevo (sin interpolar) en lugar de regenerarse con el estado interpolado
+    void SetSimulation(Uint32 TickRate, bool ReuseInstancesBetweenTicks);
+    // Frames en los que se generaron instancias y frames en los que se reutilizaron
+    Uint32 GetNumGeneratedInstanceFrames() const { return m_NumGeneratedInstanceFrames; }
+    Uint32 GetNumReusedInstanceFrames() const { return m_NumReusedInstanceFrames; }
+
+    // Renderizado bajo demanda: cada vista se guarda en su propia textura y solo se vuelve a
+    // renderizar cuando cambia su cámara, la iluminación o las instancias animadas
+    void SetOnDemandRendering(bool OnDemand);
+    // Veces que se ha renderizado la vista ViewIdx y frames en modo bajo demanda
+    Uint32 GetNumViewRenders(Uint32 ViewIdx) const { return m_ViewRenders[ViewIdx]; }
+    Uint32 GetNumOnDemandFrames() const { return m_OnDemandFrames; }
+
+    // Caché en disco de los shaders y PSO compilados. Por defecto es
+    // tutorial04_state_cache_<backend>.bin en el directorio de trabajo; nullptr la desactiva.
+    // Se llama antes de Initialize().
+    void SetStateCachePath(const char* Path);
+
+    // Tiempos del arranque y uso de la caché de estados. Initialize() solo crea en el hilo
+    // principal los recursos baratos; los PSO y las texturas del móvil se crean después en el
+    // pool de hilos. Hasta tener los PSO solo se dibuja la interfaz; la escena se dibuja con los
+    // materiales en gris hasta que se decodifican sus texturas.
+    struct StartupStats
+    {
+        float  InitTimeMs       = 0; // Initialize(): la interfaz ya responde
+        float  SceneReadyTimeMs = 0; // Desde Initialize() hasta tener los PSO y SRB de la escena
+        float  TexturesReadyMs  = 0; // Desde Initialize() hasta copiar las texturas del móvil
+        float  LongestTaskMs    = 0; // Tarea de inicialización más larga
+        float  TotalTaskMs      = 0; // Suma de todas las tareas (el arranque en serie)
+        bool   StateCacheOn     = false;
+        bool   StateCacheWarm   = false; // Se cargó un fichero de caché existente
+        Uint32 NumCacheHits     = 0;     // Shaders y PSO que no hubo que compilar
+        Uint32 NumCacheMisses   = 0;
+    };
+    const StartupStats& GetStartupStats() const { return m_StartupStats; }
+
+    bool IsSceneReady() const { return m_SceneReady; }
+    // Espera a las tareas de inicialización y termina de preparar la escena y sus texturas (benchmark)
+    void WaitForScene();
+
+    // Tiempos y estadísticas del GPU por pasada; el índice de cada pasada es un GPU_PROFILE_PASS
+    GPUPassProfiler&   GetGPUProfiler() { return m_GPUProfiler; }
+    static const char* GetGPUProfilePassName(Uint32 Pass);
+
 private:
-    void CreatePipelineState();
+    // Permutaciones del pixel shader del móvil (macros TEX_BLEND_MODE y SPECULAR de
+    // cube_inst_lighting.psh). Los modos fijos coinciden con los materiales del móvil.
+    enum TEX_BLEND_MODE : Uint32
+    {
+        TEX_BLEND_MODE_DETAIL = 0,   // Base + BrickWall (material 0)
+        TEX_BLEND_MODE_SPLAT,        // Base + BlendMap (material 1)
+        TEX_BLEND_MODE_ALT,          // Base + MetalPlate (material 2)
+        TEX_BLEND_MODE_PER_INSTANCE, // La capa la elige cada instancia (instancias sin ordenar)
+        TEX_BLEND_MODE_COUNT
+    };
+    static_assert(TEX_BLEND_MODE_PER_INSTANCE == NumMobileMaterials, "Cada material necesita su modo de mezcla");
+    static constexpr Uint32 NumCubePSPermutations = TEX_BLEND_MODE_COUNT * 2;
+    static constexpr Uint32 GetCubePSPermutation(Uint32 BlendMode, bool Specular) { return BlendMode * 2 + (Specular ? 1 : 0); }
+    // Permutación que sirve para cualquier instancia; también se usa para crear los SRB
+    static constexpr Uint32 DefaultCubePSPermutation = GetCubePSPermutation(TEX_BLEND_MODE_PER_INSTANCE, true);
+
+    void CreateCubePSOs(INSTANCE_FORMAT Format);
+    RefCntAutoPtr<IShader> CreateCubeShader(SHADER_TYPE     Type,
+                                            const char*     FilePath,
+                                            INSTANCE_FORMAT InstanceFormat,
+                                            Uint32          PSPermutation = 0);
+    RefCntAutoPtr<IPipelineState> CreateCubePSO(const char*     Name,
+                                                IShader*        pVS,
+                                                IShader*        pGS,
+                                                IShader*        pPS,
+                                                Uint32          InstanceDataStepRate,
+                                                INSTANCE_FORMAT InstanceFormat);
+    RefCntAutoPtr<IShaderResourceBinding> CreateCubeSRB(IPipelineState* pPSO, IBuffer* pConstantsCB, const char* VSConstantsName, Uint32 VSConstantsSize);
+    void WriteCubeVSConstants(CubeVSConstants& Constants, Uint32 ViewIdx) const;
+    void WriteFloorVSConstants(FloorVSConstants& Constants, Uint32 ViewIdx) const;
+    bool WriteFrameConstants();
+    void CreateRecordingResources();
+    bool CanRecordInParallel() const;
+    void RecordFloorPass(IDeviceContext* pCtx, IShaderResourceBinding* pSRB, RESOURCE_STATE_TRANSITION_MODE TransitionMode);
+    void RecordMobilePass(IDeviceContext*                pCtx,
+                          IShaderResourceBinding*        pSRB,
+                          Uint32                         ViewIdx,
+                          bool                           UseGPUCulling,
+                          bool                           UseCPUCulling,
+                          RESOURCE_STATE_TRANSITION_MODE TransitionMode);
+    void RecordViewsInParallel(const Viewport* Viewports, bool UseGPUCulling, bool UseCPUCulling, bool RecordShadow);
+    void ExecuteRecordedViews();
+    void RenderView(Uint32 ViewIdx, const Viewport& VP, Uint32 RTWidth, Uint32 RTHeight, bool UseGPUCulling, bool UseCPUCulling);
+    Uint32 UpdateViewCache(Uint32 ViewWidth, Uint32 ViewHeight);
+    void RenderCachedViews(Uint32 DirtyViews, Uint32 ViewWidth, Uint32 ViewHeight, bool UseGPUCulling, bool UseCPUCulling);
+    void CompositeCachedViews(const Viewport* Viewports);
+    void CreateViewCompositePSO();
+    float4 GetClearColor() const;
     void CreateInstanceBuffer();
     void UpdateUI();
     void PopulateInstanceBuffer();
+    Uint32 WriteInstances(void* pDst, Uint32 NumInstances);
+    Uint32 WriteMobileInstances(InstanceDataType* InstanceDataArray);
+    Uint32 WriteGridInstances(InstanceDataType* InstanceDataArray, void* pEncodedDst = nullptr);
+    void GetMaterialRange(Uint32 Material, Uint32& FirstInstance, Uint32& NumInstances) const;
+    void SortVisibleInstancesByMaterial(Uint32 View);
+    void CreateThreadPool(Uint32 NumThreads);
+    void UpdateSimulation(double ElapsedTime);
+    void CreateMobileAnimationResources();
+    void AnimateInstancesOnGPU();
+    void CreateCullingResources();
+    void CreateMultiViewPSOs();
+    void CullInstancesOnGPU();
+    bool UseCPUCullingPath() const;
+    void GenerateCulledInstances();
+    void PopulateCulledInstanceBuffer();
+    Uint32 PickInstance(int x, int y, int windowIdx) const;
     void UpdateCameraMatrices();
     void HandleMouseEvent(int x, int y, bool buttonDown, bool buttonUp, int wheel);
 
-    void CreateLightingBuffers();
+    bool                 IsOffscreen() const { return !m_pSwapChain; }
+    const SwapChainDesc& GetTargetDesc() const;
+    ITextureView*        GetTargetRTV() const;
+    ITextureView*        GetTargetDSV() const;
+    float4x4             GetProjectionMatrix() const;
+    void                 CreateOffscreenTarget();
+
     void CreateShadowMap();
     void CreateShadowMapPSO();
+    void CreateVSMResources();
+    void UpdateShadowCasterState();
+    void RenderShadowMap();
+    void BeginShadowMapUpdate();
+    void RecordShadowCasters(IDeviceContext* pCtx, IShaderResourceBinding* pSRB, RESOURCE_STATE_TRANSITION_MODE TransitionMode);
+    void EndShadowMapUpdate();
+    void FilterShadowMoments();
     void CreateFloor();
     void CreateFloorPSO();
     void CreateFloorTexture();
+    void CreateMaterialTextureArray();
+    bool LoadCompressedMaterialTextures();
+    void CreateTextureBlitPSO();
+    void FillMaterialTextureArray();
+    void UpdateLight();
     void CalculateLightViewProj();
 
-    
-    // Estructuras para control de cámara
-    struct CameraParams
-    {
-        float2 PanOffset = {0.0f, 0.0f};
-        float Zoom = 1.0f;
-        float OrbitAngleX = -0.8f;
-        float OrbitAngleY = 0.0f;
-        float OrbitDistance = 20.0f;
-        
-        // Parámetros para cámara libre (Ventana 3)
-        float3 Position = {0.0f, 0.0f, 20.0f};
-        float RotX = 0.0f;
-        float RotY = 0.0f;
-        float RotZ = 0.0f;
-        float ViewZoom = 0.01f; // Factor de zoom para la ventana 3
-    };
-    
-    RefCntAutoPtr<IPipelineState>         m_pPSO;
+    // Inicialización asíncrona (ver StartupStats). Las tareas de los grafos solo usan el
+    // dispositivo; lo que necesita el contexto inmediato se hace en FinishAsyncInit() y
+    // FinishMaterialTextures(), en el hilo principal. m_InitGraph crea los PSO y SRB de la escena;
+    // m_TextureGraph decodifica las texturas del móvil, que no retrasan el primer frame. En OpenGL
+    // los grafos se ejecutan en serie dentro de Initialize().
+    void StartAsyncInit();
+    void FinishAsyncInit();
+    void FinishMaterialTextures();
+
+    InitTaskGraph m_InitGraph;
+    InitTaskGraph m_TextureGraph;
+    Timer         m_InitTimer;
+    bool          m_SceneReady            = false;
+    bool          m_MaterialTexturesReady = false;
+
+    BoundBox GetShadowCasterBounds() const;
+
+    RefCntAutoPtr<IPipelineState>         m_CubePSOs[INSTANCE_FORMAT_COUNT][NumCubePSPermutations]; // Por formato de instancia y permutación
     RefCntAutoPtr<IBuffer>                m_CubeVertexBuffer;
     RefCntAutoPtr<IBuffer>                m_CubeIndexBuffer;
-    RefCntAutoPtr<IBuffer>                m_InstanceBuffer;
-    RefCntAutoPtr<IBuffer>                m_VSConstants;
-    RefCntAutoPtr<IBuffer>                m_PSConstants;
-    RefCntAutoPtr<ITextureView>           m_TextureSRV;
+    RefCntAutoPtr<IBuffer>                m_InstanceBuffer;     // Buffer dinámico (MAP_FLAG_DISCARD)
     RefCntAutoPtr<IShaderResourceBinding> m_SRB;
-    RefCntAutoPtr<ITextureView>           m_TextureDetailSRV;   // Textura de detalle
-    RefCntAutoPtr<ITextureView>           m_TextureBlendSRV;    // Textura de mezcla/splatting
-    RefCntAutoPtr<ITextureView>           m_TextureAltSRV;      // Textura alternativa
+    RefCntAutoPtr<ITextureView>           m_MaterialTexturesSRV; // Texture2DArray con las cuatro texturas del móvil
+
+    // Texturas del móvil decodificadas en el pool y el PSO que las copia a las capas del array
+    static constexpr Uint32               NumMaterialTextures = 4;
+    bool                                  m_MaterialTexturesCompressed = false; // Cargadas del DDS de Tutorial04_TextureConverter
+    RefCntAutoPtr<ITexture>               m_MaterialSources[NumMaterialTextures];
+    RefCntAutoPtr<IPipelineState>         m_pTextureBlitPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_TextureBlitSRB;
 
     // Para iluminación y sombras
-    RefCntAutoPtr<IPipelineState>         m_pShadowMapPSO;
+    RefCntAutoPtr<IPipelineState>         m_ShadowMapPSOs[INSTANCE_FORMAT_COUNT];
+    RefCntAutoPtr<IPipelineState>         m_pShadowFloorPSO;
     RefCntAutoPtr<IPipelineState>         m_pFloorPSO;
     RefCntAutoPtr<IShaderResourceBinding> m_ShadowMapSRB;
+    RefCntAutoPtr<IShaderResourceBinding> m_ShadowFloorSRB;
     RefCntAutoPtr<IShaderResourceBinding> m_FloorSRB;
     RefCntAutoPtr<IBuffer>                m_FloorVertexBuffer;
     RefCntAutoPtr<IBuffer>                m_FloorIndexBuffer;
@@ -104,18 +264,368 @@ private:
     RefCntAutoPtr<ITextureView>           m_ShadowMapSRV;
     RefCntAutoPtr<ITextureView>           m_ShadowMapRTV;
     RefCntAutoPtr<ITextureView>           m_ShadowMapDSV;
-    RefCntAutoPtr<IBuffer>                m_LightAttribs;
-    RefCntAutoPtr<IBuffer>                m_FloorTransform;
+    RefCntAutoPtr<ITexture>               m_StaticShadowMap; // Capa estática (el suelo), se copia a m_ShadowMap
+    RefCntAutoPtr<ITextureView>           m_StaticShadowMapDSV;
 
     
-    float3 m_LightDirection = float3(-0.577f, -0.577f, -0.577f);
-    float4x4 m_LightViewProjMatrix;
+    float3 m_LightDirection = float3(-0.577f, -0.577f, -0.577f); // Normalizada; la actualiza Update()
+    float4x4 m_LightViewProjMatrix;                               // Vectores fila, sin trasponer
+
+    // Estado del que depende el contenido del mapa de sombras. Se calcula cada frame y el mapa
+    // solo se vuelve a renderizar cuando cambia, una vez por frame para las tres vistas.
+    struct ShadowCasterState
+    {
+        float4x4        LightViewProj;
+        float4x4        Rotation;
+        MobileAnimState Anim;
+        Uint32          GridSize = 0;
+
+        bool operator==(const ShadowCasterState& RHS) const
+        {
+            return LightViewProj == RHS.LightViewProj &&
+                Rotation == RHS.Rotation &&
+                Anim.MainRotation == RHS.Anim.MainRotation &&
+                Anim.FirstTierRotation == RHS.Anim.FirstTierRotation &&
+                Anim.SecondTierRotation == RHS.Anim.SecondTierRotation &&
+                GridSize == RHS.GridSize;
+        }
+    };
+    // Con la proyección ajustada a las cotas de las instancias, 512^2 da al móvil más densidad
+    // de texels que 1024^2 con una caja fija de 40 unidades
+    static constexpr Uint32 ShadowMapSize = 512;
+
+    // Entradas con las que se ajustó m_LightViewProjMatrix; solo se recalcula si cambian
+    float3   m_LightFitDirection;
+    BoundBox m_LightFitBounds;
+    bool     m_LightFitValid   = false;
+    Uint32   m_LightFitUpdates = 0;
+
+    // Filtrado de las sombras en los pixel shaders (g_ShadowParams.z en shadow_sampling.fxh).
+    // El VSM filtra los momentos una vez por actualización del mapa en lugar de en cada píxel
+    // de cada vista.
+    enum SHADOW_MODE : Uint32
+    {
+        SHADOW_MODE_NONE = 0,
+        SHADOW_MODE_PCF,
+        SHADOW_MODE_VSM,
+        SHADOW_MODE_COUNT
+    };
+    SHADOW_MODE GetShadowMode() const { return m_ShadowsEnabled ? m_ShadowFilter : SHADOW_MODE_NONE; }
+
+    bool                m_ShadowsEnabled      = true;
+    SHADOW_MODE         m_ShadowFilter        = SHADOW_MODE_PCF;
+    bool                m_AnimateScene        = true;
+    double              m_SceneTime           = 0; // Tiempo de la simulación interpolado; solo avanza con la escena animada
+    ShadowCasterState   m_ShadowCasters;           // Estado con el que se renderizó m_ShadowMap
+    bool                m_ShadowMapValid      = false;
+    bool                m_ShadowUpdatePending = false; // Lo decide UpdateShadowCasterState()
+    float4x4            m_StaticShadowLightViewProj;   // Luz con la que se renderizó la capa estática
+    bool                m_StaticShadowValid   = false;
+    Uint32              m_ShadowMapUpdates    = 0;
+    Uint32              m_StaticShadowUpdates = 0;
+    Uint32              m_ShadowFrames        = 0;
+    Uint32              m_ShadowFirstInstance = 0; // Segmento de la luz en el buffer del culling en CPU
+    Uint32              m_ShadowNumInstances  = 0;
+    std::vector<Uint32> m_ShadowCasterInstances;
+
+    // Mapa de sombras de varianza: dos pasadas de compute convierten la profundidad en momentos
+    // filtrados (RG32F) y después se generan sus mips
+    RefCntAutoPtr<IPipelineState>         m_pVSMBlurPSOs[2]; // Horizontal (desde la profundidad) y vertical
+    RefCntAutoPtr<IShaderResourceBinding> m_VSMBlurSRBs[2];
+    RefCntAutoPtr<ITexture>               m_ShadowMoments;
+    RefCntAutoPtr<ITextureView>           m_ShadowMomentsSRV;
+    RefCntAutoPtr<ITexture>               m_ShadowMomentsTemp; // Resultado de la pasada horizontal
+    int                                   m_VSMBlurRadius = 2;
+
+    // Comparación de los modos: coste en el GPU de la actualización del mapa y de las pasadas
+    // de las vistas, por modo de filtrado
+    std::unique_ptr<DurationQueryHelper> m_ShadowUpdateQuery;
+    std::unique_ptr<DurationQueryHelper> m_ViewPassesQuery;
+    std::deque<SHADOW_MODE>              m_ShadowUpdateQueryModes; // Modo de cada medida pendiente
+    std::deque<SHADOW_MODE>              m_ViewPassesQueryModes;
+    float                                m_ShadowUpdateTimeMs[SHADOW_MODE_COUNT] = {};
+    float                                m_ViewPassesTimeMs[SHADOW_MODE_COUNT]   = {};
+
+    void BeginTimedPass(DurationQueryHelper& Query, std::deque<SHADOW_MODE>& Modes, IDeviceContext* pCtx);
+    bool EndTimedPass(DurationQueryHelper& Query, std::deque<SHADOW_MODE>& Modes, IDeviceContext* pCtx, double& Duration, SHADOW_MODE& Mode);
 
     float4x4             m_ViewProjMatrix;
     float4x4             m_RotationMatrix;
     int                  m_GridSize   = 5;
     static constexpr int MaxGridSize  = 32;
     static constexpr int MaxInstances = MaxGridSize * MaxGridSize * MaxGridSize;
+
+    // Una vista por ventana; la matriz view-projection y la posición de la cámara de cada una se
+    // calculan al inicio de Render()
+    static constexpr Uint32 NumViews = 3;
+    float4x4                m_ViewProjs[NumViews];
+    float4                  m_ViewCameraPos[NumViews];
+    Uint32                  m_NumActiveViews = NumViews; // Solo el benchmark dibuja menos vistas
+
+    // Destino del modo sin ventana; m_OffscreenDesc sustituye a la descripción del swap chain
+    SwapChainDesc           m_OffscreenDesc;
+    RefCntAutoPtr<ITexture> m_OffscreenColor;
+    RefCntAutoPtr<ITexture> m_OffscreenDepth;
+
+    // Pasadas que mide m_GPUProfiler. Cada vista tiene su pasada del suelo y del móvil al grabar
+    // en serie; la pasada única y la grabación en paralelo solo se pueden medir en conjunto.
+    enum GPU_PROFILE_PASS : Uint32
+    {
+        GPU_PROFILE_PASS_ANIMATION = 0,
+        GPU_PROFILE_PASS_CULLING,
+        GPU_PROFILE_PASS_SHADOW_MAP,
+        GPU_PROFILE_PASS_FLOOR_VIEW0,
+        GPU_PROFILE_PASS_MOBILE_VIEW0     = GPU_PROFILE_PASS_FLOOR_VIEW0 + NumViews,
+        GPU_PROFILE_PASS_MULTIVIEW_FLOOR  = GPU_PROFILE_PASS_MOBILE_VIEW0 + NumViews,
+        GPU_PROFILE_PASS_MULTIVIEW_MOBILE,
+        GPU_PROFILE_PASS_PARALLEL_VIEWS,
+        GPU_PROFILE_PASS_VIEW_COMPOSITE,
+        GPU_PROFILE_PASS_COUNT
+    };
+    GPUPassProfiler m_GPUProfiler;
+
+    // Constantes de cada frame: todas se escriben con un único Map en un buffer transitorio
+    // y cada pasada las enlaza con su offset (SetBufferOffset) en lugar de mapear su propio buffer
+    struct FrameConstantOffsets
+    {
+        Uint32 CubePS = 0;
+        Uint32 CubeVS[NumViews] = {};
+        Uint32 FloorVS[NumViews] = {};
+        Uint32 ShadowVS = 0;
+        Uint32 ShadowFloorVS = 0;
+        Uint32 VSMBlur = 0;
+        Uint32 MultiView = 0;
+        Uint32 MobileAnim = 0;
+        Uint32 Cull = 0;
+    };
+    // Todos los shaders comparten la factory de ficheros y se crean, como los PSO, a través de
+    // la caché de estados cuando está disponible
+    void CreateStateCache();
+    void SaveStateCache();
+    void CreateShaderWithCache(const ShaderCreateInfo& ShaderCI, IShader** ppShader);
+    void CreateGraphicsPSOWithCache(const GraphicsPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO);
+    void CreateComputePSOWithCache(const ComputePipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO);
+    void CountStateCacheLookup(bool Found);
+
+    // Se incrementa cuando cambia algo que la caché no incluye en sus claves, para descartar
+    // los ficheros antiguos
+    static constexpr Uint32 StateCacheContentVersion = 1;
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> m_pShaderSourceFactory;
+    RefCntAutoPtr<IRenderStateCache>               m_pStateCache;
+    std::string                                    m_StateCachePath;
+    bool                                           m_StateCachePathSet = false;
+    bool                                           m_StateCacheDirty   = false; // Hay objetos nuevos sin guardar
+    std::mutex                                     m_StateCacheMtx;                 // Los PSO se crean desde el pool
+    StartupStats                                   m_StartupStats;
+
+    TransientConstantAllocator m_FrameConstants;
+    FrameConstantOffsets       m_FrameCBOffsets;
+    CubePSConstants            m_PSConstantsData; // Lo rellena Update() a partir de la UI
+
+    // Streaming de instancias: anillo de buffers en memoria unificada con varios frames
+    // en vuelo. El CPU escribe directamente en memoria mapeada y nunca espera al GPU:
+    // si el slot sigue en uso se recurre al buffer dinámico m_InstanceBuffer.
+    static constexpr Uint32 NumInstanceFramesInFlight = 3;
+    RefCntAutoPtr<IBuffer> m_InstanceRing[NumInstanceFramesInFlight];
+    Uint64                 m_InstanceRingFenceValue[NumInstanceFramesInFlight] = {};
+    RefCntAutoPtr<IFence>  m_InstanceFence;
+    Uint64                 m_FrameId                = 0;
+    Uint32                 m_InstanceBufferCapacity = 0; // Capacidad de m_InstanceBuffer en instancias
+    IBuffer*               m_pCurrInstanceBuffer    = nullptr;
+    Uint32                 m_NumInstances           = 0;
+
+    // Formato en el que el CPU sube las instancias, y el del buffer de instancias actual. El
+    // compute shader de animación y el de culling siempre usan INSTANCE_FORMAT_FULL.
+    INSTANCE_FORMAT m_InstanceFormat     = INSTANCE_FORMAT_FULL;
+    INSTANCE_FORMAT m_CurrInstanceFormat = INSTANCE_FORMAT_FULL;
+
+    // Grafo de transformaciones del móvil: sólo los pivotes animados se marcan como sucios
+    MobileRig       m_MobileRig;
+    MobileAnimState m_MobileAnim; // Estado que se dibuja este frame (ver UpdateSimulation())
+    Uint32          m_NumNodesUpdated = 0; // Matrices recalculadas en el último frame
+
+    // Simulación a paso fijo: la animación avanza en ticks de m_SimClock y el render interpola
+    // entre los dos últimos, o usa el último si se reutilizan las instancias entre ticks
+    struct SimState
+    {
+        MobileAnimState Anim;
+        double          SceneTime = 0;
+    };
+    static void TickSimulation(SimState& State, double TickDuration);
+
+    SimClock m_SimClock;
+    SimState m_SimPrev;
+    SimState m_SimCurr;
+    Uint32   m_SimTicksLastFrame          = 0;
+    bool     m_ReuseInstancesBetweenTicks = false;
+
+    // Entradas de las que dependen las instancias de un frame. Con m_ReuseInstancesBetweenTicks
+    // las instancias solo se regeneran cuando cambian; sin animación no cambian nunca.
+    enum INSTANCE_GEN_PATH : Uint32
+    {
+        INSTANCE_GEN_PATH_RETAINED = 0, // Buffer en memoria del GPU, subido con UpdateBuffer()
+        INSTANCE_GEN_PATH_CPU_CULLING,  // m_CPUInstances y la BVH
+        INSTANCE_GEN_PATH_GPU,          // Compute shader de animación
+    };
+    struct InstanceGenState
+    {
+        MobileAnimState   Anim;
+        Uint32            GridSize = 0;
+        INSTANCE_FORMAT   Format   = INSTANCE_FORMAT_FULL;
+        INSTANCE_GEN_PATH Path     = INSTANCE_GEN_PATH_RETAINED;
+
+        bool operator==(const InstanceGenState& RHS) const
+        {
+            return Anim.MainRotation == RHS.Anim.MainRotation &&
+                Anim.FirstTierRotation == RHS.Anim.FirstTierRotation &&
+                Anim.SecondTierRotation == RHS.Anim.SecondTierRotation &&
+                GridSize == RHS.GridSize &&
+                Format == RHS.Format &&
+                Path == RHS.Path;
+        }
+    };
+    bool ReuseInstances(INSTANCE_GEN_PATH Path);
+
+    InstanceGenState       m_InstanceGenState;
+    bool                   m_InstanceGenStateValid = false;
+    RefCntAutoPtr<IBuffer> m_RetainedInstanceBuffer; // USAGE_DEFAULT: su contenido sobrevive entre frames
+    std::vector<Uint8>     m_RetainedInstanceData;
+    Uint32                 m_NumGeneratedInstanceFrames = 0;
+    Uint32                 m_NumReusedInstanceFrames    = 0;
+
+    // Modo rejilla: m_GridSize x m_GridSize móviles generados en paralelo
+    bool                                    m_GridMode = false;
+    MobileGrid                              m_MobileGrid;
+    std::unique_ptr<WorkStealingThreadPool> m_pThreadPool;
+    int                                     m_NumThreads          = 1; // Incluye el hilo principal
+    float                                   m_InstanceGenTimeMs   = 0; // Tiempo de generación de instancias
+    float                                   m_CulledGenTimeMs     = 0; // Parte hecha en GenerateCulledInstances()
+
+    Uint32 GetGPUGridSize() const { return m_GridMode ? static_cast<Uint32>(m_GridSize) : 1u; }
+    Uint32 GetNumGPUInstances() const { return GetGPUGridSize() * GetGPUGridSize() * NumMobileParts; }
+
+    // Animación en el GPU: la disposición estática de las piezas se sube una vez y un compute
+    // shader escribe el buffer de instancias a partir de los ángulos de cada frame
+    bool                                  m_GPUAnimation = false;
+    RefCntAutoPtr<IPipelineState>         m_pMobileAnimPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_MobileAnimSRB;
+    RefCntAutoPtr<IBuffer>                m_MobilePartsBuffer;
+    RefCntAutoPtr<IBuffer>                m_GPUInstanceBuffer;
+
+    // Culling por vista en el GPU (solo con la animación en el GPU): cada vista recibe su lista
+    // compacta de instancias visibles y se dibuja con DrawIndexedIndirect
+    bool                                  m_GPUCulling = true;
+    RefCntAutoPtr<IPipelineState>         m_pCullPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_CullSRB;
+    RefCntAutoPtr<IBuffer>                m_VisibleInstanceBuffer; // NumViews segmentos de MaxInstances
+    RefCntAutoPtr<IBuffer>                m_DrawArgsBuffer;        // Argumentos indirectos de cada vista
+
+    // Culling por vista en el CPU: las instancias se generan en memoria del sistema, se reajusta
+    // una BVH sobre sus cajas y sólo se suben las visibles de cada vista, en segmentos consecutivos
+    bool                          m_CPUCulling = false;
+    InstanceBVH                   m_InstanceBVH;
+    std::vector<InstanceDataType> m_CPUInstances;
+    std::vector<Uint32>           m_ViewVisibleInstances[NumViews];
+    RefCntAutoPtr<IBuffer>        m_CulledInstanceBuffer;
+    Uint32                        m_CulledInstanceBufferCapacity = 0;
+    Uint32                        m_ViewFirstInstance[NumViews]  = {};
+    Uint32                        m_ViewNumInstances[NumViews]   = {};
+    std::vector<Uint32>           m_VisibleScratch;
+
+    // Draws ordenados por material: los escritores de instancias en el CPU agrupan las instancias
+    // por material y cada rango se dibuja con la permutación del pixel shader de su material.
+    // Las instancias que genera el GPU no están ordenadas y usan TEX_BLEND_MODE_PER_INSTANCE.
+    struct InstanceRange
+    {
+        Uint32 First = 0;
+        Uint32 Count = 0;
+    };
+    bool          m_MaterialSortedDraws       = true;
+    bool          m_InstancesSortedByMaterial = false;
+    InstanceRange m_MaterialRanges[NumViews][NumMobileMaterials]; // Dentro del buffer de instancias actual
+
+    // Coste en el GPU de cada permutación, medido en la vista principal al grabar en serie
+    bool                                 m_MeasurePermutations = false;
+    std::unique_ptr<DurationQueryHelper> m_PermutationQueries[NumCubePSPermutations];
+    float                                m_PermutationTimeMs[NumCubePSPermutations] = {};
+
+    // Pasada única para las tres vistas: las matrices de todas las vistas están en un único
+    // constant buffer, los datos de instancia se replican por vista (InstanceDataStepRate) y
+    // un geometry shader elige el viewport de cada triángulo
+    bool                                  m_MultiView = false;
+    RefCntAutoPtr<IPipelineState>         m_MultiViewPSOs[INSTANCE_FORMAT_COUNT][NumCubePSPermutations];
+    RefCntAutoPtr<IShaderResourceBinding> m_MultiViewSRB;
+    RefCntAutoPtr<IPipelineState>         m_pMultiViewFloorPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_MultiViewFloorSRB;
+
+    // Grabación en paralelo: cada pasada de cada vista se graba en su propio contexto diferido
+    // desde el pool de hilos y las listas de comandos se envían en orden al contexto inmediato.
+    // Las instancias del mapa de sombras se graban a la vez en un contexto diferido más.
+    enum RECORD_PASS : Uint32
+    {
+        RECORD_PASS_FLOOR = 0,
+        RECORD_PASS_MOBILE,
+        RECORD_PASS_COUNT
+    };
+    static constexpr Uint32 NumRecordJobs = NumViews * RECORD_PASS_COUNT;
+    static Uint32      GetRecordView(Uint32 JobIdx) { return JobIdx / RECORD_PASS_COUNT; }
+    static RECORD_PASS GetRecordPass(Uint32 JobIdx) { return static_cast<RECORD_PASS>(JobIdx % RECORD_PASS_COUNT); }
+
+    struct RecordJob
+    {
+        TransientConstantAllocator            Constants; // Mapeado en el contexto diferido del trabajo
+        RefCntAutoPtr<IShaderResourceBinding> pSRB;      // Propio: los offsets de las constantes no se comparten entre hilos
+        RefCntAutoPtr<ICommandList>           pCmdList;
+        float                                 RecordTimeMs = 0;
+    };
+    bool               m_ParallelRecording = false;
+    RecordJob          m_RecordJobs[NumRecordJobs];
+    RecordJob          m_ShadowRecordJob; // En el contexto diferido NumRecordJobs
+    float              m_SerialRecordTimeMs = 0;     // Grabación en el contexto inmediato
+    float              m_RecordJobTimeMs    = 0;     // Suma de los tiempos de todos los trabajos
+    std::vector<float> m_RecordTimeMsByThreads;      // Tiempo de pared indexado por número de hilos
+
+    // Renderizado bajo demanda: cada vista se renderiza en su propia textura y solo se vuelve a
+    // renderizar cuando cambia algo de lo que depende su imagen; el resto de frames solo se
+    // compone sobre el destino. La pasada única y la grabación en paralelo no se usan en este modo.
+    // Cada estado que la interfaz puede cambiar y del que depende la imagen tiene su campo en la clave.
+    // La clave solo tiene entradas del frame, no resultados: se compara antes de generar las instancias.
+    struct ViewCacheKey
+    {
+        float4x4        ViewProj;
+        float4          CameraPos;
+        float4x4        Rotation;
+        CubePSConstants PSConstants; // Luz, mezcla y especular; sin la matriz de la luz, que se deriva del resto
+        MobileAnimState Anim;
+        Uint32          GridSize            = 0; // 0: solo el móvil
+        Uint32          InstanceFormat      = 0; // INSTANCE_FORMAT
+        Uint32          ShadowMode          = 0; // SHADOW_MODE; SHADOW_MODE_NONE si las sombras están desactivadas
+        Uint32          VSMBlurRadius       = 0;
+        Uint32          CullingMode         = 0; // Bit 0: culling en GPU, bit 1: culling en CPU (el camino pedido)
+        Uint32          MaterialSortedDraws = 0;
+        Uint32          GPUAnimation        = 0;
+        Uint32          MaterialsReady      = 0; // Las capas del array dejan de ser grises
+        Uint32          Width               = 0;
+        Uint32          Height              = 0;
+
+        bool operator==(const ViewCacheKey& RHS) const { return std::memcmp(this, &RHS, sizeof(ViewCacheKey)) == 0; }
+    };
+    static_assert(sizeof(ViewCacheKey) == sizeof(float4x4) * 2 + sizeof(float4) + sizeof(CubePSConstants) + sizeof(MobileAnimState) + sizeof(Uint32) * 10,
+                  "ViewCacheKey se compara con memcmp y no puede tener relleno");
+    bool                                  m_OnDemandRendering = false;
+    RefCntAutoPtr<ITexture>               m_ViewColor[NumViews];
+    RefCntAutoPtr<ITexture>               m_ViewDepth[NumViews];
+    RefCntAutoPtr<IShaderResourceBinding> m_ViewCompositeSRBs[NumViews];
+    RefCntAutoPtr<IPipelineState>         m_pViewCompositePSO;
+    ViewCacheKey                          m_ViewCacheKeys[NumViews];
+    bool                                  m_ViewCacheValid[NumViews] = {};
+    Uint32                                m_ViewRenders[NumViews]    = {};
+    Uint32                                m_OnDemandFrames           = 0;
+
+    // Selección con el ratón sobre la BVH
+    Uint32 m_PickedInstance     = InstanceBVH::InvalidIndex;
+    Uint32 m_NumPickedNeighbors = 0; // Instancias que solapan la caja de la seleccionada
     
     // Cámaras para las tres ventanas
     CameraParams CameraWindow1; // Paneo y zoom